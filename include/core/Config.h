@@ -46,6 +46,11 @@ public:
         bool ssao = true;
         bool bloom = true;
         int msaaSamples = 4;
+        bool dynamicResolution = false;
+        float targetFrameTime = 16.6f;      // ms
+        float minResolutionScale = 0.5f;
+        float maxResolutionScale = 1.0f;
+        bool gpuTreeCulling = false;        // Cull trees in compute shaders
     };
 
     // Audio settings
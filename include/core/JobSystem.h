@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace ExperimentRedbear {
+
+// Fixed pool of worker threads for data-parallel frame work. parallelFor
+// splits a range into batches that the workers and the calling thread pull
+// from until none are left; it returns once every batch has run.
+class JobSystem {
+public:
+    static JobSystem& getInstance();
+
+    // workerCount < 0 uses one worker per hardware thread minus the caller
+    bool initialize(int workerCount = -1);
+    void shutdown();
+
+    // Runs fn(begin, end) over [0, count) in batches of batchSize. Calls
+    // from a worker (nested) or with no workers run inline.
+    void parallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& fn);
+
+    // 0 for threads outside the pool (the main thread), 1..N for workers.
+    // Stable for the lifetime of the pool, so it can index per-thread data.
+    static int getThreadIndex();
+
+    // Workers plus the calling thread
+    int getThreadCount() const { return static_cast<int>(m_workers.size()) + 1; }
+
+private:
+    JobSystem() = default;
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void workerLoop(int threadIndex);
+    void runBatches();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_callMutex;     // One parallelFor at a time
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    // Current parallelFor
+    const std::function<void(size_t, size_t)>* m_task = nullptr;
+    size_t m_count = 0;
+    size_t m_batchSize = 1;
+    size_t m_batchCount = 0;
+    std::atomic<size_t> m_nextBatch{0};
+    uint64_t m_generation = 0;
+    int m_activeWorkers = 0;
+    bool m_quit = false;
+};
+
+} // namespace ExperimentRedbear
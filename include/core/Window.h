@@ -15,6 +15,7 @@ struct WindowSettings {
     bool vsync = true;
     int samples = 4;
     int refreshRate = 60;
+    bool headless = false;  // Offscreen context, no display server required
 };
 
 class Window {
@@ -48,6 +49,7 @@ public:
 
     void setFullscreen(bool fullscreen);
     bool isFullscreen() const { return m_fullscreen; }
+    bool isHeadless() const { return m_headless; }
 
     void centerWindow();
 
@@ -63,6 +65,7 @@ private:
     int m_width = 0;
     int m_height = 0;
     bool m_fullscreen = false;
+    bool m_headless = false;
 
     std::function<void(int, int)> m_resizeCallback;
     std::function<void(int, int, int, int)> m_keyCallback;
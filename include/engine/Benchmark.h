@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "graphics/Renderer.h"
+
+namespace ExperimentRedbear {
+
+class Game;
+
+struct BenchmarkSettings {
+    std::string scene = "full";     // house, forest or full
+    int frames = 1000;
+    int warmupFrames = 60;
+    int width = 1280;
+    int height = 720;
+    std::string outputPath = "benchmark.csv";  // .json writes JSON, anything else CSV
+    std::string pathFile;           // Optional recorded camera path, overrides the scene default
+};
+
+struct CameraKeyframe {
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+// Camera path through a list of keyframes, interpolated with a uniform
+// Catmull-Rom spline. Files hold one keyframe per line:
+//   px py pz tx ty tz
+// Blank lines and lines starting with '#' are ignored.
+class CameraPath {
+public:
+    void addKeyframe(const glm::vec3& position, const glm::vec3& target);
+    bool loadFromFile(const std::string& path);
+    bool saveToFile(const std::string& path) const;
+
+    // t in [0, 1] covers the whole path
+    void evaluate(float t, glm::vec3& position, glm::vec3& target) const;
+
+    bool empty() const { return m_keyframes.empty(); }
+    size_t size() const { return m_keyframes.size(); }
+
+    static CameraPath createDefault(const std::string& scene);
+
+private:
+    std::vector<CameraKeyframe> m_keyframes;
+};
+
+// Fixed-length, fixed-timestep run over a generated world for measuring
+// render changes on headless machines. Writes one row per frame.
+class Benchmark {
+public:
+    Benchmark();
+    ~Benchmark();
+
+    // Returns true if --benchmark was given. Recognised options:
+    //   --benchmark <scene> --frames N [--warmup N] [--size WxH]
+    //   [--output file.csv|file.json] [--path camera.path]
+    static bool parseArguments(int argc, char* argv[], BenchmarkSettings& settings);
+
+    bool run(Game& game, const BenchmarkSettings& settings);
+
+private:
+    struct FrameSample {
+        int frame;
+        float frameTime;   // Wall clock, ms
+        RenderStats stats; // Counters for this frame, timings resolved later
+    };
+
+    bool writeCSV(const std::string& path) const;
+    bool writeJSON(const std::string& path) const;
+    void logSummary() const;
+
+    BenchmarkSettings m_settings;
+    std::vector<FrameSample> m_samples;
+};
+
+} // namespace ExperimentRedbear
@@ -11,6 +11,7 @@
 #include "game/World.h"
 #include "ui/Menu.h"
 #include "ui/HUD.h"
+#include "engine/Benchmark.h"
 
 namespace ExperimentRedbear {
 
@@ -33,6 +34,17 @@ public:
     void run();
     void shutdown();
 
+    // Headless benchmark mode, must be set before initialize()
+    void setBenchmark(const BenchmarkSettings& settings);
+    bool isBenchmark() const { return m_benchmarkMode; }
+    int getExitCode() const { return m_exitCode; }
+
+    // Renders the scene and UI for the current state (no buffer swap)
+    void renderFrame();
+
+    // Populates the world with the generated house and/or forest
+    void initializeWorld(bool generateHouse = true, bool generateForest = true);
+
     // State management
     void setState(GameState state);
     GameState getState() const { return m_state; }
@@ -78,7 +90,6 @@ private:
     void updatePlaying(float deltaTime);
 
     void loadAssets();
-    void initializeWorld();
 
     GameState m_state = GameState::UNINITIALIZED;
 
@@ -101,6 +112,11 @@ private:
     std::function<void()> m_onGameStart;
     std::function<void()> m_onGameEnd;
 
+    // Benchmark
+    BenchmarkSettings m_benchmarkSettings;
+    bool m_benchmarkMode = false;
+    int m_exitCode = 0;
+
     bool m_initialized = false;
     bool m_running = false;
 };
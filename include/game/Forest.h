@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace ExperimentRedbear {
+
+class Mesh;
+class Camera;
+struct Occluder;
+
+struct Tree {
+    glm::vec3 position;
+    float height;
+    float trunkRadius;
+    float canopyRadius;
+    int type; // 0=pine, 1=oak, 2=dead
+    float rotation;
+};
+
+// Draws the generated trees. Each tree type is a procedural mesh (trunk and
+// foliage parts, with LOD chains) built once and baked into impostors. The
+// trees are packed into the ForestRenderer's instance buffer when they are
+// set; each frame near trees are culled and given a LOD here and drawn
+// instanced per type. Past IMPOSTOR_DISTANCE they become billboards,
+// cross-fading with the lowest mesh LOD over FADE_RANGE. With GPU tree
+// culling all of that happens in ForestRenderer instead.
+class Forest {
+public:
+    static constexpr int VARIANT_COUNT = 3;
+    static constexpr float IMPOSTOR_DISTANCE = 60.0f;
+    static constexpr float FADE_RANGE = 8.0f;
+
+    // Trunk radius to height ratios each type's impostor is baked with.
+    // Trees snap their trunk to the nearest one so the mesh and impostor
+    // match through the cross-fade.
+    static constexpr int TRUNK_VARIANTS = 2;
+    static constexpr float TRUNK_RATIOS[TRUNK_VARIANTS] = {0.012f, 0.035f};
+
+    Forest();
+    ~Forest();
+
+    // Builds the variant meshes and bakes their impostors. Needs the
+    // renderer to be initialized; does nothing if already built.
+    bool initialize();
+    void shutdown();
+
+    void setTrees(const std::vector<Tree>& trees);
+    void clear();
+
+    void render(const Camera& camera);
+
+    size_t getTreeCount() const { return m_instances.size(); }
+
+    // Appends boxes inside the trunks as drawn, for trees whose snapped
+    // base radius is at least minTrunkRadius
+    void getOccluders(std::vector<Occluder>& occluders, float minTrunkRadius = 0.2f) const;
+
+private:
+    static constexpr float UNIT_TRUNK_RADIUS = 0.02f;
+
+    enum Part {
+        TRUNK,
+        FOLIAGE,
+        PART_COUNT
+    };
+
+    // Meshes of one tree type in unit space: the trunk has a base radius of
+    // UNIT_TRUNK_RADIUS, the whole tree is one unit tall
+    struct Variant {
+        std::unique_ptr<Mesh> parts[PART_COUNT];   // A part may be missing
+        glm::vec4 partBounds[PART_COUNT];          // xyz = center, w = radius
+        glm::vec4 bounds;                          // Whole tree
+    };
+
+    struct Instance {
+        glm::vec4 partBounds[PART_COUNT];   // World space
+        glm::vec4 bounds;                   // World space, whole tree
+        glm::vec3 position;
+        float height;
+        float trunkRadius;     // Base radius as drawn, after snapping
+        float yaw;
+        int type;
+        int impostorVariant;   // type * TRUNK_VARIANTS + trunk ratio
+        uint8_t lodState[PART_COUNT] = {};
+    };
+
+    void buildVariants();
+
+    Variant m_variants[VARIANT_COUNT];
+    std::vector<Instance> m_instances;
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
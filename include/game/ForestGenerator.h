@@ -4,19 +4,11 @@
 #include <vector>
 #include <memory>
 #include "game/World.h"
+#include "game/Forest.h"
 #include "utils/PerlinNoise.h"
 
 namespace ExperimentRedbear {
 
-struct Tree {
-    glm::vec3 position;
-    float height;
-    float trunkRadius;
-    float canopyRadius;
-    int type; // 0=pine, 1=oak, 2=dead
-    float rotation;
-};
-
 struct Snowflake {
     glm::vec3 position;
     glm::vec3 velocity;
@@ -61,10 +53,6 @@ private:
     float m_fogDensity = 0.015f;
     int m_maxSnowflakes = 5000;
     float m_snowAreaRadius = 50.0f;
-
-    // Ground
-    std::vector<glm::vec3> m_groundVertices;
-    std::vector<unsigned int> m_groundIndices;
 };
 
 } // namespace ExperimentRedbear
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include "game/World.h"
+#include "graphics/OcclusionCuller.h"
 
 namespace ExperimentRedbear {
 
@@ -11,8 +12,8 @@ struct Room {
     std::string name;
     glm::vec3 position;
     glm::vec3 size;
-    std::vector<glm::vec3> doorPositions;
-    std::vector<glm::vec3> windowPositions;
+    std::vector<glm::vec3> doorPositions;     // Relative to position, on a wall
+    std::vector<glm::vec3> windowPositions;   // Relative to position, on a wall
     std::vector<glm::vec3> itemSpawnPoints;
 };
 
@@ -32,6 +33,11 @@ public:
     const std::vector<Floor>& getFloors() const { return m_floors; }
     const glm::vec3& getHouseSize() const { return m_houseSize; }
 
+    // Appends the room walls as occluder boxes, split around doors and
+    // windows. Adds nothing while the walls aren't drawn, or the culler
+    // would hide what shows through them.
+    void getOccluders(std::vector<Occluder>& occluders) const;
+
     // Configuration
     void setNumFloors(int floors) { m_numFloors = floors; }
     void setHouseSize(const glm::vec3& size) { m_houseSize = size; }
@@ -51,6 +57,7 @@ private:
     glm::vec3 m_houseSize = glm::vec3(15.0f, 6.0f, 12.0f);
     int m_numFloors = 2;
     int m_style = 0; // 0=abandoned, 1=victorian, 2=modern
+    bool m_hasWallGeometry = false;   // Set once generateRooms() draws the walls
 
     std::vector<Floor> m_floors;
 
@@ -7,6 +7,7 @@
 #include "game/Door.h"
 #include "game/Item.h"
 #include "game/Interactable.h"
+#include "game/Forest.h"
 
 namespace ExperimentRedbear {
 
@@ -74,6 +75,9 @@ public:
     void setSnowIntensity(float intensity) { m_settings.snowIntensity = intensity; }
     void setFogDensity(float density) { m_settings.fogDensity = density; }
 
+    // Trees placed by the forest generator
+    Forest& getForest() { return m_forest; }
+
     // Time of day (for future expansion)
     float getTimeOfDay() const { return m_timeOfDay; }
     void setTimeOfDay(float time) { m_timeOfDay = time; }
@@ -89,6 +93,7 @@ private:
     std::vector<std::shared_ptr<Door>> m_doors;
     std::vector<std::shared_ptr<Item>> m_items;
     std::vector<Collider> m_colliders;
+    Forest m_forest;
 
     float m_timeOfDay = 22.0f; // 10 PM - night time
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <GL/glew.h>
+#include "graphics/Shader.h"
+
+namespace ExperimentRedbear {
+
+// Physically based bloom on a half resolution mip chain, all in compute
+// shaders. Each level is a 13-tap downsample of the one above (the first
+// with a Karis average against fireflies and a soft threshold), then the
+// chain is walked back up, adding a 3x3 tent upsample of every level into
+// the next finer one. The result in level 0 is composited by the post pass.
+class Bloom {
+public:
+    static constexpr int MAX_LEVELS = 6;
+    static constexpr int MIN_LEVEL_SIZE = 8;   // Pixels, smallest side
+
+    Bloom();
+    ~Bloom();
+
+    // Compiles the shaders once and (re)allocates the chain for a source of
+    // width x height
+    bool initialize(int width, int height);
+    void shutdown();
+
+    // Filters source (full resolution HDR color) into the chain. Only the
+    // sourceScale part of source is read (dynamic resolution); the chain
+    // always spans the whole screen.
+    void process(GLuint source, const glm::vec2& sourceScale, float threshold, float knee);
+
+    // Level 0 of the chain, valid after process()
+    GLuint getTexture() const { return m_texture; }
+    int getLevelCount() const { return m_levelCount; }
+
+private:
+    bool createShaders();
+
+    GLuint m_texture = 0;
+    int m_width = 0;        // Level 0 size
+    int m_height = 0;
+    int m_levelCount = 0;
+
+    std::unique_ptr<ShaderProgram> m_downsampleShader;
+    std::unique_ptr<ShaderProgram> m_upsampleShader;
+};
+
+} // namespace ExperimentRedbear
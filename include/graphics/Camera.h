@@ -51,6 +51,14 @@ public:
     // Frustum culling
     bool isInFrustum(const glm::vec3& point) const;
     bool isInFrustum(const glm::vec3& center, float radius) const;
+    const glm::vec4* getFrustumPlanes() const { return m_frustumPlanes; }
+
+    // Projected diameter in pixels of a world-space sphere on a viewport
+    // viewportHeight pixels tall. Used to pick mesh LODs.
+    float getScreenSize(const glm::vec3& center, float radius, float viewportHeight) const;
+
+    // Normalised planes (left, right, bottom, top, near, far) of a view-projection matrix
+    static void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
 
 private:
     void updateVectors();
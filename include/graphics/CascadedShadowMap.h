@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/Camera.h"
+#include "graphics/Light.h"
+#include "graphics/GpuBuffer.h"
+#include "graphics/RenderQueue.h"
+#include "graphics/ShaderInterface.h"
+
+namespace ExperimentRedbear {
+
+class ShaderProgram;
+struct RenderStats;
+
+// Cascaded shadow maps for the first shadow-casting directional light.
+// The view frustum up to the shadow distance is split into slices, each
+// covered by an orthographic map fitted to the slice's bounding sphere and
+// snapped to whole texels so it doesn't shimmer as the camera moves. Near
+// cascades render every frame, far ones alternate between frames.
+class CascadedShadowMap {
+public:
+    static constexpr int MAX_CASCADES = SHADOW_MAX_CASCADES;
+
+    CascadedShadowMap();
+    ~CascadedShadowMap();
+
+    // cascadeCount of 0 disables directional shadows
+    bool initialize(int cascadeCount, int resolution);
+    void shutdown();
+
+    // Renders the cascades that are due this frame and uploads the cascade
+    // block. Returns the index of the shadowed light, or -1. Uses the
+    // queue's cull pass, so call it before the main view is culled.
+    // extraCasters, if set, runs after the queue in every view drawn.
+    int update(const Camera& camera, const std::vector<Light>& lights, float shadowDistance,
+               RenderQueue& queue, ShaderProgram& depthShader, RenderStats& stats,
+               const ShadowCasterCallback& extraCasters = nullptr);
+
+    // Forces every cascade to re-render next frame
+    void invalidate();
+
+    GLuint getTexture() const { return m_depthTexture; }
+    int getCascadeCount() const { return m_cascadeCount; }
+    int getResolution() const { return m_resolution; }
+    bool isEnabled() const { return m_cascadeCount > 0; }
+
+private:
+    void computeSplits(float nearPlane, float farPlane);
+    glm::mat4 fitCascade(const Camera& camera, const glm::vec3& lightDirection,
+                         float sliceNear, float sliceFar, float& texelSize) const;
+
+    int m_cascadeCount = 0;
+    int m_resolution = 0;
+    GLuint m_fbo = 0;
+    GLuint m_depthTexture = 0;
+
+    float m_splits[MAX_CASCADES + 1] = {};
+    bool m_valid[MAX_CASCADES] = {};
+    glm::vec3 m_lightDirection = glm::vec3(0.0f);
+    unsigned int m_frameIndex = 0;
+
+    GPUShadowCascades m_gpuCascades = {};
+    GpuBuffer m_cascadeBuffer;
+};
+
+} // namespace ExperimentRedbear
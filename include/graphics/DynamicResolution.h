@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ExperimentRedbear {
+
+// Picks the scene's resolution scale from measured GPU times. Scene cost is
+// taken to grow with the pixel count (scale squared) while the rest of the
+// frame is fixed, so each step aims the scene at what is left of the
+// budget. GPU times arrive a few frames late, so after a change the
+// controller waits until they reflect the new scale.
+class DynamicResolution {
+public:
+    static constexpr float BUDGET_HEADROOM = 0.9f;   // Aim slightly under the target
+    static constexpr float MIN_STEP = 0.02f;         // Smaller changes are ignored
+    static constexpr float DAMPING = 0.5f;           // Fraction of the error corrected per step
+
+    DynamicResolution();
+    ~DynamicResolution();
+
+    void reset(float scale = 1.0f);
+
+    // Takes the newest resolved GPU frame and scene times (ms) and returns
+    // the scale for the next frame, within [minScale, maxScale]
+    float update(float gpuFrameTime, float gpuSceneTime, float targetFrameTime, float minScale, float maxScale);
+
+    float getScale() const { return m_scale; }
+
+private:
+    float m_scale = 1.0f;
+    int m_framesSinceChange = 0;
+};
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "graphics/GpuBuffer.h"
+#include "graphics/ShaderInterface.h"
+#include "graphics/TreeCuller.h"
+
+namespace ExperimentRedbear {
+
+class Mesh;
+class Camera;
+class ShaderProgram;
+class ImpostorAtlas;
+struct RenderStats;
+
+// Instanced tree drawing. Per tree data lives in a storage buffer written
+// once when the forest is generated; each frame only the list of visible
+// tree indices is uploaded, and every (type, part, LOD) run of it becomes a
+// single glDrawElementsInstanced through Mesh::drawInstanced.
+//
+// With GPU culling the CPU no longer touches individual trees: TreeCuller
+// picks the visible trees, LODs and impostors on the GPU and the draws
+// become one glMultiDrawElementsIndirect per type and part.
+class ForestRenderer {
+public:
+    static constexpr int MAX_TYPES = TREE_MAX_TYPES;
+    static constexpr int MAX_PARTS = TREE_MAX_PARTS;
+    static constexpr int MAX_LODS = TREE_MAX_LODS;
+    static constexpr uint32_t MAX_INSTANCES = 1u << 24;
+
+    ForestRenderer();
+    ~ForestRenderer();
+
+    // Keeps the instances and meshes if already initialized
+    bool initialize();
+    void shutdown();
+
+    // Mesh of one part of a tree type, drawn in the tree's unit space. It is
+    // not owned and must stay alive until clear().
+    void setMesh(int type, int part, const Mesh* mesh);
+
+    // Unit-space bounding spheres (xyz = center, w = radius) of a type's
+    // parts and of the whole tree, for GPU culling
+    void setTypeBounds(int type, const glm::vec4 partBounds[MAX_PARTS], const glm::vec4& bounds);
+
+    // Distance at which meshes start cross-fading to impostors, and over
+    // how far, for GPU culling
+    void setImpostorFade(float start, float range);
+
+    // Switches to culling on the GPU. Falls back to the CPU path (and
+    // isGpuCulling() stays false) without GL_ARB_shader_draw_parameters.
+    void setGpuCulling(bool enabled);
+    bool isGpuCulling() const { return m_gpuCulling && m_culler.isValid(); }
+
+    // Replaces every tree. bounds holds one world-space sphere per tree
+    // (xyz = center, w = radius) for culling the shadow views.
+    void setInstances(const std::vector<GPUTreeInstance>& instances, const std::vector<glm::vec4>& bounds);
+
+    // Drops the instances and mesh references
+    void clear();
+
+    // Queues one part of a tree for this frame's main view (main thread
+    // only). fade < 1 dithers the mesh out while its impostor fades in.
+    void addVisible(uint32_t instance, int part, int lod, float fade);
+
+    // GPU culling: culls the main view, replacing addVisible(). Once per
+    // frame before draw(); occlusionTexture comes from
+    // OcclusionCuller::uploadHierarchy() and may be 0.
+    void cull(const Camera& camera, float viewportHeight, GLuint occlusionTexture, bool impostors);
+
+    // GPU culling: draws the impostors picked by cull()
+    void drawImpostors(ImpostorAtlas& atlas, RenderStats& stats);
+
+    // Draws the queued parts. Expects the main view's blocks and material
+    // arrays to be bound; shader is the tree variant of the main shader.
+    void draw(ShaderProgram& shader, RenderStats& stats);
+
+    // Culls every tree against a shadow view and draws it depth-only. Trees
+    // queued for the main view reuse its LOD, the rest use their coarsest.
+    // Leaves depthShader bound.
+    void drawShadows(ShaderProgram& depthShader, const glm::vec4 planes[6], RenderStats& stats);
+
+    // Forgets this frame's visible list
+    void endFrame();
+
+    size_t getInstanceCount() const { return m_types.size(); }
+
+private:
+    static int groupIndex(int type, int part, int lod) { return (type * MAX_PARTS + part) * MAX_LODS + lod; }
+
+    // Uploads the groups as one visible list, binds shader and issues a draw
+    // per group. Returns the number of instances drawn.
+    int drawGroups(const std::vector<std::vector<uint32_t>>& groups, ShaderProgram& shader, bool materials,
+                   RenderStats& stats);
+
+    // Draws what a GPU cull left in result, one multi-draw per type and part
+    void drawCulled(const TreeCullResult& result, ShaderProgram& shader, bool materials, RenderStats& stats);
+
+    // Writes the type bounds and group draws for this frame's culls
+    void updateCullTable();
+
+    const Mesh* m_meshes[MAX_TYPES][MAX_PARTS] = {};
+    GPUTreeType m_typeBounds[MAX_TYPES] = {};
+
+    GpuBuffer m_instanceBuffer;
+
+    // CPU copies for culling shadow views
+    std::vector<uint8_t> m_types;
+    std::vector<glm::vec4> m_bounds;
+
+    // Per instance and part: LOD used by the main view this frame, 0xFF if
+    // the part is not visible
+    std::vector<uint8_t> m_frameLods;
+
+    // Packed visible entries per groupIndex()
+    std::vector<std::vector<uint32_t>> m_groups;
+    std::vector<std::vector<uint32_t>> m_shadowGroups;
+    std::vector<uint32_t> m_upload;
+
+    TreeCuller m_culler;
+    TreeCullResult m_mainView;   // This frame's GPU cull of the main view
+    bool m_cullTableWritten = false;
+    bool m_gpuCulling = false;
+    float m_impostorStart = 0.0f;
+    float m_impostorRange = 0.0f;
+
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
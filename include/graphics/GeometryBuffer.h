@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include "graphics/OffsetAllocator.h"
+
+namespace ExperimentRedbear {
+
+enum class VertexFormat {
+    MESH,   // Vertex (see Model.h)
+    COUNT
+};
+
+// Where a mesh lives inside its format's GeometryBuffer. Draw with
+// baseVertex and firstIndex (in indices, not bytes) against the shared VAO.
+struct GeometryRange {
+    GLint baseVertex = 0;
+    uint32_t firstIndex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+
+    OffsetAllocator::Allocation vertices;
+    OffsetAllocator::Allocation indices;
+
+    bool isValid() const { return vertices.isValid() && indices.isValid(); }
+};
+
+// One large vertex buffer and one index buffer shared by every mesh of a
+// vertex format, with a single VAO, so consecutive draws need no vertex
+// array switch and can be merged into multi-draws. Ranges are handed out
+// by OffsetAllocator; a full buffer grows in place, which keeps every
+// offset.
+//
+// The buffer remembers each range it handed out, so compact() can move
+// them and rewrite their offsets. Ranges therefore must not move in
+// memory while allocated (Mesh is non-copyable for this reason).
+class GeometryBuffer {
+public:
+    static GeometryBuffer& getInstance(VertexFormat format);
+
+    // Copies vertexCount vertices of the format and indexCount indices in.
+    // Indices are relative to the range's first vertex.
+    bool allocate(GeometryRange& range, const void* vertices, uint32_t vertexCount,
+                  const uint32_t* indices, uint32_t indexCount);
+
+    // Replaces the range's indices, e.g. after LODs were appended
+    bool reallocateIndices(GeometryRange& range, const uint32_t* indices, uint32_t indexCount);
+
+    void free(GeometryRange& range);
+
+    // Moves every range to the front of fresh buffers, so all free space is
+    // one block at the end. Deletes the old buffers: call between frames.
+    void compact();
+
+    // Share of the free space not in the largest free block, 0..1
+    float getFragmentation() const;
+
+    // Frees everything; ranges still allocated are reset to invalid
+    void shutdown();
+
+    GLuint getVAO() const { return m_vao; }
+    GLuint getVertexBuffer() const { return m_vertexBuffer; }
+    GLuint getIndexBuffer() const { return m_indexBuffer; }
+    uint32_t getVertexCapacity() const { return m_vertexAllocator.getSize(); }
+    uint32_t getIndexCapacity() const { return m_indexAllocator.getSize(); }
+
+    // Applies to every format
+    static void shutdownAll();
+    static void compactFragmented(float threshold);
+
+private:
+    GeometryBuffer();
+    ~GeometryBuffer();
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    bool create();
+    void setupVertexArray();
+
+    // Reallocates a buffer with room for capacity elements, keeping the
+    // first keepElements of its content
+    GLuint resizeBuffer(GLuint buffer, size_t elementSize, uint32_t capacity, uint32_t keepElements);
+
+    OffsetAllocator::Allocation allocateVertices(uint32_t count);
+    OffsetAllocator::Allocation allocateIndices(uint32_t count);
+
+    VertexFormat m_format = VertexFormat::MESH;
+    size_t m_stride = 0;
+
+    GLuint m_vao = 0;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+    OffsetAllocator m_vertexAllocator;
+    OffsetAllocator m_indexAllocator;
+
+    std::vector<GeometryRange*> m_ranges;
+};
+
+} // namespace ExperimentRedbear
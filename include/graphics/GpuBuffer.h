@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+// Thin wrapper around a GL buffer object used for uniform/storage blocks
+// that are rewritten every frame.
+class GpuBuffer {
+public:
+    GpuBuffer();
+    ~GpuBuffer();
+
+    GpuBuffer(const GpuBuffer&) = delete;
+    GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+    bool create(GLenum target, size_t size, GLenum usage = GL_DYNAMIC_DRAW);
+    void destroy();
+
+    // Writes data at offset. If the buffer is too small it is reallocated,
+    // which discards its previous contents.
+    void upload(const void* data, size_t size, size_t offset = 0);
+
+    // Binds the buffer to an indexed binding point (uniform/storage blocks)
+    void bindBase(GLuint index) const;
+
+    GLuint getID() const { return m_buffer; }
+    GLenum getTarget() const { return m_target; }
+    size_t getSize() const { return m_size; }
+
+    bool isValid() const { return m_buffer != 0; }
+
+private:
+    GLuint m_buffer = 0;
+    GLenum m_target = GL_UNIFORM_BUFFER;
+    GLenum m_usage = GL_DYNAMIC_DRAW;
+    size_t m_size = 0;
+};
+
+} // namespace ExperimentRedbear
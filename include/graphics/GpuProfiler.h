@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+enum class GpuPass {
+    SCENE = 0,
+    POST_PROCESS,
+    UI,
+    TEXT,        // Nested inside UI, from the first string to the last
+    SHADOWS,     // Nested inside SCENE
+    BLOOM,       // Nested inside POST_PROCESS
+    COUNT
+};
+
+constexpr int GPU_PASS_COUNT = static_cast<int>(GpuPass::COUNT);
+
+// Counters from GL_ARB_pipeline_statistics_query, per frame
+struct PipelineStatistics {
+    uint64_t verticesSubmitted = 0;
+    uint64_t primitivesSubmitted = 0;
+    uint64_t clippingOutputPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+};
+
+// Times named passes on the CPU and GPU. GPU timestamps go into a ring of
+// query sets that is read back FRAME_LATENCY frames later, only once the
+// results are available, so the profiler never stalls the pipeline.
+// Passes may be entered several times per frame; their times accumulate.
+class GpuProfiler {
+public:
+    static constexpr int FRAME_LATENCY = 4;
+    static constexpr int MAX_RANGES_PER_FRAME = 64;
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    bool initialize();
+    void shutdown();
+
+    // Closes the previous frame, collects the oldest results in the ring and
+    // starts recording a new frame
+    void beginFrame();
+
+    void beginPass(GpuPass pass);
+    void endPass(GpuPass pass);
+
+    // Milliseconds. CPU values are from the last completed frame, GPU values
+    // from the newest frame whose queries have resolved.
+    float getCpuTime(GpuPass pass) const { return m_cpuTimes[static_cast<int>(pass)]; }
+    float getGpuTime(GpuPass pass) const { return m_gpuTimes[static_cast<int>(pass)]; }
+
+    // Sum of the top-level passes (nested passes are already included)
+    float getCpuFrameTime() const;
+    float getGpuFrameTime() const;
+
+    bool hasPipelineStatistics() const { return m_pipelineStatsSupported; }
+    const PipelineStatistics& getPipelineStatistics() const { return m_pipelineStats; }
+
+    static const char* getPassName(GpuPass pass);
+
+private:
+    enum PipelineQuery {
+        QUERY_VERTICES = 0,
+        QUERY_PRIMITIVES,
+        QUERY_CLIPPED,
+        QUERY_FRAGMENTS,
+        PIPELINE_QUERY_COUNT
+    };
+
+    struct Range {
+        GpuPass pass;
+        int beginQuery;
+        int endQuery;
+    };
+
+    struct FrameQueries {
+        std::vector<GLuint> timestamps;
+        std::vector<Range> ranges;
+        int usedTimestamps = 0;
+        int openRanges[GPU_PASS_COUNT];
+        GLuint pipelineQueries[PIPELINE_QUERY_COUNT] = {};
+        bool pipelineActive = false;
+        bool pending = false;
+    };
+
+    void collect(FrameQueries& frame);
+    void endPipelineQueries(FrameQueries& frame);
+
+    FrameQueries m_frames[FRAME_LATENCY];
+    int m_frameIndex = 0;
+
+    using Clock = std::chrono::high_resolution_clock;
+    Clock::time_point m_cpuStart[GPU_PASS_COUNT];
+    float m_cpuAccum[GPU_PASS_COUNT] = {};
+
+    float m_cpuTimes[GPU_PASS_COUNT] = {};
+    float m_gpuTimes[GPU_PASS_COUNT] = {};
+    PipelineStatistics m_pipelineStats;
+
+    bool m_pipelineStatsSupported = false;
+    bool m_inFrame = false;
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
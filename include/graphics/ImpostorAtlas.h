@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/Shader.h"
+
+namespace ExperimentRedbear {
+
+class Mesh;
+struct RenderStats;
+
+// A mesh drawn in one flat color while baking, scaled in model space
+struct ImpostorPart {
+    const Mesh* mesh = nullptr;
+    glm::vec3 color = glm::vec3(1.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// One impostor variant. center/radius bound every part in model space.
+struct ImpostorSource {
+    std::vector<ImpostorPart> parts;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 1.0f;
+};
+
+// Per instance data of the billboard pass (matches the vertex attributes)
+struct ImpostorInstance {
+    glm::vec4 positionScale;   // xyz = model origin, w = uniform scale
+    glm::vec4 params;          // x = yaw in radians, y = variant, z = fade in (0..1)
+};
+
+// Octahedral impostors. Every variant is rendered offscreen from a grid of
+// views spread over the upper hemisphere (hemi-octahedral mapping) into an
+// albedo and a normal+depth texture array, one layer per variant. At draw
+// time each instance becomes a camera-facing quad showing the nearest view.
+class ImpostorAtlas {
+public:
+    static constexpr int FRAMES_PER_SIDE = 8;
+    static constexpr int FRAME_SIZE = 128;
+    static constexpr int MAX_VARIANTS = 8;
+
+    ImpostorAtlas();
+    ~ImpostorAtlas();
+
+    // Builds the shaders and billboard geometry; keeps baked layers if
+    // already initialized
+    bool initialize();
+    void shutdown();
+
+    // Renders every variant into the atlas, replacing previous contents
+    bool bake(const std::vector<ImpostorSource>& variants);
+
+    // One instanced draw for all instances. Expects the frame constants and
+    // lights of the current frame to be bound.
+    void draw(const std::vector<ImpostorInstance>& instances, RenderStats& stats);
+
+    // Same for instances written on the GPU: instanceBuffer holds
+    // ImpostorInstances and drawBuffer a DrawArraysIndirectCommand at
+    // drawOffset. The instance count is not known here, so impostorsDrawn
+    // is left alone.
+    void drawIndirect(GLuint instanceBuffer, GLuint drawBuffer, GLintptr drawOffset, RenderStats& stats);
+
+    bool isBaked() const { return m_variantCount > 0; }
+    int getVariantCount() const { return m_variantCount; }
+
+private:
+    void createShaders();
+
+    GLuint m_albedoTexture = 0;
+    GLuint m_normalDepthTexture = 0;
+    GLuint m_bakeFBO = 0;
+    GLuint m_bakeDepth = 0;
+
+    GLuint m_quadVAO = 0;
+    GLuint m_quadVBO = 0;
+
+    std::unique_ptr<ShaderProgram> m_bakeShader;
+    std::unique_ptr<ShaderProgram> m_drawShader;
+
+    // xyz = bounding center, w = radius, per variant
+    std::vector<glm::vec4> m_variantBounds;
+    int m_variantCount = 0;
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
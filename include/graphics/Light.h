@@ -29,7 +29,10 @@ struct Light {
 
     // Shadows
     bool castShadows = true;
-    int shadowMapResolution = 1024;
+    int shadowMapResolution = 1024;    // Largest atlas tile this light may get
+    bool staticShadows = true;         // Cache the shadow map while nothing moves
+    float shadowBias = 0.0005f;        // Depth bias in NDC
+    float shadowNormalBias = 0.02f;    // World-space offset along the surface normal
 
     // Animation
     bool animated = false;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "graphics/Camera.h"
+#include "graphics/Light.h"
+#include "graphics/ShaderInterface.h"
+
+namespace ExperimentRedbear {
+
+// Clustered forward lighting. The view frustum is split into a grid of
+// froxels (screen tiles x exponential depth slices). Every frame each local
+// light is assigned to the froxels its range overlaps, and the fragment
+// shader only evaluates the lights of its own froxel.
+class LightClusterGrid {
+public:
+    static constexpr int GRID_X = 16;
+    static constexpr int GRID_Y = 9;
+    static constexpr int GRID_Z = 24;
+    static constexpr int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    LightClusterGrid();
+    ~LightClusterGrid();
+
+    bool initialize();
+    void shutdown();
+
+    // Assigns lights to clusters, writes the light, cluster and index lists
+    // to the frame's stream buffer and binds them.
+    // maxDistance limits the depth range that is sliced (e.g. the fog distance).
+    // shadowTiles holds each light's first shadow atlas tile, or 0 for the
+    // cascaded directional light (-1 = none), and may be empty.
+    void build(const Camera& camera, const std::vector<Light>& lights,
+               int viewportWidth, int viewportHeight, float maxDistance,
+               const std::vector<int>& shadowTiles);
+
+    // Values for the clusterGrid/clusterParams members of GPUFrameConstants
+    glm::uvec4 getGridInfo() const;
+    glm::vec4 getGridParams() const;
+
+    int getLightCount() const { return static_cast<int>(m_gpuLights.size()); }
+    int getIndexCount() const { return static_cast<int>(m_lightIndices.size()); }
+
+    static GPULight packLight(const Light& light, int shadowTile = -1);
+
+private:
+    struct ClusterRange {
+        uint32_t lightIndex;
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+
+    int sliceForDepth(float depth) const;
+    bool computeTileRange(const glm::vec3& viewCenter, float radius, const glm::mat4& projection,
+                          ClusterRange& range) const;
+
+    std::vector<GPULight> m_gpuLights;
+    std::vector<ClusterRange> m_ranges;
+    std::vector<uint32_t> m_clusterCounts;
+    std::vector<glm::uvec2> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+
+    uint32_t m_directionalCount = 0;
+    float m_nearPlane = 0.1f;
+    float m_farPlane = 100.0f;
+    float m_sliceScale = 1.0f;
+    float m_sliceBias = 0.0f;
+    glm::vec2 m_tileSize = glm::vec2(1.0f);
+};
+
+} // namespace ExperimentRedbear
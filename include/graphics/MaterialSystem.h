@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/GpuBuffer.h"
+#include "graphics/ShaderInterface.h"
+
+namespace ExperimentRedbear {
+
+struct MaterialDesc {
+    std::string diffusePath;
+    std::string normalPath;
+    glm::vec4 baseColor = glm::vec4(1.0f);
+};
+
+// Owns every material texture and the material SSBO. Textures are copied
+// into GL_TEXTURE_2D_ARRAYs bucketed by size and color space, so a draw
+// only needs a material index: with ARB_bindless_texture the materials hold
+// array handles, otherwise the arrays sit on fixed units for the whole frame.
+class MaterialSystem {
+public:
+    static constexpr uint32_t NO_MATERIAL = 0xFFFFFFFFu;
+
+    MaterialSystem();
+    ~MaterialSystem();
+
+    // Keeps existing materials if already initialized
+    bool initialize();
+    void shutdown();
+
+    // Loads the material's textures (each file only once) and returns its
+    // index, which stays valid until shutdown
+    uint32_t createMaterial(const MaterialDesc& desc);
+
+    // Builds the mipmaps of arrays that gained layers, uploads changed
+    // materials and makes the arrays available to shaders. Returns the
+    // number of texture binds it issued.
+    int bind();
+
+    // Texture arrays sampled for the material's diffuse and normal
+    // textures, -1 if none. Draws merged into one multi-draw must agree on
+    // both, so the samplers (or handles) they pick stay dynamically uniform.
+    int getDiffuseArray(uint32_t materialIndex) const;
+    int getNormalArray(uint32_t materialIndex) const;
+
+    // Lines to insert after #version in programs that use materials
+    std::string getShaderHeader() const;
+
+    bool isBindless() const { return m_bindless; }
+    size_t getMaterialCount() const { return m_materials.size(); }
+    size_t getArrayCount() const { return m_arrays.size(); }
+
+private:
+    struct TextureArray {
+        GLuint texture = 0;
+        GLuint64 handle = 0;
+        int width = 0;
+        int height = 0;
+        int levels = 1;
+        int layers = 0;
+        int capacity = 0;
+        bool srgb = false;
+        bool mipmapsDirty = false;   // Layers added since the last bind()
+    };
+
+    struct TextureRef {
+        int array = -1;
+        int layer = 0;
+    };
+
+    struct Material {
+        TextureRef diffuse;
+        TextureRef normal;
+        glm::vec4 baseColor;
+    };
+
+    TextureRef loadTexture(const std::string& path, bool srgb);
+    TextureRef addTexture(const unsigned char* rgba, int width, int height, bool srgb);
+    void growArray(TextureArray& array);
+    void releaseHandle(TextureArray& array);
+    glm::uvec4 packRef(const TextureRef& ref) const;
+
+    std::vector<TextureArray> m_arrays;
+    std::vector<Material> m_materials;
+    std::unordered_map<std::string, TextureRef> m_textureCache;
+
+    std::vector<GPUMaterial> m_gpuMaterials;
+    GpuBuffer m_materialBuffer;
+
+    bool m_dirty = true;
+    bool m_bindless = false;
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace ExperimentRedbear {
+
+struct Vertex;
+
+// One level of a mesh LOD chain. All levels share the mesh's vertex buffer
+// and live back to back in its index buffer.
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;   // Geometric error relative to the mesh's bounding radius
+};
+
+// Quadric error edge-collapse simplifier (Garland & Heckbert). Vertices
+// collapse onto one of the edge's endpoints, so simplified index lists can
+// keep using the original vertex buffer.
+class MeshSimplifier {
+public:
+    // Largest on-screen error, in pixels, a selected LOD may have
+    static constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+    // A coarser level must be this much under the error limit before it is
+    // picked, so objects near a switch distance don't flicker between levels
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+
+    // Simplifies the triangle list until it has at most targetIndexCount
+    // indices or the next collapse would move the surface further than
+    // maxError (world units). Returns the new index list and writes the
+    // reached error to outError.
+    static std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices,
+                                              const std::vector<unsigned int>& indices,
+                                              size_t targetIndexCount, float maxError,
+                                              float* outError = nullptr);
+
+    // Builds up to maxLevels levels, each with about reduction times the
+    // triangles of the previous one, stopping at minTriangles or when a
+    // level stops shrinking. indices is replaced by all levels concatenated;
+    // level 0 is the original mesh.
+    static std::vector<MeshLod> buildLodChain(const std::vector<Vertex>& vertices,
+                                              std::vector<unsigned int>& indices,
+                                              int maxLevels = 4, float reduction = 0.5f,
+                                              size_t minTriangles = 64);
+
+    // Coarsest level whose error stays under LOD_PIXEL_ERROR for an object
+    // screenSize pixels across. current is the level picked last frame.
+    static int selectLod(const MeshLod* lods, int lodCount, float screenSize, int current);
+};
+
+} // namespace ExperimentRedbear
@@ -3,11 +3,16 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
+#include "graphics/MeshSimplifier.h"
+#include "graphics/GeometryBuffer.h"
 
 namespace ExperimentRedbear {
 
+class MaterialSystem;
+
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
@@ -22,32 +27,51 @@ struct Texture {
     std::string path;
 };
 
+// Geometry lives in the shared GeometryBuffer for VertexFormat::MESH; the
+// mesh only keeps its range there
 class Mesh {
 public:
     Mesh();
     ~Mesh();
 
+    // The geometry buffer holds a pointer to m_geometry
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
     void create(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, 
                 const std::vector<Texture>& textures);
-    void draw() const;
-    void drawInstanced(int count) const;
-
-    GLuint getVAO() const { return m_vao; }
-    size_t getIndexCount() const { return m_indices.size(); }
+    void draw(int lod = 0) const;
+    void drawInstanced(int count, int lod = 0) const;
+
+    // Appends simplified levels to the index buffer (see MeshSimplifier)
+    void generateLods(int maxLevels = 4, float reduction = 0.5f, size_t minTriangles = 64);
+    const std::vector<MeshLod>& getLods() const { return m_lods; }
+
+    // Shared by every mesh. LOD index offsets are relative to getFirstIndex().
+    GLuint getVAO() const { return GeometryBuffer::getInstance(VertexFormat::MESH).getVAO(); }
+    GLint getBaseVertex() const { return m_geometry.baseVertex; }
+    uint32_t getFirstIndex() const { return m_geometry.firstIndex; }
+    size_t getIndexCount() const { return m_lods.empty() ? 0 : m_lods[0].indexCount; }
     size_t getVertexCount() const { return m_vertices.size(); }
 
     const std::vector<Texture>& getTextures() const { return m_textures; }
 
+    // Registers the mesh's texture paths as a material. Once set, draw()
+    // no longer binds the per-mesh textures.
+    void createMaterial(MaterialSystem& materials);
+    void setMaterialIndex(uint32_t index) { m_materialIndex = index; }
+    uint32_t getMaterialIndex() const { return m_materialIndex; }
+
 private:
     void setupMesh();
 
     std::vector<Vertex> m_vertices;
-    std::vector<unsigned int> m_indices;
+    std::vector<unsigned int> m_indices;   // Every LOD level, back to back
+    std::vector<MeshLod> m_lods;
     std::vector<Texture> m_textures;
+    uint32_t m_materialIndex = 0xFFFFFFFFu;
 
-    GLuint m_vao = 0;
-    GLuint m_vbo = 0;
-    GLuint m_ebo = 0;
+    GeometryRange m_geometry;
 };
 
 class Model {
@@ -59,6 +83,9 @@ public:
     void draw() const;
     void drawInstanced(int count) const;
 
+    void createMaterials(MaterialSystem& materials);
+    void generateLods(int maxLevels = 4, float reduction = 0.5f, size_t minTriangles = 64);
+
     const std::vector<std::unique_ptr<Mesh>>& getMeshes() const { return m_meshes; }
     const glm::vec3& getMinBounds() const { return m_minBounds; }
     const glm::vec3& getMaxBounds() const { return m_maxBounds; }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/RenderQueue.h"
+
+namespace ExperimentRedbear {
+
+// Axis-aligned box that fully blocks the view (wall segment, tree trunk)
+struct Occluder {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Software occlusion culling. The most significant occluders near the
+// camera are rasterized into a small CPU depth buffer on a worker thread
+// while the main thread renders shadows, then reduced to a max-depth
+// hierarchy. Render command bounds are tested against the coarsest level
+// that still covers them in a few texels.
+class OcclusionCuller {
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    static constexpr int LEVEL_COUNT = 5;           // 256x128 down to 16x8
+    static constexpr int MAX_OCCLUDERS_PER_FRAME = 96;
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // Starts the worker thread (no-op if it is already running)
+    bool initialize();
+    void shutdown();
+
+    // Occluders are world-space and static. Must not be called between
+    // beginFrame() and cull().
+    void setOccluders(const std::vector<Occluder>& occluders);
+    size_t getOccluderCount() const { return m_occluders.size(); }
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+    // Hands this frame's view to the worker, which starts rasterizing
+    void beginFrame(const glm::mat4& viewProjection, const glm::vec3& viewPosition);
+
+    // Waits for the worker, then hides every visible, bounded command that
+    // is behind the occluders. Returns the number hidden.
+    size_t cull(RenderQueue& queue);
+
+    // Copies this frame's hierarchy into a mipmapped R32F texture (level n
+    // = hierarchy level n) for culling on the GPU. Call after cull();
+    // returns 0 if there is no hierarchy this frame.
+    GLuint uploadHierarchy();
+
+private:
+    struct ScreenVertex {
+        float x, y, z;
+    };
+
+    void workerLoop();
+    void waitForWorker();
+
+    void rasterizeOccluders();
+    void rasterizeBox(const Occluder& occluder);
+    void rasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2);
+    void buildHierarchy();
+
+    bool isOccluded(const glm::vec3& center, float radius) const;
+
+    std::vector<Occluder> m_occluders;
+    std::vector<float> m_levels[LEVEL_COUNT];   // Max depth per texel, level 0 is the raster
+    GLuint m_texture = 0;                       // Created on the first upload
+
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    glm::vec3 m_viewPosition = glm::vec3(0.0f);
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobDone;
+    bool m_jobPending = false;
+    bool m_jobRunning = false;
+    bool m_hasResult = false;
+    bool m_quit = false;
+    bool m_enabled = true;
+};
+
+} // namespace ExperimentRedbear
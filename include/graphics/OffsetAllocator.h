@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ExperimentRedbear {
+
+// Hands out ranges of a linear space (e.g. elements of a GPU buffer) without
+// touching the memory itself. TLSF-style: free blocks sit in segregated
+// lists of 8 bins per power of two, and a bitmap over the bins finds a
+// block that fits in constant time. Freed blocks merge with free
+// neighbours straight away, so free space never splits into adjacent
+// pieces.
+class OffsetAllocator {
+public:
+    static constexpr uint32_t NO_SPACE = 0xFFFFFFFFu;
+
+    struct Allocation {
+        uint32_t offset = NO_SPACE;
+        uint32_t node = NO_SPACE;   // Opaque, for free()
+
+        bool isValid() const { return offset != NO_SPACE; }
+    };
+
+    OffsetAllocator();
+    ~OffsetAllocator();
+
+    // Forgets every allocation; the whole space is one free block
+    void reset(uint32_t size);
+
+    // Invalid if no free block is large enough
+    Allocation allocate(uint32_t size);
+    void free(const Allocation& allocation);
+
+    // Adds space at the end, merging it with a free block already there
+    void grow(uint32_t newSize);
+
+    uint32_t getSize() const { return m_size; }
+    uint32_t getFreeSize() const { return m_freeSize; }
+    uint32_t getLargestFreeBlock() const;
+
+private:
+    static constexpr uint32_t BIN_COUNT = 256;
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        bool used = false;
+        uint32_t prevPhysical = NONE;   // Neighbours by address
+        uint32_t nextPhysical = NONE;
+        uint32_t prevFree = NONE;       // Within the bin's free list
+        uint32_t nextFree = NONE;
+    };
+
+    // Bin holding blocks of this size (rounds down)
+    static uint32_t binForSize(uint32_t size);
+    // Smallest size that lands in the bin
+    static uint32_t binMinimum(uint32_t bin);
+    // First non-empty bin at or after bin, NONE if there is none
+    uint32_t findBin(uint32_t bin) const;
+
+    uint32_t createNode();
+    void releaseNode(uint32_t node);
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_spareNodes;
+    uint32_t m_binHeads[BIN_COUNT];
+    uint64_t m_binBits[BIN_COUNT / 64] = {};
+    uint32_t m_lastNode = NONE;   // Highest offset
+    uint32_t m_size = 0;
+    uint32_t m_freeSize = 0;
+};
+
+} // namespace ExperimentRedbear
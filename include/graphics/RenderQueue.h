@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+class ShaderProgram;
+class Camera;
+struct MeshLod;
+
+struct RenderCommand {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    GLuint textureID;
+    ShaderProgram* shader;
+    glm::mat4 modelMatrix;
+    int indexCount;
+    bool indexed;
+
+    // Position in a shared GeometryBuffer (see Mesh::getBaseVertex).
+    // firstIndex counts indices; for non-indexed draws it is the first vertex.
+    GLint baseVertex = 0;
+    uint32_t firstIndex = 0;
+
+    // World-space bounding sphere. A negative radius means unbounded
+    // (never culled).
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = -1.0f;
+
+    // Draw order bucket (lower passes draw first) and blending. Transparent
+    // commands are drawn after all opaque ones of the same pass.
+    uint8_t pass = 0;
+    bool transparent = false;
+
+    // Moves between frames. Cached shadow maps are only invalidated by
+    // dynamic casters; static geometry is assumed not to change.
+    bool dynamic = false;
+
+    // Index into the renderer's MaterialSystem. When set the draw needs no
+    // texture binds and textureID is ignored.
+    uint32_t materialIndex = 0xFFFFFFFFu;
+
+    // Optional LOD chain (see Mesh::getLods). When set the level picked
+    // during culling replaces indexCount. lodState is the caller's per
+    // instance byte that remembers the level between frames.
+    const MeshLod* lods = nullptr;
+    uint8_t lodCount = 0;
+    uint8_t* lodState = nullptr;
+
+    // Below 1 the command is dithered out while a replacement (e.g. an
+    // impostor) fades in with 1 - fade
+    float fade = 1.0f;
+};
+
+// Draws casters kept outside the queue (e.g. instanced geometry) into a
+// shadow view, given its view-projection and frustum planes
+using ShadowCasterCallback = std::function<void(const glm::mat4& viewProjection, const glm::vec4 planes[6])>;
+
+// Per-frame list of render commands. Bounding spheres are mirrored in
+// structure-of-arrays form so the whole queue can be culled with SIMD.
+class RenderQueue {
+public:
+    RenderQueue();
+    ~RenderQueue();
+
+    // Packs a 64-bit sort key, most significant first:
+    //   opaque:      pass(4) | 0 | shader(12) | material(16) | depth(24)
+    //   transparent: pass(4) | 1 | ~depth(24) | shader(12) | material(16)
+    // Opaque commands batch by state and then go front-to-back for early-Z,
+    // transparent ones go strictly back-to-front. depth is normalised to [0, 1].
+    static uint64_t makeSortKey(const RenderCommand& command, float depth);
+
+    void push(const RenderCommand& command, uint64_t sortKey);
+    void clear();
+
+    // Appends another queue's commands (e.g. a worker thread's bucket)
+    void append(const RenderQueue& other);
+
+    size_t size() const { return m_commands.size(); }
+    bool empty() const { return m_commands.empty(); }
+
+    const RenderCommand& operator[](size_t index) const { return m_commands[index]; }
+    const std::vector<RenderCommand>& getCommands() const { return m_commands; }
+
+    // Tests every bounding sphere against six planes (xyz = inward normal,
+    // w = distance) and fills the visibility mask. Returns the visible count.
+    // Large queues are culled in parallel on the job system.
+    size_t cull(const glm::vec4 planes[6]);
+
+    // One byte per command, non-zero if visible. Valid after cull().
+    const std::vector<uint8_t>& getVisibility() const { return m_visibility; }
+
+    // Marks a command hidden after cull(), e.g. when it is occluded
+    void hide(size_t index) { m_visibility[index] = 0; }
+
+    // Picks a LOD level for every visible command with a LOD chain from its
+    // projected size. Call after cull() and any hide().
+    void selectLods(const Camera& camera, float viewportHeight);
+
+    // Selected level of a command, 0 without a chain. Valid after selectLods().
+    int getLodLevel(size_t index) const { return index < m_lodLevels.size() ? m_lodLevels[index] : 0; }
+
+    // Compacts the visible commands and radix sorts them by key. Returns
+    // indices into the queue in draw order.
+    const std::vector<uint32_t>& sortVisible();
+
+private:
+    std::vector<RenderCommand> m_commands;
+
+    // SoA bounds for the cull pass
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_radius;
+
+    std::vector<uint8_t> m_visibility;
+    std::vector<uint8_t> m_lodLevels;
+
+    std::vector<uint64_t> m_sortKeys;
+
+    // Radix sort buffers (ping-ponged between passes)
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_orderScratch;
+    std::vector<uint64_t> m_keys;
+    std::vector<uint64_t> m_keysScratch;
+};
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+// Shadow of the GL state that draw code sets over and over: program, vertex
+// array, buffer bindings, texture units, samplers, blend, depth and cull
+// state. Calls that wouldn't change anything are dropped and counted.
+//
+// The cache only knows what went through it. Setup code (resource creation,
+// the impostor bake) still binds directly and must be followed by
+// invalidate(), which Renderer also does at the start of every frame.
+// Deleting a bound object has the same effect (GL unbinds it and the name
+// may be reused), so deletion also happens outside the frame.
+// Textures go through glBindTextureUnit, so the active texture unit is
+// never part of the tracked state.
+class RenderState {
+public:
+    static constexpr int MAX_TEXTURE_UNITS = 32;
+    static constexpr int MAX_BUFFER_BINDINGS = 16;   // Per indexed target
+
+    static RenderState& getInstance();
+
+    // Forget everything; the next call of each kind is issued
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+
+    // ARRAY, DRAW_INDIRECT, DISPATCH_INDIRECT and PARAMETER buffers are
+    // tracked, anything else is passed through. ELEMENT_ARRAY_BUFFER is
+    // vertex array state and must be bound directly.
+    void bindBuffer(GLenum target, GLuint buffer);
+
+    // UNIFORM and SHADER_STORAGE bindings are tracked, ranges included
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    void bindTexture(GLuint unit, GLuint texture);
+    void bindSampler(GLuint unit, GLuint sampler);
+
+    // BLEND, DEPTH_TEST, CULL_FACE, SCISSOR_TEST and POLYGON_OFFSET_FILL are
+    // tracked, other capabilities are passed through
+    void setEnabled(GLenum capability, bool enabled);
+    void enable(GLenum capability) { setEnabled(capability, true); }
+    void disable(GLenum capability) { setEnabled(capability, false); }
+
+    void blendFunc(GLenum source, GLenum destination);
+    void depthFunc(GLenum func);
+    void depthMask(bool write);
+    void cullFace(GLenum face);
+
+    // Calls since resetCounters()
+    uint32_t getIssuedCount() const { return m_issued; }
+    uint32_t getElidedCount() const { return m_elided; }
+    void resetCounters();
+
+private:
+    RenderState();
+    ~RenderState();
+    RenderState(const RenderState&) = delete;
+    RenderState& operator=(const RenderState&) = delete;
+
+    static constexpr GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    enum Capability { CAP_BLEND, CAP_DEPTH_TEST, CAP_CULL_FACE, CAP_SCISSOR_TEST, CAP_POLYGON_OFFSET_FILL, CAP_COUNT };
+    enum Buffer { BUFFER_ARRAY, BUFFER_DRAW_INDIRECT, BUFFER_DISPATCH_INDIRECT, BUFFER_PARAMETER, BUFFER_COUNT };
+
+    // Size 0 is a whole-buffer binding
+    struct BufferRange {
+        GLuint buffer = UNKNOWN;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    BufferRange* findIndexed(GLenum target, GLuint index);
+
+    // True when value already matches; otherwise stores it and counts an
+    // issued call
+    bool matches(GLuint& tracked, GLuint value);
+
+    GLuint m_program = UNKNOWN;
+    GLuint m_vertexArray = UNKNOWN;
+    GLuint m_buffers[BUFFER_COUNT];
+    BufferRange m_uniformBuffers[MAX_BUFFER_BINDINGS];
+    BufferRange m_storageBuffers[MAX_BUFFER_BINDINGS];
+    GLuint m_textures[MAX_TEXTURE_UNITS];
+    GLuint m_samplers[MAX_TEXTURE_UNITS];
+    GLuint m_capabilities[CAP_COUNT];
+    GLuint m_blendSource = UNKNOWN;
+    GLuint m_blendDestination = UNKNOWN;
+    GLuint m_depthFunc = UNKNOWN;
+    GLuint m_depthMask = UNKNOWN;
+    GLuint m_cullFace = UNKNOWN;
+
+    uint32_t m_issued = 0;
+    uint32_t m_elided = 0;
+};
+
+} // namespace ExperimentRedbear
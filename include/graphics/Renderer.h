@@ -8,6 +8,20 @@
 #include "graphics/Camera.h"
 #include "graphics/Light.h"
 #include "graphics/Shader.h"
+#include "graphics/GpuBuffer.h"
+#include "graphics/ShaderInterface.h"
+#include "graphics/LightCluster.h"
+#include "graphics/RenderQueue.h"
+#include "graphics/GpuProfiler.h"
+#include "graphics/ShadowAtlas.h"
+#include "graphics/CascadedShadowMap.h"
+#include "graphics/OcclusionCuller.h"
+#include "graphics/MaterialSystem.h"
+#include "graphics/ImpostorAtlas.h"
+#include "graphics/ForestRenderer.h"
+#include "graphics/Terrain.h"
+#include "graphics/Bloom.h"
+#include "graphics/DynamicResolution.h"
 
 namespace ExperimentRedbear {
 
@@ -17,8 +31,27 @@ struct RenderStats {
     int triangles = 0;
     int textureBindings = 0;
     int shaderBinds = 0;
+    int commandsSubmitted = 0;
+    int commandsCulled = 0;
+    int commandsOccluded = 0;
+    int commandsBatched = 0;        // Merged into multi-draws
+    int shadowTilesRendered = 0;
+    int shadowTilesCached = 0;
+    int shadowCascadesRendered = 0;
+    int impostorsDrawn = 0;
+    int treeInstancesDrawn = 0;
+    float resolutionScale = 1.0f;   // Scene resolution relative to the window
+    int stateChangesIssued = 0;     // Previous frame, through RenderState
+    int stateChangesElided = 0;
+    int streamKilobytes = 0;        // Previous frame, through StreamBuffer
+    bool streamStalled = false;     // Had to wait for the GPU to reuse its region
     float cpuTime = 0.0f;
     float gpuTime = 0.0f;
+
+    // Milliseconds per GpuPass. GPU values lag a few frames behind.
+    float passCpuTime[GPU_PASS_COUNT] = {};
+    float passGpuTime[GPU_PASS_COUNT] = {};
+    PipelineStatistics pipeline;
 };
 
 struct RenderSettings {
@@ -31,21 +64,26 @@ struct RenderSettings {
     glm::vec3 fogColor = glm::vec3(0.1f, 0.1f, 0.12f);
     float fogNear = 10.0f;
     float fogFar = 100.0f;
-    bool bloom = false;  // Disabled by default
+    bool bloom = false;  // Disabled by default; also enables the other post effects
     float bloomIntensity = 0.5f;
+    float bloomThreshold = 1.0f;
+    float bloomKnee = 0.5f;
+    float vignetteIntensity = 0.5f;
+    float saturation = 1.0f;
+    bool filmGrain = true;
+
+    // Scales the scene resolution to keep the GPU frame under
+    // targetFrameTime (ms); the post pass upscales to the window
+    bool dynamicResolution = false;
+    float targetFrameTime = 16.6f;
+    float minResolutionScale = 0.5f;
+    float maxResolutionScale = 1.0f;
     bool ssao = true;
     float ssaoRadius = 0.5f;
-};
 
-struct RenderCommand {
-    GLuint vao;
-    GLuint vbo;
-    GLuint ebo;
-    GLuint textureID;
-    ShaderProgram* shader;
-    glm::mat4 modelMatrix;
-    int indexCount;
-    bool indexed;
+    // Culls and picks LODs for the instanced trees in compute shaders
+    // (needs GL_ARB_shader_draw_parameters, else the CPU path is used)
+    bool gpuTreeCulling = false;
 };
 
 class Renderer {
@@ -65,6 +103,9 @@ public:
     void setCamera(Camera* camera);
     Camera* getCamera() const { return m_camera; }
 
+    // Safe from the main thread and from JobSystem workers: each thread
+    // records into its own bucket, which flush() merges before culling.
+    // Only flush() touches GL, so it must run on the context thread.
     void submit(const RenderCommand& command);
     void flush();
 
@@ -75,6 +116,9 @@ public:
     void clearLights();
     const std::vector<Light>& getLights() const { return m_lights; }
 
+    // Shadows
+    void invalidateShadowCache();
+
     // Post-processing
     void enablePostProcessing(bool enabled);
     void setPostProcessingParams(float bloom, float vignette, float saturation);
@@ -86,6 +130,18 @@ public:
     // Stats
     const RenderStats& getStats() const { return m_stats; }
     void resetStats();
+    GpuProfiler& getProfiler() { return m_profiler; }
+
+    // Occlusion
+    OcclusionCuller& getOcclusionCuller() { return m_occlusionCuller; }
+    MaterialSystem& getMaterials() { return m_materials; }
+    ImpostorAtlas& getImpostors() { return m_impostors; }
+    ForestRenderer& getForestRenderer() { return m_forestRenderer; }
+    Terrain& getTerrain() { return m_terrain; }
+
+    // Queues an impostor billboard for this frame (main thread only). All
+    // of them are drawn in one instanced pass after the render queue.
+    void submitImpostor(const ImpostorInstance& instance) { m_impostorInstances.push_back(instance); }
 
     // Utility
     void drawQuad();
@@ -95,22 +151,34 @@ public:
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
 
+    // Size the scene is rendered at this frame (see dynamic resolution)
+    int getRenderWidth() const { return m_renderWidth; }
+    int getRenderHeight() const { return m_renderHeight; }
+
 private:
     Renderer() = default;
     ~Renderer() = default;
     Renderer(const Renderer&) = delete;
     Renderer& operator=(const Renderer&) = delete;
 
+    void setupUniformBuffers();
+    void setupShadows();
     void setupDefaultShaders();
+    void prepareProgram(std::unique_ptr<ShaderProgram>& program);
     void setupPostProcessing();
     void renderPostProcessing();
 
+    void uploadFrameConstants();
+
     int m_width = 0;
     int m_height = 0;
+    int m_renderWidth = 0;
+    int m_renderHeight = 0;
 
     Camera* m_camera = nullptr;
 
-    std::vector<RenderCommand> m_commandQueue;
+    RenderQueue m_commandQueue;
+    std::vector<RenderQueue> m_threadBuckets;   // [JobSystem thread index], 0 unused
     std::vector<Light> m_lights;
     glm::vec3 m_ambientColor = glm::vec3(0.02f);
     float m_ambientIntensity = 1.0f;
@@ -121,14 +189,38 @@ private:
     // Shaders
     std::unique_ptr<ShaderProgram> m_mainShader;
     std::unique_ptr<ShaderProgram> m_shadowShader;
+    std::unique_ptr<ShaderProgram> m_treeShader;         // m_mainShader with TREE_INSTANCING
+    std::unique_ptr<ShaderProgram> m_indirectShader;     // m_mainShader with DRAW_INDIRECT, if supported
+    std::unique_ptr<ShaderProgram> m_treeShadowShader;
+    std::unique_ptr<ShaderProgram> m_terrainShader;      // Terrain vertex stage + main fragment
     std::unique_ptr<ShaderProgram> m_postProcessShader;
     std::unique_ptr<ShaderProgram> m_skyShader;
     std::unique_ptr<ShaderProgram> m_particleShader;
 
+    // Shared uniform/storage blocks (see ShaderInterface.h). Frame constants
+    // and the light lists are rewritten every frame through StreamBuffer.
+    LightClusterGrid m_lightGrid;
+
+    GpuProfiler m_profiler;
+    OcclusionCuller m_occlusionCuller;
+    MaterialSystem m_materials;
+    ImpostorAtlas m_impostors;
+    std::vector<ImpostorInstance> m_impostorInstances;
+    ForestRenderer m_forestRenderer;
+    Terrain m_terrain;
+
+    ShadowAtlas m_shadowAtlas;
+    CascadedShadowMap m_cascadedShadows;
+    std::vector<int> m_lightShadows;
+
     // Post-processing
     GLuint m_postFBO = 0;
     GLuint m_postTexture = 0;
     GLuint m_postDepthBuffer = 0;
+    Bloom m_bloom;
+    DynamicResolution m_dynamicResolution;
+    bool m_offscreen = false;   // Scene goes through the post target this frame
+    uint32_t m_postFrame = 0;
     GLuint m_quadVAO = 0;
     GLuint m_quadVBO = 0;
 
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
@@ -15,66 +20,169 @@ enum class ShaderType {
     COMPUTE = GL_COMPUTE_SHADER
 };
 
+// Uniform or block name, hashed (FNV-1a). Declare IDs as constexpr
+// constants (see UniformName) so the hash is computed at compile time; the
+// constructor is explicit so a literal can't be hashed again on every call.
+// Arrays are looked up by their bare name ("weights", not "weights[0]").
+struct UniformID {
+    uint32_t hash;
+    const char* name;   // For diagnostics
+
+    explicit constexpr UniformID(const char* uniformName) : hash(hashName(uniformName)), name(uniformName) {}
+
+    static constexpr uint32_t hashName(const char* text, size_t length = static_cast<size_t>(-1)) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < length && text[i] != '\0'; i++) {
+            h ^= static_cast<uint8_t>(text[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+};
+
+// A single stage. Loading only keeps the source; it is compiled by
+// ShaderProgram::link, and only when the program isn't in the ShaderCache.
 class Shader {
 public:
     Shader();
     ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
 
     bool loadFromFile(const std::string& filepath, ShaderType type);
     bool loadFromSource(const std::string& source, ShaderType type);
 
+    // compile() blocks. beginCompile() only submits the source; with
+    // KHR_parallel_shader_compile the driver compiles it in the background
+    // and finishCompile() must not be called before the owning program
+    // reports completion.
+    bool compile();
+    void beginCompile();
+    bool finishCompile();
+
     GLuint getID() const { return m_shaderID; }
     ShaderType getType() const { return m_type; }
+    const std::string& getSource() const { return m_source; }
+    const std::string& getPath() const { return m_path; }   // Empty unless loaded from a file
 
+    bool isLoaded() const { return !m_source.empty(); }
     bool isCompiled() const { return m_compiled; }
     std::string getCompileLog() const { return m_compileLog; }
 
 private:
-    bool compile();
-
     GLuint m_shaderID = 0;
     ShaderType m_type;
+    std::string m_source;
+    std::string m_path;
     bool m_compiled = false;
     std::string m_compileLog;
 };
 
+// A linked program. The GL program is double buffered: a rebuild through
+// linkAsync() compiles into a new program object while the last good one
+// keeps drawing, and only replaces it once the driver reports completion
+// (polled by update(), never waited on). Stages loaded from files are
+// watched and rebuilt the same way when they change on disk.
 class ShaderProgram {
 public:
     ShaderProgram();
     ~ShaderProgram();
 
+    // Stages for the next link; clearShaders() starts a new set
     bool attachShader(const Shader& shader);
+    void clearShaders();
+
+    // Blocks until the program is linked
     bool link();
 
+    // Starts a rebuild in the background and returns immediately. The first
+    // build of a program has nothing to fall back on and links like link().
+    // Rebuilding with unchanged stages is free.
+    bool linkAsync();
+    bool isPending() const { return m_pending != nullptr; }
+
+    // Polls background builds and, every RELOAD_INTERVAL seconds, the files
+    // of file-backed stages. Called once per frame.
+    static void update(float deltaTime);
+    static constexpr float RELOAD_INTERVAL = 0.5f;
+
     void bind() const;
     void unbind() const;
 
-    // Uniform setters
-    void setInt(const std::string& name, int value);
-    void setFloat(const std::string& name, float value);
-    void setBool(const std::string& name, bool value);
-    void setVec2(const std::string& name, const glm::vec2& value);
-    void setVec3(const std::string& name, const glm::vec3& value);
-    void setVec4(const std::string& name, const glm::vec4& value);
-    void setMat3(const std::string& name, const glm::mat3& value);
-    void setMat4(const std::string& name, const glm::mat4& value);
-
-    void setInt(const std::string& name, int count, const int* values);
-    void setFloat(const std::string& name, int count, const float* values);
-    void setVec3(const std::string& name, int count, const float* values);
-    void setMat4(const std::string& name, int count, const float* values);
+    // Uniform setters. Values equal to the last upload are skipped; the
+    // program keeps its uniforms across binds, so that is always safe.
+    void setInt(UniformID id, int value);
+    void setFloat(UniformID id, float value);
+    void setBool(UniformID id, bool value);
+    void setVec2(UniformID id, const glm::vec2& value);
+    void setVec3(UniformID id, const glm::vec3& value);
+    void setVec4(UniformID id, const glm::vec4& value);
+    void setMat3(UniformID id, const glm::mat3& value);
+    void setMat4(UniformID id, const glm::mat4& value);
+
+    void setInt(UniformID id, int count, const int* values);
+    void setFloat(UniformID id, int count, const float* values);
+    void setVec2(UniformID id, int count, const float* values);
+    void setVec3(UniformID id, int count, const float* values);
+    void setVec4(UniformID id, int count, const float* values);
+    void setMat4(UniformID id, int count, const float* values);
+
+    bool hasUniform(UniformID id) const { return m_uniforms.count(id.hash) != 0; }
+
+    // Binding of a uniform or shader storage block, -1 if not active
+    GLint getBlockBinding(UniformID id) const;
 
     GLuint getID() const { return m_programID; }
     bool isLinked() const { return m_linked; }
     std::string getLinkLog() const { return m_linkLog; }
 
 private:
-    GLint getUniformLocation(const std::string& name);
+    struct Stage {
+        ShaderType type;
+        std::string source;
+        std::string path;
+        int64_t modified = 0;   // File time when source was read
+    };
+
+    // A program object being built
+    struct Build {
+        GLuint program = 0;
+        std::vector<std::unique_ptr<Shader>> shaders;
+        uint64_t key = 0;
+        bool cached = false;
+        std::chrono::high_resolution_clock::time_point start;
+    };
+
+    // Active uniform from reflection, with its slot in m_uniformShadow
+    struct Uniform {
+        GLint location = -1;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t uploaded = 0;   // Bytes of the last upload held in the shadow
+    };
+
+    void reflect();
+
+    // Uniform to upload to, or null when it isn't active or data matches
+    // the last upload
+    Uniform* updateShadow(UniformID id, const void* data, size_t size);
+    uint64_t computeKey() const;
+    std::unique_ptr<Build> beginBuild(uint64_t key);
+    bool finishBuild(std::unique_ptr<Build> build);
+    bool pollBuild();
+    bool reloadChangedStages();
 
     GLuint m_programID = 0;
+    uint64_t m_key = 0;         // Stages the current program was built from
+    std::vector<Stage> m_stages;
+    std::unique_ptr<Build> m_pending;
     bool m_linked = false;
     std::string m_linkLog;
-    std::unordered_map<std::string, GLint> m_uniformLocationCache;
+
+    std::unordered_map<uint32_t, Uniform> m_uniforms;
+    std::unordered_map<uint32_t, GLint> m_blocks;
+    std::vector<uint8_t> m_uniformShadow;
+    std::unordered_set<uint32_t> m_reportedMissing;
 };
 
 } // namespace ExperimentRedbear
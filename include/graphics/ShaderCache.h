@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+// On-disk cache of linked program binaries (glGetProgramBinary). Entries are
+// keyed by a hash of every stage's source, which already carries its
+// #defines, plus the GL vendor, renderer and version strings, so a driver
+// update simply misses. A binary the driver rejects is treated as a miss
+// and overwritten by the next store().
+class ShaderCache {
+public:
+    static ShaderCache& getInstance();
+
+    // Hash of the program's stages, fed one at a time
+    static uint64_t hash(uint64_t seed, const std::string& data);
+    static constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+    // Loads the binary for key into program and links it. False when there
+    // is no entry or the driver rejected it; the caller compiles instead.
+    bool load(uint64_t key, GLuint program);
+
+    // Writes the binary of a freshly linked program
+    void store(uint64_t key, GLuint program);
+
+    // Startup accounting: every ShaderProgram::link reports its wall time
+    void recordLink(float milliseconds, bool cached);
+    void logSummary() const;
+
+    void setDirectory(const std::string& directory) { m_directory = directory; }
+    bool isEnabled();
+
+private:
+    ShaderCache();
+    ~ShaderCache();
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    void initialize();
+    std::string getPath(uint64_t key) const;
+
+    std::string m_directory = "cache/shaders";
+    uint64_t m_driverHash = 0;
+    bool m_initialized = false;
+    bool m_enabled = false;
+
+    int m_hits = 0;
+    int m_misses = 0;
+    int m_rejected = 0;
+    float m_cachedTime = 0.0f;      // ms spent on programs loaded from binaries
+    float m_compiledTime = 0.0f;    // ms spent compiling and linking
+};
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,523 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/Shader.h"
+
+namespace ExperimentRedbear {
+
+// Fixed binding points shared by every shader program. Blocks declare these
+// with layout(binding = N) so no per-program glUniformBlockBinding is needed.
+namespace UniformBinding {
+    constexpr GLuint FRAME = 0;
+    constexpr GLuint SHADOW_CASCADES = 1;
+}
+
+// Shader storage block binding points (separate namespace from uniform blocks)
+namespace StorageBinding {
+    constexpr GLuint LIGHTS = 0;
+    constexpr GLuint LIGHT_CLUSTERS = 1;
+    constexpr GLuint LIGHT_INDICES = 2;
+    constexpr GLuint SHADOW_TILES = 3;
+    constexpr GLuint MATERIALS = 4;
+    constexpr GLuint TREE_INSTANCES = 5;
+    constexpr GLuint VISIBLE_TREES = 6;
+    constexpr GLuint DRAW_DATA = 7;
+    constexpr GLuint TREE_CULL_TABLE = 8;
+    constexpr GLuint TREE_LODS = 9;
+    constexpr GLuint TREE_CULL_RESULTS = 10;
+    constexpr GLuint TREE_DRAWS = 11;
+    constexpr GLuint TREE_IMPOSTORS = 12;
+}
+
+// Texture units with a fixed meaning in every program
+namespace TextureBinding {
+    constexpr GLuint DIFFUSE = 0;
+    constexpr GLuint NORMAL = 1;
+    constexpr GLuint IMPOSTOR_ALBEDO = 2;
+    constexpr GLuint IMPOSTOR_NORMAL_DEPTH = 3;
+    constexpr GLuint SHADOW_ATLAS = 4;
+    constexpr GLuint SHADOW_CASCADES = 5;
+    constexpr GLuint TERRAIN_HEIGHT = 6;
+    constexpr GLuint OCCLUSION_DEPTH = 7;
+    constexpr GLuint MATERIAL_ARRAYS = 8;   // First of MAX_MATERIAL_ARRAYS units
+}
+
+// Uniforms set for every draw, hashed here once
+namespace UniformName {
+    constexpr UniformID MODEL("model");
+    constexpr UniformID MATERIAL_INDEX("materialIndex");
+    constexpr UniformID FADE("fade");
+    constexpr UniformID LIGHT_VIEW_PROJECTION("lightViewProjection");
+    constexpr UniformID INSTANCE_OFFSET("instanceOffset");
+    constexpr UniformID TREE_PART("treePart");
+}
+
+constexpr int MAX_MATERIAL_ARRAYS = 8;
+
+constexpr int SHADOW_MAX_CASCADES = 4;
+
+// Instanced tree layout: draws are grouped by (type, part, LOD)
+constexpr int TREE_MAX_TYPES = 8;
+constexpr int TREE_MAX_PARTS = 2;
+constexpr int TREE_MAX_LODS = 8;
+constexpr int TREE_GROUP_COUNT = TREE_MAX_TYPES * TREE_MAX_PARTS * TREE_MAX_LODS;
+
+// std140 mirror of the FrameConstants block
+struct GPUFrameConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 viewPos;        // xyz = camera position
+    glm::vec4 fogColor;       // rgb = fog color, a = 1 if fog is enabled
+    glm::vec4 fogParams;      // x = near, y = far
+    glm::vec4 ambientColor;   // rgb = ambient color * intensity
+    glm::uvec4 clusterGrid;   // xyz = cluster grid dimensions, w = directional light count
+    glm::vec4 clusterParams;  // xy = tile size in pixels, z = depth slice scale, w = slice bias
+};
+
+// Packed light, 80 bytes, std140/std430 compatible
+struct GPULight {
+    glm::vec4 positionRange;   // xyz = position, w = range
+    glm::vec4 directionType;   // xyz = direction, w = LightType
+    glm::vec4 colorConstant;   // rgb = color * intensity, w = constant attenuation
+    glm::vec4 attenuation;     // x = linear, y = quadratic, z = cos(inner), w = cos(outer)
+    glm::vec4 shadowParams;    // x = first shadow tile, or 0 for the cascaded directional light
+                               // (-1 = none), y = depth bias, z = normal bias
+};
+
+// One shadow atlas tile
+struct GPUShadowTile {
+    glm::mat4 viewProjection;
+    glm::vec4 atlasRect;       // xy = UV offset, zw = UV size
+};
+
+// Texture reference inside a material: an array slot (or a bindless array
+// handle) and a layer
+struct GPUMaterial {
+    glm::uvec4 diffuse;        // xy = bindless handle, or x = array slot; z = layer; w = 1 if present
+    glm::uvec4 normal;         // Same layout as diffuse
+    glm::vec4 baseColor;       // Multiplies the diffuse texture
+};
+
+// Static per tree data of the instanced forest, 32 bytes
+struct GPUTreeInstance {
+    glm::vec4 positionHeight;  // xyz = base position, w = height
+    glm::vec4 params;          // x = yaw in radians, y = type, z = trunk scale, w = impostor variant
+};
+
+// Per-draw data of the multi-draw opaque pass, 144 bytes. Indexed by the
+// draw's baseInstance.
+struct GPUDrawData {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;    // Upper 3x3 is used
+    int32_t materialIndex;     // -1 = legacy diffuseMap binding
+    float fade;
+    float padding[2];
+};
+
+// Layout of GL's DrawElementsIndirectCommand
+struct GPUDrawElementsCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// Unit-space bounds of a tree type for GPU culling, 64 bytes
+struct GPUTreeType {
+    glm::vec4 partBounds[TREE_MAX_PARTS];   // xyz = center, w = radius
+    glm::vec4 bounds;                       // Whole tree
+    glm::uvec4 lodCounts;                   // Per part, 0 = no mesh
+};
+
+// One (type, part, LOD) draw of the GPU-culled trees
+struct GPUTreeGroup {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    float lodError;            // MeshLod::error
+};
+
+// std430 mirror of the TreeCullTable block
+struct GPUTreeCullTable {
+    GPUTreeType types[TREE_MAX_TYPES];
+    GPUTreeGroup groups[TREE_GROUP_COUNT];
+};
+
+// std430 mirror of the TreeDraws block, the indirect draws written by the
+// GPU tree culling
+struct GPUTreeDraws {
+    GPUDrawElementsCommand groups[TREE_GROUP_COUNT];
+    glm::uvec4 impostors;      // DrawArraysIndirectCommand
+};
+
+// std140 mirror of the ShadowCascades block
+struct GPUShadowCascades {
+    glm::mat4 viewProjection[SHADOW_MAX_CASCADES];
+    glm::vec4 texelSize;       // World-space texel size per cascade
+    glm::uvec4 cascadeCount;   // x = cascade count
+};
+
+static_assert(sizeof(GPUFrameConstants) == 288, "FrameConstants must match std140 layout");
+static_assert(sizeof(GPULight) == 80, "GPULight must match std140 layout");
+static_assert(sizeof(GPUShadowTile) == 80, "GPUShadowTile must match std430 layout");
+static_assert(sizeof(GPUShadowCascades) == 288, "GPUShadowCascades must match std140 layout");
+static_assert(sizeof(GPUMaterial) == 48, "GPUMaterial must match std430 layout");
+static_assert(sizeof(GPUTreeInstance) == 32, "GPUTreeInstance must match std430 layout");
+static_assert(sizeof(GPUDrawData) == 144, "GPUDrawData must match std430 layout");
+static_assert(sizeof(GPUDrawElementsCommand) == 20, "GPUDrawElementsCommand must match GL's layout");
+static_assert(sizeof(GPUTreeType) == 64, "GPUTreeType must match std430 layout");
+static_assert(sizeof(GPUTreeCullTable) == 2560, "GPUTreeCullTable must match std430 layout");
+static_assert(sizeof(GPUTreeDraws) == 2576, "GPUTreeDraws must match std430 layout");
+
+// GLSL declarations matching the structs above
+namespace ShaderInterface {
+
+inline constexpr const char* FRAME_CONSTANTS = R"(
+layout (std140, binding = 0) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 fogColor;
+    vec4 fogParams;
+    vec4 ambientColor;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
+};
+)";
+
+inline constexpr const char* LIGHTS = R"(
+struct Light {
+    vec4 positionRange;
+    vec4 directionType;
+    vec4 colorConstant;
+    vec4 attenuation;
+    vec4 shadowParams;
+};
+
+// Directional lights come first (clusterGrid.w of them), followed by the
+// local lights referenced from the cluster index list
+layout (std430, binding = 0) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+// Per cluster: x = offset into clusterLightIndices, y = light count
+layout (std430, binding = 1) readonly buffer LightClusterBuffer {
+    uvec2 lightClusters[];
+};
+
+layout (std430, binding = 2) readonly buffer LightIndexBuffer {
+    uint clusterLightIndices[];
+};
+
+uint getClusterIndex(vec2 fragCoord, float viewDepth) {
+    float slice = log(max(viewDepth, 1e-4)) * clusterParams.z + clusterParams.w;
+    uint z = uint(clamp(slice, 0.0, float(clusterGrid.z - 1u)));
+    uvec2 tile = min(uvec2(fragCoord / clusterParams.xy), clusterGrid.xy - 1u);
+    return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * z);
+}
+)";
+
+// Requires LIGHTS
+inline constexpr const char* SHADOWS = R"(
+struct ShadowTile {
+    mat4 viewProjection;
+    vec4 atlasRect;
+};
+
+layout (std430, binding = 3) readonly buffer ShadowTileBuffer {
+    ShadowTile shadowTiles[];
+};
+
+layout (binding = 4) uniform sampler2DShadow shadowAtlas;
+
+// 3x3 PCF inside the light's atlas tile. Returns 1 when lit.
+float sampleLightShadow(Light light, vec3 fragPos, vec3 normal) {
+    int tileIndex = int(light.shadowParams.x);
+    if (tileIndex < 0) return 1.0;
+
+    // Point lights have six tiles in +X, -X, +Y, -Y, +Z, -Z order
+    if (int(light.directionType.w) == 1) {
+        vec3 toFrag = fragPos - light.positionRange.xyz;
+        vec3 a = abs(toFrag);
+        if (a.x >= a.y && a.x >= a.z) {
+            tileIndex += toFrag.x > 0.0 ? 0 : 1;
+        } else if (a.y >= a.z) {
+            tileIndex += toFrag.y > 0.0 ? 2 : 3;
+        } else {
+            tileIndex += toFrag.z > 0.0 ? 4 : 5;
+        }
+    }
+
+    ShadowTile tile = shadowTiles[tileIndex];
+    vec4 clip = tile.viewProjection * vec4(fragPos + normal * light.shadowParams.z, 1.0);
+    vec3 coord = clip.xyz / clip.w * 0.5 + 0.5;
+    if (coord.z >= 1.0 || any(lessThan(coord.xy, vec2(0.0))) || any(greaterThan(coord.xy, vec2(1.0)))) {
+        return 1.0;
+    }
+
+    // Keep every tap inside the tile so neighbouring tiles never bleed in
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 rectMin = tile.atlasRect.xy + texel * 1.5;
+    vec2 rectMax = tile.atlasRect.xy + tile.atlasRect.zw - texel * 1.5;
+    vec2 uv = tile.atlasRect.xy + coord.xy * tile.atlasRect.zw;
+    float reference = coord.z - light.shadowParams.y;
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec2 tap = clamp(uv + vec2(x, y) * texel, rectMin, rectMax);
+            lit += texture(shadowAtlas, vec3(tap, reference));
+        }
+    }
+    return lit / 9.0;
+}
+
+layout (std140, binding = 1) uniform ShadowCascades {
+    mat4 cascadeViewProjection[4];
+    vec4 cascadeTexelSize;
+    uvec4 cascadeCount;
+};
+
+layout (binding = 5) uniform sampler2DArrayShadow shadowCascades;
+
+// Uses the first cascade that contains the fragment. Far cascades may be a
+// frame old, so the choice is made from the map's own bounds rather than
+// from split depths. Returns 1 when lit.
+float sampleDirectionalShadow(Light light, vec3 fragPos, vec3 normal) {
+    if (light.shadowParams.x < 0.0) return 1.0;
+
+    float texel = 1.0 / float(textureSize(shadowCascades, 0).x);
+    for (uint i = 0u; i < cascadeCount.x; i++) {
+        vec3 offsetPos = fragPos + normal * (light.shadowParams.z + cascadeTexelSize[i] * 1.5);
+        vec3 coord = (cascadeViewProjection[i] * vec4(offsetPos, 1.0)).xyz * 0.5 + 0.5;
+        if (any(lessThan(coord.xy, vec2(texel * 2.0))) || any(greaterThan(coord.xy, vec2(1.0 - texel * 2.0)))) {
+            continue;
+        }
+        if (coord.z >= 1.0) return 1.0;
+
+        float reference = coord.z - light.shadowParams.y;
+        float lit = 0.0;
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                lit += texture(shadowCascades, vec4(coord.xy + vec2(x, y) * texel, float(i), reference));
+            }
+        }
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+)";
+
+// Define MATERIAL_BINDLESS (and enable GL_ARB_bindless_texture) to sample
+// through array handles instead of the fixed array units
+inline constexpr const char* MATERIALS = R"(
+struct Material {
+    uvec4 diffuse;
+    uvec4 normal;
+    vec4 baseColor;
+};
+
+layout (std430, binding = 4) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+#ifdef MATERIAL_BINDLESS
+vec4 sampleMaterialTexture(uvec4 ref, vec2 uv) {
+    return texture(sampler2DArray(ref.xy), vec3(uv, float(ref.z)));
+}
+#else
+layout (binding = 8) uniform sampler2DArray materialArrays[8];
+
+// The material index is uniform per draw, so ref.x is dynamically uniform
+vec4 sampleMaterialTexture(uvec4 ref, vec2 uv) {
+    return texture(materialArrays[ref.x], vec3(uv, float(ref.z)));
+}
+#endif
+)";
+
+// Instanced trees. Each draw covers a run of visibleTrees starting at
+// instanceOffset plus the draw's baseInstance (used by GPU-culled draws,
+// always 0 otherwise); an entry packs the tree index in its low 24 bits
+// and the mesh fade (0..255) in the top 8. Define TREE_CULLING to leave out
+// the per-draw parts.
+inline constexpr const char* TREE_INSTANCES = R"(
+struct TreeInstance {
+    vec4 positionHeight;
+    vec4 params;
+};
+
+layout (std430, binding = 5) readonly buffer TreeInstanceBuffer {
+    TreeInstance treeInstances[];
+};
+
+// translate(position) * rotateY(yaw) * scale. The trunk keeps its own
+// radius, every other part scales uniformly with height.
+mat4 makeTreeModel(TreeInstance tree, int part) {
+    float height = tree.positionHeight.w;
+    vec3 scale = part == 0 ? vec3(tree.params.z, height, tree.params.z) : vec3(height);
+    float s = sin(tree.params.x);
+    float c = cos(tree.params.x);
+    return mat4(vec4(c * scale.x, 0.0, -s * scale.x, 0.0),
+                vec4(0.0, scale.y, 0.0, 0.0),
+                vec4(s * scale.z, 0.0, c * scale.z, 0.0),
+                vec4(tree.positionHeight.xyz, 1.0));
+}
+
+#ifndef TREE_CULLING
+layout (std430, binding = 6) readonly buffer VisibleTreeBuffer {
+    uint visibleTrees[];
+};
+
+uniform int instanceOffset;
+uniform int treePart;   // 0 = trunk, 1 = foliage
+
+mat4 getTreeModel(out float fade) {
+#ifdef GL_ARB_shader_draw_parameters
+    uint entry = visibleTrees[instanceOffset + gl_BaseInstanceARB + gl_InstanceID];
+#else
+    uint entry = visibleTrees[instanceOffset + gl_InstanceID];
+#endif
+    fade = float(entry >> 24u) / 255.0;
+    return makeTreeModel(treeInstances[entry & 0xFFFFFFu], treePart);
+}
+#endif
+)";
+
+// Buffers of the GPU tree culling passes (see TreeCuller). Requires
+// TREE_INSTANCES with TREE_CULLING defined.
+inline constexpr const char* TREE_CULLING = R"(
+struct TreeType {
+    vec4 partBounds[2];
+    vec4 bounds;
+    uvec4 lodCounts;
+};
+
+struct TreeGroup {
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    float lodError;
+};
+
+layout (std430, binding = 8) readonly buffer TreeCullTable {
+    TreeType treeTypes[8];
+    TreeGroup treeGroups[128];   // [(type * 2 + part) * 8 + lod]
+};
+
+// Per tree: the LOD each part had in the last main view, 8 bits per part,
+// 0xFF = not drawn
+layout (std430, binding = 9) buffer TreeLodBuffer {
+    uint treeLods[];
+};
+
+// Per tree and part: x = group << 24 | index within the group's run
+// (0xFFFFFFFF = culled), y = the visibleTrees entry
+layout (std430, binding = 10) buffer TreeCullResultBuffer {
+    uvec2 treeCullResults[];
+};
+
+layout (std430, binding = 6) buffer VisibleTreeBuffer {
+    uint visibleTrees[];
+};
+
+struct DrawElementsCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 11) buffer TreeDraws {
+    DrawElementsCommand treeDraws[128];
+    uvec4 impostorDraw;   // DrawArraysIndirectCommand
+};
+
+struct ImpostorInstance {
+    vec4 positionScale;
+    vec4 params;
+};
+
+layout (std430, binding = 12) writeonly buffer TreeImpostorBuffer {
+    ImpostorInstance treeImpostors[];
+};
+
+const uint TREE_CULLED = 0xFFFFFFFFu;
+)";
+
+// Multi-draw per-draw data. Each command of a glMultiDrawElementsIndirect
+// sets baseInstance to its entry. Needs GL_ARB_shader_draw_parameters.
+inline constexpr const char* DRAW_DATA = R"(
+struct DrawData {
+    mat4 model;
+    mat4 normalMatrix;
+    int materialIndex;
+    float fade;
+};
+
+layout (std430, binding = 7) readonly buffer DrawDataBuffer {
+    DrawData drawData[];
+};
+
+mat4 getDrawModel(out mat3 normalMatrix, out float fade, out int materialIndex) {
+    DrawData draw = drawData[gl_BaseInstanceARB];
+    normalMatrix = mat3(draw.normalMatrix);
+    fade = draw.fade;
+    materialIndex = draw.materialIndex;
+    return draw.model;
+}
+)";
+
+// CDLOD terrain patches (see Terrain). Each instance is a quadtree node:
+// xy = min xz, z = size, w = LOD.
+inline constexpr const char* TERRAIN = R"(
+layout (binding = 6) uniform sampler2D terrainHeightMap;   // xyz = normal, w = height
+
+uniform vec4 terrainBounds;    // xy = min xz, z = size, w = patch grid size
+uniform vec2 terrainMorph[8];  // Per LOD: morph start and end distance
+
+// Texel centers sit on the heightfield samples, edges included
+vec4 sampleTerrain(vec2 worldXZ) {
+    vec2 size = vec2(textureSize(terrainHeightMap, 0));
+    vec2 uv = (worldXZ - terrainBounds.xy) / terrainBounds.z;
+    return textureLod(terrainHeightMap, (uv * (size - 1.0) + 0.5) / size, 0.0);
+}
+
+// Slides odd grid vertices onto the coarser grid of the next LOD as the
+// vertex nears the end of its node's range
+vec2 morphTerrainVertex(vec2 grid, vec4 node) {
+    vec2 worldXZ = node.xy + grid * node.z;
+    float distance = length(viewPos.xyz - vec3(worldXZ.x, sampleTerrain(worldXZ).w, worldXZ.y));
+    vec2 range = terrainMorph[int(node.w)];
+    float morph = clamp((distance - range.x) / (range.y - range.x), 0.0, 1.0);
+
+    vec2 cell = grid * terrainBounds.w;
+    cell -= fract(cell * 0.5) * 2.0 * morph;
+    return node.xy + cell / terrainBounds.w * node.z;
+}
+)";
+
+// Ordered 4x4 dither for screen-door cross-fades. The surface fading in
+// keeps fragments with ditherThreshold() < fade, the one fading out keeps
+// those with ditherThreshold() >= fade, so together they cover every pixel
+// exactly once.
+inline constexpr const char* DITHER = R"(
+float ditherThreshold(vec2 fragCoord) {
+    const float bayer[16] = float[16](
+         0.0,  8.0,  2.0, 10.0,
+        12.0,  4.0, 14.0,  6.0,
+         3.0, 11.0,  1.0,  9.0,
+        15.0,  7.0, 13.0,  5.0);
+    ivec2 p = ivec2(fragCoord) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+)";
+
+} // namespace ShaderInterface
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/Camera.h"
+#include "graphics/Light.h"
+#include "graphics/GpuBuffer.h"
+#include "graphics/RenderQueue.h"
+#include "graphics/ShaderInterface.h"
+
+namespace ExperimentRedbear {
+
+class ShaderProgram;
+struct RenderStats;
+
+// One depth texture shared by every shadow-casting spot and point light.
+// Each frame visible lights request a tile sized by their screen coverage
+// (point lights get six, one per cube face). Tiles of static lights keep
+// their contents until the light, the tile or a dynamic caster inside the
+// tile's frustum changes; non-static lights (the flashlight) re-render
+// every frame.
+class ShadowAtlas {
+public:
+    static constexpr int MIN_TILE_SIZE = 128;
+
+    ShadowAtlas();
+    ~ShadowAtlas();
+
+    // atlasSize of 0 disables light shadows
+    bool initialize(int atlasSize);
+    void shutdown();
+
+    // Allocates tiles, re-renders stale ones and uploads the tile buffer.
+    // Uses the queue's cull pass, so call it before the main view is culled.
+    // extraCasters, if set, runs after the queue in every view drawn.
+    void update(const Camera& camera, const std::vector<Light>& lights, RenderQueue& queue,
+                ShaderProgram& depthShader, RenderStats& stats,
+                const ShadowCasterCallback& extraCasters = nullptr);
+
+    // Per light: index of its first tile in the shadow tile buffer, or -1
+    const std::vector<int>& getLightTiles() const { return m_lightTiles; }
+
+    // Forces every tile to re-render (e.g. after static geometry changed)
+    void invalidate();
+
+    GLuint getTexture() const { return m_depthTexture; }
+    int getSize() const { return m_size; }
+    bool isEnabled() const { return m_size > 0; }
+
+private:
+    struct TileRequest {
+        int lightIndex;
+        int size;
+        int faces;
+    };
+
+    struct CachedTile {
+        uint64_t lightHash = 0;
+        uint64_t casterHash = 0;
+        glm::ivec4 rect = glm::ivec4(0);
+        bool valid = false;
+    };
+
+    int computeTileSize(const Camera& camera, const Light& light) const;
+    bool allocate(std::vector<TileRequest>& requests, std::vector<glm::ivec4>& rects) const;
+
+    static glm::mat4 computeFaceMatrix(const Light& light, int face);
+    static uint64_t hashLight(const Light& light);
+    static uint64_t hashCasters(const RenderQueue& queue);
+
+    int m_size = 0;
+    GLuint m_fbo = 0;
+    GLuint m_depthTexture = 0;
+
+    std::vector<int> m_lightTiles;
+    std::vector<GPUShadowTile> m_gpuTiles;
+    std::vector<std::vector<CachedTile>> m_cache;  // [light][face]
+    bool m_invalidated = true;
+
+    GpuBuffer m_tileBuffer;
+};
+
+} // namespace ExperimentRedbear
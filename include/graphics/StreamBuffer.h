@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+// Piece of the stream buffer. The memory may be written until the end of
+// the frame it was allocated in and is read by the GPU from buffer/offset.
+struct StreamAllocation {
+    void* data = nullptr;
+    GLuint buffer = 0;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// Per-frame data that the CPU rewrites every frame: vertices, instance data
+// and uniform/storage blocks. One persistently mapped, coherent buffer is
+// split into FRAME_COUNT regions and each frame allocates linearly from its
+// own, so a write is a plain memcpy. beginFrame() fences the finished
+// region and waits for the GPU to let go of the next one, which it normally
+// did a frame ago.
+//
+// A frame that outgrows its region moves to a new, larger buffer on the
+// spot. The old buffer stays alive until a fence shows the GPU is done.
+class StreamBuffer {
+public:
+    static constexpr int FRAME_COUNT = 3;
+    static constexpr size_t DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+    static StreamBuffer& getInstance();
+
+    bool initialize(size_t frameSize = DEFAULT_FRAME_SIZE);
+    void shutdown();
+
+    // Ends the current frame's region and starts the next
+    void beginFrame();
+
+    // size bytes at a multiple of alignment. Zero-sized requests still get
+    // space, so the result can always be bound as a range.
+    StreamAllocation allocate(size_t size, size_t alignment = 16);
+    StreamAllocation allocateUniform(size_t size) { return allocate(size, m_uniformAlignment); }
+    StreamAllocation allocateStorage(size_t size) { return allocate(size, m_storageAlignment); }
+
+    // Allocates and copies data in
+    StreamAllocation write(const void* data, size_t size, size_t alignment = 16);
+    StreamAllocation writeUniform(const void* data, size_t size) { return write(data, size, m_uniformAlignment); }
+    StreamAllocation writeStorage(const void* data, size_t size) { return write(data, size, m_storageAlignment); }
+
+    // Binds an allocation to an indexed uniform/storage binding point
+    static void bindRange(GLenum target, GLuint index, const StreamAllocation& allocation);
+
+    bool isValid() const { return m_buffer != 0; }
+    size_t getFrameSize() const { return m_frameSize; }
+
+    // Previous frame: bytes allocated, and whether beginFrame() had to wait
+    // for the GPU before reusing its region
+    size_t getLastFrameUsage() const { return m_lastUsage; }
+    bool hasStalled() const { return m_stalled; }
+
+private:
+    StreamBuffer();
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    struct Retired {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;   // Inserted at the end of the frame it was retired in
+    };
+
+    bool createBuffer(size_t frameSize);
+    void grow(size_t required);
+    void releaseRetired();
+
+    // True if the fence hadn't signalled yet and the CPU had to block
+    static bool waitFence(GLsync fence);
+
+    GLuint m_buffer = 0;
+    unsigned char* m_mapped = nullptr;
+    size_t m_frameSize = 0;
+    GLsync m_fences[FRAME_COUNT] = {};
+
+    int m_region = 0;     // Region this frame allocates from
+    size_t m_head = 0;    // Next free byte within it
+    size_t m_usage = 0;   // Bytes allocated this frame, across a grow
+    size_t m_lastUsage = 0;
+    bool m_stalled = false;
+
+    size_t m_uniformAlignment = 256;
+    size_t m_storageAlignment = 256;
+
+    std::vector<Retired> m_retired;
+};
+
+} // namespace ExperimentRedbear
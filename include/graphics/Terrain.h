@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+namespace ExperimentRedbear {
+
+class ShaderProgram;
+struct RenderStats;
+
+// Continuous distance-dependent LOD (CDLOD) terrain. The heightfield lives
+// in a texture; every visible quadtree node draws the same GRID_SIZE x
+// GRID_SIZE patch, scaled to the node and displaced in the vertex shader.
+// Nodes are picked from LOD ranges around the camera that double per level,
+// and vertices near the end of a range morph onto the next coarser grid so
+// neighbouring levels meet without cracks or popping.
+class Terrain {
+public:
+    static constexpr int GRID_SIZE = 32;          // Quads per patch side, even
+    static constexpr int MAX_LODS = 8;
+    static constexpr float MAX_LEAF_SIZE = 16.0f;  // Meters
+    static constexpr float MORPH_START = 0.7f;    // Fraction of a LOD band before morphing
+
+    Terrain();
+    ~Terrain();
+
+    // Builds the patch geometry; keeps the heightfield if already initialized
+    bool initialize();
+    void shutdown();
+
+    // Replaces the heightfield. heights holds resolution x resolution samples
+    // (row-major, rows along z) spread evenly over the square from origin
+    // (min x, min z) to origin + size, edges included.
+    bool create(const std::vector<float>& heights, int resolution, const glm::vec2& origin, float size);
+    void clear();
+
+    // Bilinear height of the heightfield, clamped at its edges
+    float getHeight(float x, float z) const;
+
+    void setMaterial(uint32_t materialIndex) { m_materialIndex = materialIndex; }
+
+    // Selects the nodes for this view and draws them, one instanced draw per
+    // patch quadrant. Expects the main view's blocks and materials bound.
+    void draw(ShaderProgram& shader, const glm::vec3& eye, const glm::vec4 planes[6], RenderStats& stats);
+
+    bool isCreated() const { return m_heightTexture != 0; }
+    int getLodCount() const { return m_lodCount; }
+
+private:
+    // Instance list for the whole patch plus one per quadrant
+    enum Selection {
+        FULL_PATCH,
+        QUADRANT_0,
+        SELECTION_COUNT = QUADRANT_0 + 4
+    };
+
+    // Returns false if the node is beyond its LOD range, leaving it to the
+    // parent
+    bool selectNode(int lod, int x, int z, const glm::vec3& eye, const glm::vec4 planes[6]);
+    void addNode(int lod, int x, int z, int selection);
+
+    glm::vec3 getNodeMin(int lod, int x, int z) const;
+    glm::vec3 getNodeMax(int lod, int x, int z) const;
+    float getNodeSize(int lod) const { return m_leafSize * static_cast<float>(1 << lod); }
+
+    GLuint m_vao = 0;
+    GLuint m_gridVBO = 0;
+    GLuint m_gridEBO = 0;
+
+    GLuint m_heightTexture = 0;   // RGBA32F: xyz = normal, w = height
+
+    std::vector<float> m_heights;
+    int m_resolution = 0;
+    glm::vec2 m_origin = glm::vec2(0.0f);
+    float m_size = 0.0f;
+
+    int m_lodCount = 0;
+    float m_leafSize = 0.0f;
+    float m_ranges[MAX_LODS] = {};
+
+    // Per LOD (0 = leaves): min/max height of every node, row-major
+    std::vector<std::vector<glm::vec2>> m_nodeHeights;
+
+    // xy = node min xz, z = node size, w = LOD
+    std::vector<glm::vec4> m_selections[SELECTION_COUNT];
+    std::vector<glm::vec4> m_upload;
+
+    uint32_t m_materialIndex = 0xFFFFFFFFu;
+    bool m_initialized = false;
+};
+
+} // namespace ExperimentRedbear
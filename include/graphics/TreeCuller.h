@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "graphics/Shader.h"
+#include "graphics/GpuBuffer.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/ShaderInterface.h"
+
+namespace ExperimentRedbear {
+
+// One view to cull the forest against
+struct TreeCullView {
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec4 planes[6];
+    glm::vec3 position = glm::vec3(0.0f);
+
+    // Screen pixels per world unit at distance 1, for LOD selection. 0
+    // marks a shadow view, which reuses the LODs of the last main view.
+    float pixelsPerUnit = 0.0f;
+
+    // Meshes cross-fade to impostors from impostorStart over impostorRange;
+    // a range of 0 draws every tree as a mesh and writes no impostors
+    float impostorStart = 0.0f;
+    float impostorRange = 0.0f;
+
+    // OcclusionCuller hierarchy of this view, 0 for none
+    GLuint occlusionTexture = 0;
+};
+
+// Buffers one cull wrote. visibleBuffer goes on StorageBinding::VISIBLE_TREES;
+// drawBuffer holds GPUTreeDraws.
+struct TreeCullResult {
+    GLuint visibleBuffer = 0;
+    GLuint drawBuffer = 0;
+    GLuint impostorBuffer = 0;
+
+    bool isValid() const { return drawBuffer != 0; }
+};
+
+// GPU-driven culling for ForestRenderer. Three compute passes per view:
+// the first tests every tree against the frustum, the occlusion hierarchy
+// and the impostor distance, picks each part's LOD and counts the trees of
+// every (type, part, LOD) group; the second turns the counts into the
+// groups' indirect draws; the third scatters the visible entries into one
+// run per group. The CPU cost is the same for ten trees or a million.
+//
+// Each view of a frame writes its own buffers, so no cull overwrites data
+// an earlier draw may still read. They are sized with the forest, outside
+// the frame, for the main view and up to MAX_SHADOW_VIEWS shadow views.
+class TreeCuller {
+public:
+    static constexpr int MAX_SHADOW_VIEWS = 15;
+
+    TreeCuller();
+    ~TreeCuller();
+
+    // Needs GL_ARB_shader_draw_parameters, which the tree shaders use to
+    // start each group's run at the draw's baseInstance, and storage buffer
+    // bindings up to StorageBinding::TREE_IMPOSTORS
+    bool initialize();
+    void shutdown();
+    bool isValid() const { return m_cullShader != nullptr; }
+
+    // Sizes the per-tree and per-view buffers and forgets the LOD history.
+    // Deletes buffers, so only between frames.
+    void reset(size_t treeCount);
+
+    // Type bounds and group draws for this frame's culls
+    void setTable(const GPUTreeCullTable& table);
+
+    // Expects the tree instances on StorageBinding::TREE_INSTANCES. Leaves
+    // one of the culling programs bound. Returns an invalid result once the
+    // frame's shadow views are used up.
+    TreeCullResult cull(const TreeCullView& view);
+
+    // Lets the next frame reuse the views' buffers
+    void endFrame();
+
+private:
+    struct ViewBuffers {
+        GpuBuffer results;
+        GpuBuffer visible;
+        GpuBuffer draws;
+        GpuBuffer impostors;
+    };
+
+    bool createShaders();
+    static void reserve(GpuBuffer& buffer, size_t size);
+
+    std::unique_ptr<ShaderProgram> m_cullShader;
+    std::unique_ptr<ShaderProgram> m_offsetShader;
+    std::unique_ptr<ShaderProgram> m_compactShader;
+
+    GpuBuffer m_lodBuffer;
+    ViewBuffers m_views[1 + MAX_SHADOW_VIEWS];   // Main view first
+    int m_shadowViewCount = 0;   // Used this frame
+    size_t m_treeCount = 0;
+    StreamAllocation m_table;   // This frame's GPUTreeCullTable
+};
+
+} // namespace ExperimentRedbear
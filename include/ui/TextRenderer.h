@@ -26,8 +26,7 @@ struct Font {
     std::string path;
     int size;
     std::unordered_map<char, Character> characters;
-    GLuint vao;
-    GLuint vbo;
+    GLuint vao;   // Vertices come from the stream buffer per string
     float lineHeight;
     float base;
 };
@@ -44,6 +43,10 @@ public:
     void renderText(const std::string& text, const glm::vec2& position, const std::string& font, 
                     float scale, const glm::vec3& color, bool centered = false);
 
+    // Closes the TEXT profiler range the frame's first renderText() opened.
+    // Call once after the last string of the frame.
+    void endTextPass();
+
     glm::vec2 measureText(const std::string& text, const std::string& font, float scale);
 
     float getLineHeight(const std::string& font, float scale);
@@ -65,6 +68,7 @@ private:
     int m_screenWidth = 1920;
     int m_screenHeight = 1080;
     bool m_initialized = false;
+    bool m_textPassOpen = false;
 };
 
 } // namespace ExperimentRedbear
@@ -70,8 +70,7 @@ private:
     bool m_cursorVisible = true;
     bool m_initialized = false;
 
-    GLuint m_vao = 0;
-    GLuint m_vbo = 0;
+    GLuint m_vao = 0;   // Vertices come from the stream buffer
 };
 
 } // namespace ExperimentRedbear
@@ -5,9 +5,11 @@ out vec4 FragColor;
 
 uniform sampler2D screenTexture;
 uniform sampler2D depthTexture;
+uniform sampler2D bloomTexture;   // Level 0 of the bloom chain (half resolution)
+uniform vec2 uvScale;             // Part of screenTexture the scene covers (dynamic resolution)
 
 // Effects
-uniform float bloomIntensity;
+uniform float bloomIntensity;     // Already divided by the number of bloom levels
 uniform float vignetteIntensity;
 uniform float saturation;
 uniform float contrast;
@@ -22,8 +24,15 @@ float random(vec2 st) {
 }
 
 void main() {
-    // Get screen color
-    vec3 color = texture(screenTexture, TexCoords).rgb;
+    // Get screen color, upscaled from the rendered area. The clamp keeps
+    // bilinear taps off texels the scene didn't write.
+    vec2 halfTexel = 0.5 / vec2(textureSize(screenTexture, 0));
+    vec3 color = texture(screenTexture, min(TexCoords * uvScale, uvScale - halfTexel)).rgb;
+
+    // Bloom
+    if (bloomIntensity > 0.0) {
+        color += texture(bloomTexture, TexCoords).rgb * bloomIntensity;
+    }
     
     // Saturation adjustment
     if (saturation != 1.0) {
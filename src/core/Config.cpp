@@ -74,6 +74,11 @@ bool Config::load(const std::string& filename) {
     graphics.ssao = getBool("ssao", graphics.ssao);
     graphics.bloom = getBool("bloom", graphics.bloom);
     graphics.msaaSamples = getInt("msaa_samples", graphics.msaaSamples);
+    graphics.dynamicResolution = getBool("dynamic_resolution", graphics.dynamicResolution);
+    graphics.targetFrameTime = getFloat("target_frame_time", graphics.targetFrameTime);
+    graphics.minResolutionScale = getFloat("min_resolution_scale", graphics.minResolutionScale);
+    graphics.maxResolutionScale = getFloat("max_resolution_scale", graphics.maxResolutionScale);
+    graphics.gpuTreeCulling = getBool("gpu_tree_culling", graphics.gpuTreeCulling);
 
     audio.masterVolume = getFloat("master_volume", audio.masterVolume);
     audio.musicVolume = getFloat("music_volume", audio.musicVolume);
@@ -109,7 +114,12 @@ bool Config::save(const std::string& filename) {
     file << "render_distance=" << graphics.renderDistance << "\n";
     file << "ssao=" << (graphics.ssao ? "true" : "false") << "\n";
     file << "bloom=" << (graphics.bloom ? "true" : "false") << "\n";
-    file << "msaa_samples=" << graphics.msaaSamples << "\n\n";
+    file << "msaa_samples=" << graphics.msaaSamples << "\n";
+    file << "dynamic_resolution=" << (graphics.dynamicResolution ? "true" : "false") << "\n";
+    file << "target_frame_time=" << graphics.targetFrameTime << "\n";
+    file << "min_resolution_scale=" << graphics.minResolutionScale << "\n";
+    file << "max_resolution_scale=" << graphics.maxResolutionScale << "\n";
+    file << "gpu_tree_culling=" << (graphics.gpuTreeCulling ? "true" : "false") << "\n\n";
 
     file << "# Audio\n";
     file << "master_volume=" << audio.masterVolume << "\n";
@@ -0,0 +1,124 @@
+#include "core/JobSystem.h"
+#include "core/Logger.h"
+#include <algorithm>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+thread_local int t_threadIndex = 0;
+
+} // namespace
+
+JobSystem& JobSystem::getInstance() {
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+bool JobSystem::initialize(int workerCount) {
+    if (!m_workers.empty()) return true;
+
+    if (workerCount < 0) {
+        int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+        workerCount = std::max(hardwareThreads - 1, 0);
+    }
+
+    m_quit = false;
+    for (int i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+    }
+
+    LOG_INFO("Job system initialized with " + std::to_string(workerCount) + " worker threads");
+    return true;
+}
+
+void JobSystem::shutdown() {
+    if (m_workers.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+int JobSystem::getThreadIndex() {
+    return t_threadIndex;
+}
+
+void JobSystem::parallelFor(size_t count, size_t batchSize,
+                            const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    if (m_workers.empty() || count <= batchSize || t_threadIndex != 0) {
+        for (size_t begin = 0; begin < count; begin += batchSize) {
+            fn(begin, std::min(begin + batchSize, count));
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &fn;
+        m_count = count;
+        m_batchSize = batchSize;
+        m_batchCount = (count + batchSize - 1) / batchSize;
+        m_nextBatch.store(0);
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runBatches();
+
+    // Workers that joined this generation may still be inside fn; wait for
+    // them so none can pick up a later call's batches with this task
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_activeWorkers == 0; });
+    m_task = nullptr;
+}
+
+void JobSystem::runBatches() {
+    while (true) {
+        size_t batch = m_nextBatch.fetch_add(1);
+        if (batch >= m_batchCount) break;
+
+        size_t begin = batch * m_batchSize;
+        (*m_task)(begin, std::min(begin + m_batchSize, m_count));
+    }
+}
+
+void JobSystem::workerLoop(int threadIndex) {
+    t_threadIndex = threadIndex;
+    uint64_t seenGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_quit || (m_task && m_generation != seenGeneration); });
+        if (m_quit) break;
+
+        seenGeneration = m_generation;
+        m_activeWorkers++;
+
+        lock.unlock();
+        runBatches();
+        lock.lock();
+
+        if (--m_activeWorkers == 0) {
+            m_done.notify_all();
+        }
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -11,6 +11,16 @@ Window::~Window() {
 }
 
 bool Window::initialize(const WindowSettings& settings) {
+    m_headless = settings.headless;
+
+#ifdef GLFW_PLATFORM_NULL
+    // The null platform needs no X11/Wayland connection; paired with an
+    // OSMesa context this runs on Mesa llvmpipe on a bare CI box
+    if (m_headless) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     if (!glfwInit()) {
         LOG_FATAL("Failed to initialize GLFW");
         return false;
@@ -29,12 +39,20 @@ bool Window::initialize(const WindowSettings& settings) {
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
 #endif
 
+    if (m_headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_SAMPLES, 0);
+#ifdef GLFW_PLATFORM_NULL
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+    }
+
     // Get monitor for fullscreen
-    m_monitor = glfwGetPrimaryMonitor();
-    const GLFWvidmode* mode = glfwGetVideoMode(m_monitor);
+    m_monitor = m_headless ? nullptr : glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = m_monitor ? glfwGetVideoMode(m_monitor) : nullptr;
 
     // Create window
-    if (settings.fullscreen && m_monitor) {
+    if (settings.fullscreen && m_monitor && !m_headless) {
         m_window = glfwCreateWindow(mode->width, mode->height, 
                                      settings.title.c_str(), m_monitor, nullptr);
         m_width = mode->width;
@@ -60,6 +78,13 @@ bool Window::initialize(const WindowSettings& settings) {
     // Initialize GLEW
     glewExperimental = GL_TRUE;
     GLenum glewError = glewInit();
+
+    // GLEW built against GLX reports a missing display for OSMesa/EGL contexts
+    // after the core entry points have already been loaded
+    if (m_headless && glewError == GLEW_ERROR_NO_GLX_DISPLAY) {
+        glewError = GLEW_OK;
+    }
+
     if (glewError != GLEW_OK) {
         LOG_FATAL(std::string("Failed to initialize GLEW: ") + 
                   reinterpret_cast<const char*>(glewGetErrorString(glewError)));
@@ -78,11 +103,12 @@ bool Window::initialize(const WindowSettings& settings) {
     glEnable(GL_MULTISAMPLE);
 
     // Center window if not fullscreen
-    if (!m_fullscreen) {
+    if (!m_fullscreen && m_monitor) {
         centerWindow();
     }
 
-    LOG_INFO("Window created successfully: " + std::to_string(m_width) + "x" + std::to_string(m_height));
+    LOG_INFO(std::string(m_headless ? "Offscreen context" : "Window") + " created successfully: " +
+             std::to_string(m_width) + "x" + std::to_string(m_height));
 
     return true;
 }
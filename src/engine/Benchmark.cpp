@@ -0,0 +1,401 @@
+#include "engine/Benchmark.h"
+#include "engine/Game.h"
+#include "core/Logger.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2,
+                     const glm::vec3& p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) +
+                   (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+float percentile(std::vector<float> values, float p) {
+    if (values.empty()) return 0.0f;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5f);
+    return values[std::min(index, values.size() - 1)];
+}
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+// CameraPath
+
+void CameraPath::addKeyframe(const glm::vec3& position, const glm::vec3& target) {
+    m_keyframes.push_back({position, target});
+}
+
+bool CameraPath::loadFromFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open camera path: " + path);
+        return false;
+    }
+
+    m_keyframes.clear();
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream iss(line);
+        CameraKeyframe key;
+        if (iss >> key.position.x >> key.position.y >> key.position.z
+                >> key.target.x >> key.target.y >> key.target.z) {
+            m_keyframes.push_back(key);
+        }
+    }
+
+    if (m_keyframes.size() < 2) {
+        LOG_ERROR("Camera path needs at least two keyframes: " + path);
+        return false;
+    }
+
+    LOG_INFO("Loaded camera path with " + std::to_string(m_keyframes.size()) + " keyframes");
+    return true;
+}
+
+bool CameraPath::saveToFile(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to write camera path: " + path);
+        return false;
+    }
+
+    file << "# px py pz tx ty tz\n";
+    for (const auto& key : m_keyframes) {
+        file << key.position.x << " " << key.position.y << " " << key.position.z << " "
+             << key.target.x << " " << key.target.y << " " << key.target.z << "\n";
+    }
+    return true;
+}
+
+void CameraPath::evaluate(float t, glm::vec3& position, glm::vec3& target) const {
+    if (m_keyframes.empty()) {
+        position = glm::vec3(0.0f);
+        target = glm::vec3(0.0f, 0.0f, -1.0f);
+        return;
+    }
+    if (m_keyframes.size() == 1) {
+        position = m_keyframes[0].position;
+        target = m_keyframes[0].target;
+        return;
+    }
+
+    int segments = static_cast<int>(m_keyframes.size()) - 1;
+    float scaled = std::clamp(t, 0.0f, 1.0f) * segments;
+    int segment = std::min(static_cast<int>(scaled), segments - 1);
+    float local = scaled - segment;
+
+    // End points are duplicated so the curve passes through every keyframe
+    auto key = [this](int i) -> const CameraKeyframe& {
+        return m_keyframes[std::clamp(i, 0, static_cast<int>(m_keyframes.size()) - 1)];
+    };
+
+    position = catmullRom(key(segment - 1).position, key(segment).position,
+                          key(segment + 1).position, key(segment + 2).position, local);
+    target = catmullRom(key(segment - 1).target, key(segment).target,
+                        key(segment + 1).target, key(segment + 2).target, local);
+}
+
+CameraPath CameraPath::createDefault(const std::string& scene) {
+    CameraPath path;
+
+    if (scene == "house") {
+        // Bedroom, down the hallway, through the living room into the kitchen
+        path.addKeyframe(glm::vec3(1.5f, 1.7f, 1.5f), glm::vec3(4.0f, 1.2f, 4.0f));
+        path.addKeyframe(glm::vec3(2.5f, 1.7f, 4.0f), glm::vec3(2.5f, 1.6f, 8.0f));
+        path.addKeyframe(glm::vec3(5.0f, 1.7f, 6.0f), glm::vec3(9.0f, 1.6f, 6.0f));
+        path.addKeyframe(glm::vec3(1.0f, 1.7f, 6.0f), glm::vec3(-4.0f, 1.6f, 7.0f));
+        path.addKeyframe(glm::vec3(-3.0f, 1.7f, 8.0f), glm::vec3(-8.0f, 1.0f, 8.0f));
+        path.addKeyframe(glm::vec3(-4.0f, 1.7f, 12.0f), glm::vec3(-7.0f, 1.0f, 11.0f));
+    } else if (scene == "forest") {
+        // Loop through the trees outside the house clearing
+        path.addKeyframe(glm::vec3(20.0f, 1.7f, 0.0f), glm::vec3(40.0f, 2.0f, 20.0f));
+        path.addKeyframe(glm::vec3(40.0f, 1.7f, 30.0f), glm::vec3(20.0f, 2.0f, 60.0f));
+        path.addKeyframe(glm::vec3(10.0f, 1.7f, 60.0f), glm::vec3(-30.0f, 2.0f, 50.0f));
+        path.addKeyframe(glm::vec3(-40.0f, 1.7f, 30.0f), glm::vec3(-50.0f, 2.0f, -10.0f));
+        path.addKeyframe(glm::vec3(-30.0f, 1.7f, -30.0f), glm::vec3(10.0f, 2.0f, -50.0f));
+        path.addKeyframe(glm::vec3(20.0f, 1.7f, 0.0f), glm::vec3(40.0f, 2.0f, 20.0f));
+    } else {
+        // Out of the bedroom, through the kitchen door and into the forest
+        path.addKeyframe(glm::vec3(1.5f, 1.7f, 1.5f), glm::vec3(2.5f, 1.6f, 6.0f));
+        path.addKeyframe(glm::vec3(2.5f, 1.7f, 6.0f), glm::vec3(-4.0f, 1.6f, 7.0f));
+        path.addKeyframe(glm::vec3(-4.0f, 1.7f, 10.0f), glm::vec3(-10.0f, 1.6f, 15.0f));
+        path.addKeyframe(glm::vec3(-10.0f, 1.7f, 18.0f), glm::vec3(-20.0f, 2.0f, 40.0f));
+        path.addKeyframe(glm::vec3(-20.0f, 1.7f, 40.0f), glm::vec3(0.0f, 2.0f, 70.0f));
+        path.addKeyframe(glm::vec3(10.0f, 8.0f, 60.0f), glm::vec3(0.0f, 1.0f, 5.0f));
+    }
+
+    return path;
+}
+
+// Benchmark
+
+Benchmark::Benchmark() {}
+
+Benchmark::~Benchmark() = default;
+
+bool Benchmark::parseArguments(int argc, char* argv[], BenchmarkSettings& settings) {
+    bool enabled = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--benchmark") {
+            enabled = true;
+            if (hasValue && std::strncmp(argv[i + 1], "--", 2) != 0) {
+                settings.scene = argv[++i];
+            }
+        } else if (arg == "--frames" && hasValue) {
+            settings.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            settings.warmupFrames = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--output" && hasValue) {
+            settings.outputPath = argv[++i];
+        } else if (arg == "--path" && hasValue) {
+            settings.pathFile = argv[++i];
+        } else if (arg == "--size" && hasValue) {
+            int width = 0;
+            int height = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                settings.width = width;
+                settings.height = height;
+            } else {
+                LOG_WARNING(std::string("Invalid --size, expected WxH: ") + argv[i]);
+            }
+        }
+    }
+
+    if (enabled && settings.scene != "house" && settings.scene != "forest" && settings.scene != "full") {
+        LOG_WARNING("Unknown benchmark scene '" + settings.scene + "', using 'full'");
+        settings.scene = "full";
+    }
+
+    return enabled;
+}
+
+bool Benchmark::run(Game& game, const BenchmarkSettings& settings) {
+    m_settings = settings;
+    m_samples.clear();
+
+    CameraPath path;
+    if (!settings.pathFile.empty()) {
+        if (!path.loadFromFile(settings.pathFile)) return false;
+    } else {
+        path = CameraPath::createDefault(settings.scene);
+    }
+
+    LOG_INFO("Benchmark: scene '" + settings.scene + "', " + std::to_string(settings.frames) +
+             " frames (+" + std::to_string(settings.warmupFrames) + " warm-up)");
+
+    game.initializeWorld(settings.scene != "forest", settings.scene != "house");
+    game.setState(GameState::PLAYING);
+
+    auto& renderer = Renderer::getInstance();
+    Camera& camera = game.getPlayer().getCamera();
+
+    // Timings for frame F are published by later frames: CPU at F + 1,
+    // GPU once the query ring comes back round at F + FRAME_LATENCY.
+    // Keep rendering past the end until the last measured frame resolves.
+    const int latency = GpuProfiler::FRAME_LATENCY;
+    const int measured = settings.frames;
+    const int total = settings.warmupFrames + measured + latency;
+
+    std::vector<RenderStats> published;
+    published.reserve(total);
+
+    for (int frame = 0; frame < total; frame++) {
+        // Fixed step along the path so every run renders the same frames
+        int pathFrame = std::clamp(frame - settings.warmupFrames, 0, measured - 1);
+        float t = measured > 1 ? static_cast<float>(pathFrame) / (measured - 1) : 0.0f;
+
+        glm::vec3 position;
+        glm::vec3 target;
+        path.evaluate(t, position, target);
+
+        glm::vec3 direction = target - position;
+        if (glm::length(direction) < 0.0001f) {
+            direction = glm::vec3(0.0f, 0.0f, -1.0f);
+        }
+        direction = glm::normalize(direction);
+
+        float yaw = glm::degrees(std::atan2(-direction.x, -direction.z));
+        float pitch = glm::degrees(std::asin(std::clamp(direction.y, -1.0f, 1.0f)));
+        camera.setPosition(position);
+        camera.setRotationEuler(pitch, yaw, 0.0f);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        game.renderFrame();
+        game.getWindow().swapBuffers();
+        game.getWindow().pollEvents();
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        // beginFrame published the timings, flush filled in the counters
+        published.push_back(renderer.getStats());
+
+        int sampleFrame = frame - settings.warmupFrames;
+        if (sampleFrame >= 0 && sampleFrame < measured) {
+            m_samples.push_back({sampleFrame, elapsed.count(), renderer.getStats()});
+        }
+    }
+
+    // Re-attach the timings that arrived later to the frame they measure
+    for (auto& sample : m_samples) {
+        int frame = sample.frame + settings.warmupFrames;
+        const RenderStats& cpu = published[frame + 1];
+        const RenderStats& gpu = published[frame + latency];
+
+        sample.stats.cpuTime = cpu.cpuTime;
+        sample.stats.gpuTime = gpu.gpuTime;
+        for (int i = 0; i < GPU_PASS_COUNT; i++) {
+            sample.stats.passCpuTime[i] = cpu.passCpuTime[i];
+            sample.stats.passGpuTime[i] = gpu.passGpuTime[i];
+        }
+        sample.stats.pipeline = gpu.pipeline;
+    }
+
+    logSummary();
+
+    if (endsWith(settings.outputPath, ".json")) {
+        return writeJSON(settings.outputPath);
+    }
+    return writeCSV(settings.outputPath);
+}
+
+bool Benchmark::writeCSV(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to write benchmark results: " + path);
+        return false;
+    }
+
+    file << "frame,frame_ms,cpu_ms,gpu_ms";
+    for (int i = 0; i < GPU_PASS_COUNT; i++) {
+        std::string name = GpuProfiler::getPassName(static_cast<GpuPass>(i));
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        file << "," << name << "_cpu_ms," << name << "_gpu_ms";
+    }
+    file << ",draw_calls,triangles,shader_binds,texture_binds,commands,culled,occluded"
+         << ",vertices_submitted,primitives_submitted,clipped_primitives,fragment_invocations\n";
+
+    file << std::fixed << std::setprecision(4);
+    for (const auto& sample : m_samples) {
+        const RenderStats& s = sample.stats;
+        file << sample.frame << "," << sample.frameTime << "," << s.cpuTime << "," << s.gpuTime;
+        for (int i = 0; i < GPU_PASS_COUNT; i++) {
+            file << "," << s.passCpuTime[i] << "," << s.passGpuTime[i];
+        }
+        file << "," << s.drawCalls << "," << s.triangles << "," << s.shaderBinds
+             << "," << s.textureBindings << "," << s.commandsSubmitted << "," << s.commandsCulled
+             << "," << s.commandsOccluded
+             << "," << s.pipeline.verticesSubmitted << "," << s.pipeline.primitivesSubmitted
+             << "," << s.pipeline.clippingOutputPrimitives << "," << s.pipeline.fragmentInvocations
+             << "\n";
+    }
+
+    LOG_INFO("Benchmark results written to " + path);
+    return true;
+}
+
+bool Benchmark::writeJSON(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to write benchmark results: " + path);
+        return false;
+    }
+
+    std::vector<float> frameTimes, cpuTimes, gpuTimes;
+    for (const auto& sample : m_samples) {
+        frameTimes.push_back(sample.frameTime);
+        cpuTimes.push_back(sample.stats.cpuTime);
+        gpuTimes.push_back(sample.stats.gpuTime);
+    }
+
+    auto summary = [](const std::vector<float>& values) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(4)
+            << "{\"p50\": " << percentile(values, 0.5f)
+            << ", \"p95\": " << percentile(values, 0.95f)
+            << ", \"p99\": " << percentile(values, 0.99f) << "}";
+        return out.str();
+    };
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n";
+    file << "  \"scene\": \"" << m_settings.scene << "\",\n";
+    file << "  \"width\": " << m_settings.width << ",\n";
+    file << "  \"height\": " << m_settings.height << ",\n";
+    file << "  \"frames\": " << m_samples.size() << ",\n";
+    file << "  \"renderer\": \"" << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << "\",\n";
+    file << "  \"summary\": {\n";
+    file << "    \"frame_ms\": " << summary(frameTimes) << ",\n";
+    file << "    \"cpu_ms\": " << summary(cpuTimes) << ",\n";
+    file << "    \"gpu_ms\": " << summary(gpuTimes) << "\n";
+    file << "  },\n";
+    file << "  \"samples\": [\n";
+
+    for (size_t i = 0; i < m_samples.size(); i++) {
+        const FrameSample& sample = m_samples[i];
+        const RenderStats& s = sample.stats;
+
+        file << "    {\"frame\": " << sample.frame << ", \"frame_ms\": " << sample.frameTime
+             << ", \"cpu_ms\": " << s.cpuTime << ", \"gpu_ms\": " << s.gpuTime << ", \"passes\": {";
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            file << (p ? ", " : "") << "\"" << GpuProfiler::getPassName(static_cast<GpuPass>(p))
+                 << "\": [" << s.passCpuTime[p] << ", " << s.passGpuTime[p] << "]";
+        }
+        file << "}, \"draw_calls\": " << s.drawCalls << ", \"triangles\": " << s.triangles
+             << ", \"commands\": " << s.commandsSubmitted << ", \"culled\": " << s.commandsCulled
+             << ", \"occluded\": " << s.commandsOccluded
+             << ", \"fragment_invocations\": " << s.pipeline.fragmentInvocations << "}"
+             << (i + 1 < m_samples.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+
+    LOG_INFO("Benchmark results written to " + path);
+    return true;
+}
+
+void Benchmark::logSummary() const {
+    std::vector<float> frameTimes, cpuTimes, gpuTimes;
+    for (const auto& sample : m_samples) {
+        frameTimes.push_back(sample.frameTime);
+        cpuTimes.push_back(sample.stats.cpuTime);
+        gpuTimes.push_back(sample.stats.gpuTime);
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << "Benchmark finished: frame p50 " << percentile(frameTimes, 0.5f)
+        << " ms / p95 " << percentile(frameTimes, 0.95f)
+        << " ms, CPU p50 " << percentile(cpuTimes, 0.5f)
+        << " ms, GPU p50 " << percentile(gpuTimes, 0.5f) << " ms";
+    LOG_INFO(out.str());
+}
+
+} // namespace ExperimentRedbear
@@ -1,13 +1,17 @@
 #include "engine/Game.h"
 #include "engine/SceneManager.h"
 #include "graphics/Renderer.h"
+#include "graphics/ShaderCache.h"
 #include "audio/AudioManager.h"
 #include "ui/TextRenderer.h"
 #include "ui/UIManager.h"
 #include "game/HouseGenerator.h"
 #include "game/ForestGenerator.h"
 #include "core/Logger.h"
+#include "core/JobSystem.h"
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <GLFW/glfw3.h>
 
 namespace ExperimentRedbear {
@@ -32,6 +36,14 @@ bool Game::initialize() {
     windowSettings.vsync = m_config.graphics.vsync;
     windowSettings.title = "Experiment Redbear";
 
+    if (m_benchmarkMode) {
+        windowSettings.width = m_benchmarkSettings.width;
+        windowSettings.height = m_benchmarkSettings.height;
+        windowSettings.fullscreen = false;
+        windowSettings.vsync = false;
+        windowSettings.headless = true;
+    }
+
     if (!m_window.initialize(windowSettings)) {
         LOG_FATAL("Failed to initialize window");
         return false;
@@ -58,6 +70,10 @@ bool Game::initialize() {
     // Initialize input
     m_input.initialize();
 
+    // Worker threads for parallel culling and command recording (the
+    // renderer sizes its per-thread buckets from this)
+    JobSystem::getInstance().initialize();
+
     // Initialize renderer
     auto& renderer = Renderer::getInstance();
     if (!renderer.initialize(m_window.getWidth(), m_window.getHeight())) {
@@ -65,6 +81,19 @@ bool Game::initialize() {
         return false;
     }
 
+    // The post chain (bloom, grading, vignette, grain) follows the config
+    renderer.getSettings().bloom = m_config.graphics.bloom;
+
+    // Scene resolution follows the GPU frame time when enabled
+    RenderSettings& settings = renderer.getSettings();
+    settings.dynamicResolution = m_config.graphics.dynamicResolution;
+    settings.targetFrameTime = m_config.graphics.targetFrameTime;
+    settings.minResolutionScale = std::clamp(m_config.graphics.minResolutionScale, 0.25f, 1.0f);
+    settings.maxResolutionScale = std::clamp(m_config.graphics.maxResolutionScale, settings.minResolutionScale, 1.0f);
+
+    // Trees are culled on the GPU when enabled and supported
+    settings.gpuTreeCulling = m_config.graphics.gpuTreeCulling;
+
     // Initialize text renderer
     auto& textRenderer = TextRenderer::getInstance();
     if (!textRenderer.initialize()) {
@@ -84,9 +113,9 @@ bool Game::initialize() {
     auto& uiManager = UIManager::getInstance();
     uiManager.initialize(m_window.getWidth(), m_window.getHeight());
 
-    // Initialize audio
+    // Initialize audio (benchmark runs are silent)
     auto& audioManager = AudioManager::getInstance();
-    if (!audioManager.initialize()) {
+    if (!m_benchmarkMode && !audioManager.initialize()) {
         LOG_WARNING("Failed to initialize audio manager - continuing without audio");
     }
 
@@ -106,11 +135,16 @@ bool Game::initialize() {
     // Initialize player
     m_player.initialize();
 
+    // Every startup program has linked by now
+    ShaderCache::getInstance().logSummary();
+
     // Set game state
     m_state = GameState::MAIN_MENU;
 
     // Hide cursor for gameplay, show for menu
-    glfwSetInputMode(m_window.getNativeWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    if (!m_window.isHeadless()) {
+        glfwSetInputMode(m_window.getNativeWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    }
 
     m_initialized = true;
     m_running = true;
@@ -125,6 +159,13 @@ void Game::run() {
         return;
     }
 
+    if (m_benchmarkMode) {
+        Benchmark benchmark;
+        m_exitCode = benchmark.run(*this, m_benchmarkSettings) ? 0 : 1;
+        shutdown();
+        return;
+    }
+
     LOG_INFO("Starting game loop");
 
     while (m_running && !m_window.shouldClose()) {
@@ -134,13 +175,20 @@ void Game::run() {
     shutdown();
 }
 
+void Game::setBenchmark(const BenchmarkSettings& settings) {
+    m_benchmarkSettings = settings;
+    m_benchmarkMode = true;
+}
+
 void Game::shutdown() {
     LOG_INFO("Shutting down game engine...");
 
     m_running = false;
 
     // Save configuration
-    m_config.save("config.cfg");
+    if (!m_benchmarkMode) {
+        m_config.save("config.cfg");
+    }
 
     // Shutdown systems
     auto& audioManager = AudioManager::getInstance();
@@ -152,9 +200,14 @@ void Game::shutdown() {
     auto& textRenderer = TextRenderer::getInstance();
     textRenderer.shutdown();
 
+    // Release world meshes while the GL context is still alive
+    m_world.getForest().shutdown();
+
     auto& renderer = Renderer::getInstance();
     renderer.shutdown();
 
+    JobSystem::getInstance().shutdown();
+
     m_window.shutdown();
 
     m_initialized = false;
@@ -184,9 +237,11 @@ void Game::mainLoop() {
     // Update
     update(deltaTime);
 
+    // Swap in shaders that finished compiling and pick up edited ones
+    ShaderProgram::update(deltaTime);
+
     // Render
-    render();
-    renderUI();
+    renderFrame();
 
     // Swap buffers
     m_window.swapBuffers();
@@ -336,6 +391,32 @@ void Game::updatePlaying(float deltaTime) {
                   << m_player.getPosition().y << ", " 
                   << m_player.getPosition().z << "\n";
         debugInfo << "State: " << static_cast<int>(m_player.getState()) << "\n";
+
+        const RenderStats& stats = Renderer::getInstance().getStats();
+        debugInfo << std::fixed << std::setprecision(2);
+        debugInfo << "CPU: " << stats.cpuTime << " ms  GPU: " << stats.gpuTime << " ms"
+                  << "  Scale: " << stats.resolutionScale << "\n";
+        for (int i = 0; i < GPU_PASS_COUNT; i++) {
+            debugInfo << "  " << GpuProfiler::getPassName(static_cast<GpuPass>(i)) << ": "
+                      << stats.passCpuTime[i] << " / " << stats.passGpuTime[i] << " ms\n";
+        }
+        debugInfo << "Draws: " << stats.drawCalls << " (" << stats.commandsBatched << " batched)"
+                  << "  Tris: " << stats.triangles
+                  << "  Culled: " << stats.commandsCulled << "/" << stats.commandsSubmitted
+                  << "  Occluded: " << stats.commandsOccluded
+                  << "  Trees: " << stats.treeInstancesDrawn
+                  << "  Impostors: " << stats.impostorsDrawn << "\n";
+        debugInfo << "Shadow tiles: " << stats.shadowTilesRendered << " rendered, "
+                  << stats.shadowTilesCached << " cached  Cascades: "
+                  << stats.shadowCascadesRendered << "\n";
+        debugInfo << "State: " << stats.stateChangesIssued << " issued, "
+                  << stats.stateChangesElided << " elided  Stream: " << stats.streamKilobytes << " KB"
+                  << (stats.streamStalled ? " (stalled)" : "") << "\n";
+        if (Renderer::getInstance().getProfiler().hasPipelineStatistics()) {
+            debugInfo << "Verts: " << stats.pipeline.verticesSubmitted
+                      << "  Prims: " << stats.pipeline.clippingOutputPrimitives
+                      << "  Frags: " << stats.pipeline.fragmentInvocations << "\n";
+        }
         m_hud.setDebugInfo(debugInfo.str());
     }
     m_hud.setShowDebugInfo(config.gameplay.showFPS);
@@ -347,6 +428,11 @@ void Game::fixedUpdate(float fixedDeltaTime) {
     }
 }
 
+void Game::renderFrame() {
+    render();
+    renderUI();
+}
+
 void Game::render() {
     auto& renderer = Renderer::getInstance();
 
@@ -367,6 +453,7 @@ void Game::render() {
 
 void Game::renderUI() {
     auto& renderer = Renderer::getInstance();
+    renderer.getProfiler().beginPass(GpuPass::UI);
 
     switch (m_state) {
         case GameState::MAIN_MENU:
@@ -389,6 +476,9 @@ void Game::renderUI() {
         default:
             break;
     }
+
+    TextRenderer::getInstance().endTextPass();
+    renderer.getProfiler().endPass(GpuPass::UI);
 }
 
 void Game::setState(GameState state) {
@@ -401,27 +491,10 @@ void Game::newGame() {
     m_state = GameState::LOADING;
 
     // Initialize world
-    WorldSettings worldSettings;
-    worldSettings.name = "Experiment Redbear";
-    worldSettings.playerStart = glm::vec3(1.5f, 1.7f, 1.5f);  // Bedroom position
-    worldSettings.enableSnow = true;
-    worldSettings.enableFog = true;
-
-    m_world.initialize(worldSettings);
-
-    // Generate house
-    HouseGenerator houseGen;
-    houseGen.generate(&m_world, glm::vec3(0.0f));
-
-    // Generate forest
-    ForestGenerator forestGen;
-    forestGen.generate(&m_world, glm::vec3(0.0f), 200.0f);
+    initializeWorld();
 
     // Set player position
-    m_player.setPosition(worldSettings.playerStart);
-
-    // Initialize renderer lighting
-    Renderer::getInstance().setAmbientLight(glm::vec3(0.02f, 0.02f, 0.03f), 1.0f);
+    m_player.setPosition(m_world.getSettings().playerStart);
 
     // Show objective
     m_hud.showObjective("Find a way out of the house");
@@ -437,6 +510,48 @@ void Game::newGame() {
     }
 }
 
+void Game::initializeWorld(bool generateHouse, bool generateForest) {
+    WorldSettings worldSettings;
+    worldSettings.name = "Experiment Redbear";
+    worldSettings.playerStart = glm::vec3(1.5f, 1.7f, 1.5f);  // Bedroom position
+    worldSettings.enableSnow = true;
+    worldSettings.enableFog = true;
+
+    m_world.initialize(worldSettings);
+
+    // Walls and large trunks become occluders for software occlusion culling
+    std::vector<Occluder> occluders;
+
+    // Generate house
+    if (generateHouse) {
+        HouseGenerator houseGen;
+        houseGen.generate(&m_world, glm::vec3(0.0f));
+        houseGen.getOccluders(occluders);
+    }
+
+    // Generate forest
+    if (generateForest) {
+        ForestGenerator forestGen;
+        forestGen.generate(&m_world, glm::vec3(0.0f), 200.0f);
+        m_world.getForest().getOccluders(occluders);
+    }
+
+    // Initialize renderer lighting
+    auto& renderer = Renderer::getInstance();
+    renderer.setAmbientLight(glm::vec3(0.02f, 0.02f, 0.03f), 1.0f);
+    renderer.clearLights();
+    renderer.getOcclusionCuller().setOccluders(occluders);
+
+    // Dim moonlight over the forest, shadowed by the cascades
+    if (generateForest) {
+        renderer.addLight(Light::createDirectional(glm::normalize(glm::vec3(-0.3f, -0.8f, -0.5f)),
+                                                   glm::vec3(0.45f, 0.5f, 0.7f), 0.25f));
+    }
+
+    // Static geometry changed, cached shadow maps are stale
+    renderer.invalidateShadowCache();
+}
+
 void Game::continueGame() {
     // Load saved game
     LOG_INFO("Continuing game...");
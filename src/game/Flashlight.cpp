@@ -22,6 +22,7 @@ void Flashlight::initialize() {
     m_batteryLevel = m_maxBattery;
     m_light.castShadows = true;
     m_light.shadowMapResolution = 512;
+    m_light.staticShadows = false;  // Moves with the player every frame
 }
 
 void Flashlight::update(float deltaTime, const glm::vec3& position, const glm::vec3& direction) {
@@ -0,0 +1,409 @@
+#include "game/Forest.h"
+#include "graphics/Model.h"
+#include "graphics/Renderer.h"
+#include "graphics/ImpostorAtlas.h"
+#include "graphics/MeshSimplifier.h"
+#include "graphics/OcclusionCuller.h"
+#include "core/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr float PI = 3.14159265f;
+
+static_assert(Forest::VARIANT_COUNT * Forest::TRUNK_VARIANTS <= ImpostorAtlas::MAX_VARIANTS,
+              "Every type and trunk ratio needs its own impostor layer");
+
+const glm::vec3 BARK_COLOR(0.18f, 0.13f, 0.09f);
+const glm::vec3 DEAD_BARK_COLOR(0.2f, 0.19f, 0.18f);
+const glm::vec3 PINE_COLOR(0.06f, 0.12f, 0.07f);
+const glm::vec3 OAK_COLOR(0.1f, 0.13f, 0.06f);
+
+// Unit trunk of each tree type, tapering from UNIT_TRUNK_RADIUS at the base
+struct TrunkShape {
+    float length;
+    float tipRadius;
+    int segments;
+    int rings;
+};
+
+constexpr TrunkShape TRUNK_SHAPES[Forest::VARIANT_COUNT] = {
+    {0.85f, 0.004f, 10, 4},   // Pine
+    {0.62f, 0.012f, 10, 4},   // Oak
+    {1.0f, 0.003f, 10, 6}     // Dead
+};
+
+struct MeshBuilder {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    void addVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv,
+                   const glm::vec3& tangent) {
+        Vertex vertex;
+        vertex.position = position;
+        vertex.normal = normal;
+        vertex.texCoords = uv;
+        vertex.tangent = tangent;
+        vertex.bitangent = glm::cross(normal, tangent);
+        vertices.push_back(vertex);
+    }
+
+    // Tapered tube from a to b. A zero top radius makes a cone.
+    void addTube(const glm::vec3& a, const glm::vec3& b, float r0, float r1, int segments, int rings,
+                 bool bottomCap = false) {
+        glm::vec3 axis = b - a;
+        float length = glm::length(axis);
+        glm::vec3 dir = axis / length;
+        glm::vec3 reference = std::abs(dir.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 u = glm::normalize(glm::cross(dir, reference));
+        glm::vec3 w = glm::cross(dir, u);
+
+        const unsigned int base = static_cast<unsigned int>(vertices.size());
+        for (int k = 0; k <= rings; k++) {
+            float t = static_cast<float>(k) / rings;
+            glm::vec3 center = a + axis * t;
+            float radius = r0 + (r1 - r0) * t;
+            for (int s = 0; s <= segments; s++) {
+                float angle = 2.0f * PI * s / segments;
+                glm::vec3 radial = std::cos(angle) * u + std::sin(angle) * w;
+                glm::vec3 normal = glm::normalize(radial * length + dir * (r0 - r1));
+                glm::vec3 tangent = -std::sin(angle) * u + std::cos(angle) * w;
+                addVertex(center + radial * radius, normal, glm::vec2(static_cast<float>(s) / segments, t), tangent);
+            }
+        }
+
+        const unsigned int stride = static_cast<unsigned int>(segments + 1);
+        for (int k = 0; k < rings; k++) {
+            for (int s = 0; s < segments; s++) {
+                unsigned int i0 = base + k * stride + s;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + stride;
+                unsigned int i3 = i2 + 1;
+                indices.insert(indices.end(), {i0, i1, i3});
+                // The top ring of a cone is a single point
+                if (k + 1 < rings || r1 > 0.0f) {
+                    indices.insert(indices.end(), {i0, i3, i2});
+                }
+            }
+        }
+
+        if (bottomCap) {
+            const unsigned int center = static_cast<unsigned int>(vertices.size());
+            addVertex(a, -dir, glm::vec2(0.5f), u);
+            for (int s = 0; s <= segments; s++) {
+                float angle = 2.0f * PI * s / segments;
+                glm::vec3 radial = std::cos(angle) * u + std::sin(angle) * w;
+                addVertex(a + radial * r0, -dir, glm::vec2(0.5f) + glm::vec2(std::cos(angle), std::sin(angle)) * 0.5f, u);
+            }
+            for (int s = 0; s < segments; s++) {
+                indices.insert(indices.end(), {center, center + 2 + s, center + 1 + s});
+            }
+        }
+    }
+
+    // Lumpy ellipsoid for broadleaf canopies
+    void addBlob(const glm::vec3& center, const glm::vec3& radii, int segments, int rings, float lumpiness,
+                 float seed) {
+        const unsigned int base = static_cast<unsigned int>(vertices.size());
+        for (int k = 0; k <= rings; k++) {
+            float phi = PI * k / rings;
+            for (int s = 0; s <= segments; s++) {
+                float theta = 2.0f * PI * s / segments;
+                glm::vec3 unit(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+                float displacement = 1.0f + lumpiness * std::sin(3.0f * theta + seed) * std::sin(4.0f * phi + seed * 1.7f);
+                glm::vec3 normal = glm::normalize(unit / radii);
+                glm::vec3 tangent(-std::sin(theta), 0.0f, std::cos(theta));
+                addVertex(center + unit * radii * displacement, normal,
+                          glm::vec2(static_cast<float>(s) / segments, static_cast<float>(k) / rings), tangent);
+            }
+        }
+
+        const unsigned int stride = static_cast<unsigned int>(segments + 1);
+        for (int k = 0; k < rings; k++) {
+            for (int s = 0; s < segments; s++) {
+                unsigned int i0 = base + k * stride + s;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + stride;
+                unsigned int i3 = i2 + 1;
+                indices.insert(indices.end(), {i0, i3, i2});
+                indices.insert(indices.end(), {i0, i1, i3});
+            }
+        }
+    }
+
+    glm::vec4 getBounds() const {
+        glm::vec3 minBounds(std::numeric_limits<float>::max());
+        glm::vec3 maxBounds(-std::numeric_limits<float>::max());
+        for (const auto& vertex : vertices) {
+            minBounds = glm::min(minBounds, vertex.position);
+            maxBounds = glm::max(maxBounds, vertex.position);
+        }
+        glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+        float radius = 0.0f;
+        for (const auto& vertex : vertices) {
+            radius = std::max(radius, glm::length(vertex.position - center));
+        }
+        return glm::vec4(center, radius);
+    }
+};
+
+} // namespace
+
+Forest::Forest() {}
+
+Forest::~Forest() = default;
+
+bool Forest::initialize() {
+    if (m_initialized) return true;
+
+    buildVariants();
+
+    // Bake every variant as seen from the upper hemisphere, once per trunk
+    // ratio. Impostors scale uniformly with height, so the trunk is widened
+    // to the ratio in unit space.
+    const glm::vec3 trunkColors[VARIANT_COUNT] = {BARK_COLOR, BARK_COLOR, DEAD_BARK_COLOR};
+    const glm::vec3 foliageColors[VARIANT_COUNT] = {PINE_COLOR, OAK_COLOR, DEAD_BARK_COLOR};
+
+    std::vector<ImpostorSource> sources(VARIANT_COUNT * TRUNK_VARIANTS);
+    for (int type = 0; type < VARIANT_COUNT; type++) {
+        const Variant& variant = m_variants[type];
+        for (int thickness = 0; thickness < TRUNK_VARIANTS; thickness++) {
+            const float trunkScale = TRUNK_RATIOS[thickness] / UNIT_TRUNK_RADIUS;
+            ImpostorSource& source = sources[type * TRUNK_VARIANTS + thickness];
+            source.center = glm::vec3(variant.bounds);
+            source.radius = variant.bounds.w;
+            source.parts = {{variant.parts[TRUNK].get(), trunkColors[type], glm::vec3(trunkScale, 1.0f, trunkScale)},
+                            {variant.parts[FOLIAGE].get(), foliageColors[type]}};
+        }
+    }
+
+    Renderer::getInstance().getImpostors().bake(sources);
+    Renderer::getInstance().getForestRenderer().setImpostorFade(IMPOSTOR_DISTANCE - FADE_RANGE, FADE_RANGE);
+
+    m_initialized = true;
+    return true;
+}
+
+void Forest::shutdown() {
+    Renderer::getInstance().getForestRenderer().clear();
+    for (auto& variant : m_variants) {
+        for (auto& part : variant.parts) {
+            part.reset();
+        }
+    }
+    m_instances.clear();
+    m_initialized = false;
+}
+
+void Forest::buildVariants() {
+    MeshBuilder builders[VARIANT_COUNT][PART_COUNT];
+
+    // Tapered trunks; getOccluders() fits its boxes to the same shapes
+    for (int type = 0; type < VARIANT_COUNT; type++) {
+        const TrunkShape& trunk = TRUNK_SHAPES[type];
+        builders[type][TRUNK].addTube(glm::vec3(0.0f), glm::vec3(0.0f, trunk.length, 0.0f), UNIT_TRUNK_RADIUS,
+                                      trunk.tipRadius, trunk.segments, trunk.rings);
+    }
+
+    // Pine: thin trunk inside stacked cones
+    for (int tier = 0; tier < 5; tier++) {
+        float baseY = 0.2f + tier * 0.14f;
+        float radius = 0.3f * (1.0f - tier * 0.16f);
+        builders[0][FOLIAGE].addTube(glm::vec3(0.0f, baseY, 0.0f), glm::vec3(0.0f, baseY + 0.24f, 0.0f),
+                                     radius, 0.0f, 18, 3, true);
+    }
+
+    // Oak: short trunk under a cluster of lumpy blobs
+    builders[1][FOLIAGE].addBlob(glm::vec3(0.0f, 0.7f, 0.0f), glm::vec3(0.3f, 0.24f, 0.3f), 22, 14, 0.08f, 0.0f);
+    builders[1][FOLIAGE].addBlob(glm::vec3(0.12f, 0.78f, 0.08f), glm::vec3(0.18f), 22, 14, 0.08f, 1.3f);
+    builders[1][FOLIAGE].addBlob(glm::vec3(-0.1f, 0.62f, -0.12f), glm::vec3(0.17f), 22, 14, 0.08f, 2.6f);
+
+    // Dead: tall bare trunk, the "foliage" is a spiral of bare branches
+    for (int branch = 0; branch < 7; branch++) {
+        float y = 0.35f + branch * 0.08f;
+        float angle = branch * 2.4f;
+        float length = 0.22f * (1.0f - branch * 0.08f);
+        glm::vec3 start(0.0f, y, 0.0f);
+        glm::vec3 dir = glm::normalize(glm::vec3(std::cos(angle), 0.7f, std::sin(angle)));
+        builders[2][FOLIAGE].addTube(start, start + dir * length, 0.008f, 0.0015f, 5, 2);
+    }
+
+    auto& materials = Renderer::getInstance().getMaterials();
+    const glm::vec3 colors[VARIANT_COUNT][PART_COUNT] = {
+        {BARK_COLOR, PINE_COLOR},
+        {BARK_COLOR, OAK_COLOR},
+        {DEAD_BARK_COLOR, DEAD_BARK_COLOR}
+    };
+
+    for (int type = 0; type < VARIANT_COUNT; type++) {
+        Variant& variant = m_variants[type];
+        MeshBuilder whole;
+
+        for (int part = 0; part < PART_COUNT; part++) {
+            MeshBuilder& builder = builders[type][part];
+            if (builder.indices.empty()) continue;
+
+            MaterialDesc desc;
+            desc.baseColor = glm::vec4(colors[type][part], 1.0f);
+
+            variant.parts[part] = std::make_unique<Mesh>();
+            variant.parts[part]->create(builder.vertices, builder.indices, {});
+            variant.parts[part]->setMaterialIndex(materials.createMaterial(desc));
+            variant.parts[part]->generateLods(4, 0.4f, 32);
+            variant.partBounds[part] = builder.getBounds();
+            Renderer::getInstance().getForestRenderer().setMesh(type, part, variant.parts[part].get());
+
+            whole.vertices.insert(whole.vertices.end(), builder.vertices.begin(), builder.vertices.end());
+        }
+
+        variant.bounds = whole.getBounds();
+        Renderer::getInstance().getForestRenderer().setTypeBounds(type, variant.partBounds, variant.bounds);
+    }
+}
+
+void Forest::setTrees(const std::vector<Tree>& trees) {
+    initialize();
+
+    m_instances.clear();
+    m_instances.reserve(trees.size());
+
+    std::vector<GPUTreeInstance> gpuInstances;
+    std::vector<glm::vec4> bounds;
+    gpuInstances.reserve(trees.size());
+    bounds.reserve(trees.size());
+
+    for (const auto& tree : trees) {
+        Instance instance;
+        instance.position = tree.position;
+        instance.height = tree.height;
+        instance.yaw = glm::radians(tree.rotation);
+        instance.type = std::clamp(tree.type, 0, VARIANT_COUNT - 1);
+
+        const Variant& variant = m_variants[instance.type];
+        glm::mat4 base = glm::rotate(glm::translate(glm::mat4(1.0f), tree.position), instance.yaw,
+                                     glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // The trunk takes the baked ratio nearest to the generated one, the
+        // rest scales with height. The tree shaders rebuild the same
+        // matrices on the GPU.
+        const float ratio = tree.trunkRadius / tree.height;
+        int thickness = 0;
+        for (int k = 1; k < TRUNK_VARIANTS; k++) {
+            if (std::abs(std::log(ratio / TRUNK_RATIOS[k])) < std::abs(std::log(ratio / TRUNK_RATIOS[thickness]))) {
+                thickness = k;
+            }
+        }
+        instance.impostorVariant = instance.type * TRUNK_VARIANTS + thickness;
+        instance.trunkRadius = TRUNK_RATIOS[thickness] * tree.height;
+        float trunkScale = instance.trunkRadius / UNIT_TRUNK_RADIUS;
+        glm::vec3 scales[PART_COUNT] = {
+            glm::vec3(trunkScale, tree.height, trunkScale),
+            glm::vec3(tree.height)
+        };
+
+        for (int part = 0; part < PART_COUNT; part++) {
+            glm::mat4 model = glm::scale(base, scales[part]);
+            glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(variant.partBounds[part]), 1.0f));
+            float scale = std::max(scales[part].x, std::max(scales[part].y, scales[part].z));
+            instance.partBounds[part] = glm::vec4(center, variant.partBounds[part].w * scale);
+        }
+
+        glm::vec3 center = glm::vec3(glm::scale(base, glm::vec3(tree.height)) * glm::vec4(glm::vec3(variant.bounds), 1.0f));
+        instance.bounds = glm::vec4(center, variant.bounds.w * tree.height);
+
+        GPUTreeInstance gpuInstance;
+        gpuInstance.positionHeight = glm::vec4(tree.position, tree.height);
+        gpuInstance.params = glm::vec4(instance.yaw, static_cast<float>(instance.type), trunkScale,
+                                       static_cast<float>(instance.impostorVariant));
+        gpuInstances.push_back(gpuInstance);
+        bounds.push_back(instance.bounds);
+
+        m_instances.push_back(instance);
+    }
+
+    Renderer::getInstance().getForestRenderer().setInstances(gpuInstances, bounds);
+}
+
+void Forest::getOccluders(std::vector<Occluder>& occluders, float minTrunkRadius) const {
+    // Boxes reach halfway up the trunk. The tube is thinnest there, and a
+    // square fits inside its polygon at any yaw when its corners stay within
+    // the apothem.
+    constexpr float TOP = 0.5f;
+    for (const auto& instance : m_instances) {
+        if (instance.trunkRadius < minTrunkRadius) continue;
+
+        const TrunkShape& shape = TRUNK_SHAPES[instance.type];
+        float taper = 1.0f + (shape.tipRadius / UNIT_TRUNK_RADIUS - 1.0f) * TOP;
+        float apothem = instance.trunkRadius * taper * std::cos(PI / shape.segments);
+        float halfWidth = apothem / std::sqrt(2.0f);
+
+        Occluder occluder;
+        occluder.min = instance.position + glm::vec3(-halfWidth, 0.0f, -halfWidth);
+        occluder.max = instance.position + glm::vec3(halfWidth, shape.length * TOP * instance.height, halfWidth);
+        occluders.push_back(occluder);
+    }
+}
+
+void Forest::clear() {
+    m_instances.clear();
+    Renderer::getInstance().getForestRenderer().setInstances({}, {});
+}
+
+void Forest::render(const Camera& camera) {
+    if (m_instances.empty()) return;
+
+    auto& renderer = Renderer::getInstance();
+    ForestRenderer& trees = renderer.getForestRenderer();
+
+    // The renderer culls the trees on the GPU, impostors included
+    if (trees.isGpuCulling()) return;
+
+    const glm::vec3 eye = camera.getPosition();
+    const bool impostors = renderer.getImpostors().isBaked();
+    const float fadeStart = IMPOSTOR_DISTANCE - FADE_RANGE;
+    const float viewportHeight = static_cast<float>(renderer.getRenderHeight());
+
+    for (size_t i = 0; i < m_instances.size(); i++) {
+        Instance& instance = m_instances[i];
+        const glm::vec3 center(instance.bounds);
+        float distance = glm::length(center - eye);
+        float impostorFade = impostors ? std::clamp((distance - fadeStart) / FADE_RANGE, 0.0f, 1.0f) : 0.0f;
+
+        if (impostorFade > 0.0f && camera.isInFrustum(center, instance.bounds.w)) {
+            ImpostorInstance billboard;
+            billboard.positionScale = glm::vec4(instance.position, instance.height);
+            billboard.params = glm::vec4(instance.yaw, static_cast<float>(instance.impostorVariant), impostorFade, 0.0f);
+            renderer.submitImpostor(billboard);
+        }
+        if (impostorFade >= 1.0f) continue;
+
+        const Variant& variant = m_variants[instance.type];
+        for (int part = 0; part < PART_COUNT; part++) {
+            const Mesh* mesh = variant.parts[part].get();
+            if (!mesh) continue;
+
+            const glm::vec3 partCenter(instance.partBounds[part]);
+            const float partRadius = instance.partBounds[part].w;
+            if (!camera.isInFrustum(partCenter, partRadius)) continue;
+
+            // While cross-fading, the mesh side is pinned to its coarsest level
+            const std::vector<MeshLod>& lods = mesh->getLods();
+            int lod = static_cast<int>(lods.size()) - 1;
+            if (impostorFade <= 0.0f) {
+                float screenSize = camera.getScreenSize(partCenter, partRadius, viewportHeight);
+                lod = MeshSimplifier::selectLod(lods.data(), static_cast<int>(lods.size()), screenSize,
+                                                instance.lodState[part]);
+                instance.lodState[part] = static_cast<uint8_t>(lod);
+            }
+
+            trees.addVisible(static_cast<uint32_t>(i), part, lod, 1.0f - impostorFade);
+        }
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -1,11 +1,22 @@
 #include "game/ForestGenerator.h"
 #include "game/World.h"
+#include "graphics/Renderer.h"
 #include "core/Logger.h"
+#include "core/JobSystem.h"
 #include <random>
 #include <cmath>
 
 namespace ExperimentRedbear {
 
+namespace {
+
+// Heightfield samples per side (2^n + 1, so quadtree nodes start on samples)
+constexpr int TERRAIN_RESOLUTION = 513;
+
+const glm::vec3 SNOW_COLOR(0.42f, 0.44f, 0.48f);
+
+} // namespace
+
 ForestGenerator::ForestGenerator() : m_noise(42) {}
 
 ForestGenerator::~ForestGenerator() = default;
@@ -23,6 +34,8 @@ void ForestGenerator::generate(World* world, const glm::vec3& center, float radi
     generateTerrain(world);
     generateTrees();
     generateSnow();
+
+    world->getForest().setTrees(m_trees);
 }
 
 void ForestGenerator::generateTerrain(World* world) {
@@ -43,34 +56,28 @@ void ForestGenerator::generateTerrain(World* world) {
     groundCollider.tag = "ground";
     world->addCollider(groundCollider);
 
-    // Generate ground mesh vertices
-    int gridSize = 100;
-    float cellSize = (m_radius * 2.0f) / gridSize;
+    // Bake the heightfield for the CDLOD terrain, one row per job
+    const int resolution = TERRAIN_RESOLUTION;
+    const float spacing = (m_radius * 2.0f) / (resolution - 1);
+    std::vector<float> heights(static_cast<size_t>(resolution) * resolution);
 
-    for (int i = 0; i <= gridSize; i++) {
-        for (int j = 0; j <= gridSize; j++) {
-            float x = m_center.x - m_radius + i * cellSize;
-            float z = m_center.z - m_radius + j * cellSize;
+    JobSystem::getInstance().parallelFor(resolution, 16, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            float z = m_center.z - m_radius + row * spacing;
+            for (int column = 0; column < resolution; column++) {
+                float x = m_center.x - m_radius + column * spacing;
 
-            // Use Perlin noise for terrain height variation
-            float height = m_noise.octaveNoise(x * 0.01f, z * 0.01f, 4, 0.5f) * 0.5f;
-
-            m_groundVertices.push_back(glm::vec3(x, height, z));
+                // Use Perlin noise for terrain height variation
+                heights[row * resolution + column] = m_noise.octaveNoise(x * 0.01f, z * 0.01f, 4, 0.5f) * 0.5f;
+            }
         }
-    }
+    });
 
-    // Generate indices
-    for (int i = 0; i < gridSize; i++) {
-        for (int j = 0; j < gridSize; j++) {
-            int idx = i * (gridSize + 1) + j;
-            m_groundIndices.push_back(idx);
-            m_groundIndices.push_back(idx + gridSize + 1);
-            m_groundIndices.push_back(idx + 1);
-
-            m_groundIndices.push_back(idx + 1);
-            m_groundIndices.push_back(idx + gridSize + 1);
-            m_groundIndices.push_back(idx + gridSize + 2);
-        }
+    Terrain& terrain = Renderer::getInstance().getTerrain();
+    if (terrain.create(heights, resolution, glm::vec2(m_center.x - m_radius, m_center.z - m_radius), m_radius * 2.0f)) {
+        MaterialDesc snow;
+        snow.baseColor = glm::vec4(SNOW_COLOR, 1.0f);
+        terrain.setMaterial(Renderer::getInstance().getMaterials().createMaterial(snow));
     }
 }
 
@@ -119,6 +126,10 @@ void ForestGenerator::generateTrees() {
         }
         if (tooClose) continue;
 
+        // Sit on the terrain, slightly sunk so the root never floats
+        const Terrain& terrain = Renderer::getInstance().getTerrain();
+        pos.y = terrain.getHeight(pos.x, pos.z) - 0.05f;
+
         Tree tree;
         tree.position = pos;
         tree.height = heightDist(rng);
@@ -4,9 +4,66 @@
 #include "game/Item.h"
 #include "core/Logger.h"
 #include <random>
+#include <algorithm>
+#include <cmath>
 
 namespace ExperimentRedbear {
 
+namespace {
+
+constexpr float WALL_THICKNESS = 0.1f;
+constexpr float DOOR_HALF_WIDTH = 0.6f;
+constexpr float WINDOW_HALF_WIDTH = 0.8f;
+
+struct Opening {
+    glm::vec3 position;
+    float halfWidth;
+};
+
+// Adds the solid parts of a wall at plane along fixedAxis (0 = x, 2 = z),
+// running from runMin to runMax on the other horizontal axis. Openings
+// within reach of the plane cut full-height gaps, so nothing seen through
+// a door or window is ever culled.
+void addWallSegments(std::vector<Occluder>& occluders, const std::vector<Opening>& openings,
+                     int fixedAxis, float plane, float runMin, float runMax, float floorY, float height) {
+    const int runAxis = fixedAxis == 0 ? 2 : 0;
+
+    std::vector<std::pair<float, float>> gaps;
+    for (const auto& opening : openings) {
+        if (std::abs(opening.position[fixedAxis] - plane) > 0.3f) continue;
+        if (opening.position.y < floorY - 0.5f || opening.position.y > floorY + height) continue;
+
+        // Clipped to the run, so an opening near a corner still cuts its part
+        float center = opening.position[runAxis];
+        float start = std::max(center - opening.halfWidth, runMin);
+        float end = std::min(center + opening.halfWidth, runMax);
+        if (start >= end) continue;
+        gaps.push_back({start, end});
+    }
+    std::sort(gaps.begin(), gaps.end());
+
+    auto addSegment = [&](float start, float end) {
+        if (end - start < 0.2f) return;
+        Occluder occluder;
+        occluder.min[fixedAxis] = plane - WALL_THICKNESS * 0.5f;
+        occluder.max[fixedAxis] = plane + WALL_THICKNESS * 0.5f;
+        occluder.min[runAxis] = start;
+        occluder.max[runAxis] = end;
+        occluder.min.y = floorY;
+        occluder.max.y = floorY + height;
+        occluders.push_back(occluder);
+    };
+
+    float cursor = runMin;
+    for (const auto& gap : gaps) {
+        addSegment(cursor, std::min(gap.first, runMax));
+        cursor = std::max(cursor, gap.second);
+    }
+    addSegment(cursor, runMax);
+}
+
+} // namespace
+
 HouseGenerator::HouseGenerator() {}
 
 HouseGenerator::~HouseGenerator() = default;
@@ -40,7 +97,7 @@ void HouseGenerator::generateLayout() {
     bedroom.position = glm::vec3(0.0f, 0.0f, 0.0f);
     bedroom.size = glm::vec3(5.0f, 3.0f, 5.0f);
     bedroom.doorPositions = {
-        glm::vec3(2.5f, 0.0f, 2.5f)  // Door to hallway
+        glm::vec3(2.5f, 0.0f, 5.0f)  // Door to hallway
     };
     bedroom.itemSpawnPoints = {
         glm::vec3(1.0f, 0.8f, 1.0f),   // Desk (flashlight location)
@@ -65,10 +122,10 @@ void HouseGenerator::generateLayout() {
     // Bathroom
     Room bathroom;
     bathroom.name = "Bathroom";
-    bathroom.position = glm::vec3(5.0f, 0.0f, 5.0f);
+    bathroom.position = glm::vec3(5.0f, 0.0f, 2.0f);
     bathroom.size = glm::vec3(3.0f, 3.0f, 3.0f);
     bathroom.doorPositions = {
-        glm::vec3(0.0f, 0.0f, 1.5f)    // Door to hallway
+        glm::vec3(2.5f, 0.0f, 3.0f)    // Door to hallway
     };
     groundFloor.rooms.push_back(bathroom);
 
@@ -78,8 +135,8 @@ void HouseGenerator::generateLayout() {
     livingRoom.position = glm::vec3(-5.0f, 0.0f, 5.0f);
     livingRoom.size = glm::vec3(5.0f, 3.0f, 6.0f);
     livingRoom.doorPositions = {
-        glm::vec3(5.0f, 0.0f, 2.0f),   // To hallway
-        glm::vec3(-2.5f, 0.0f, 6.0f)   // To kitchen
+        glm::vec3(5.0f, 0.0f, 1.0f),   // To hallway
+        glm::vec3(2.5f, 0.0f, 6.0f)    // To kitchen
     };
     livingRoom.itemSpawnPoints = {
         glm::vec3(-6.0f, 0.4f, 7.0f),  // Coffee table
@@ -90,11 +147,11 @@ void HouseGenerator::generateLayout() {
     // Kitchen
     Room kitchen;
     kitchen.name = "Kitchen";
-    kitchen.position = glm::vec3(-5.0f, 0.0f, 10.0f);
+    kitchen.position = glm::vec3(-5.0f, 0.0f, 11.0f);
     kitchen.size = glm::vec3(5.0f, 3.0f, 4.0f);
     kitchen.doorPositions = {
-        glm::vec3(-2.5f, 0.0f, 0.0f),  // To living room
-        glm::vec3(-5.0f, 0.0f, 5.0f)   // To outside
+        glm::vec3(2.5f, 0.0f, 0.0f),   // To living room
+        glm::vec3(0.0f, 0.0f, 2.0f)    // To outside
     };
     kitchen.itemSpawnPoints = {
         glm::vec3(-7.0f, 0.9f, 11.0f)  // Kitchen counter
@@ -113,7 +170,7 @@ void HouseGenerator::generateLayout() {
     attic.position = glm::vec3(0.0f, 3.5f, 0.0f);
     attic.size = glm::vec3(10.0f, 2.5f, 8.0f);
     attic.doorPositions = {
-        glm::vec3(5.0f, 3.5f, 4.0f)    // Stairs down
+        glm::vec3(5.0f, 0.0f, 4.0f)    // Stairs down (floor hatch)
     };
     attic.itemSpawnPoints = {
         glm::vec3(2.0f, 4.0f, 3.0f),   // Old boxes
@@ -135,7 +192,7 @@ void HouseGenerator::generateDoors(World* world) {
     for (const auto& floor : m_floors) {
         for (const auto& room : floor.rooms) {
             for (const auto& doorPos : room.doorPositions) {
-                auto door = std::make_shared<Door>(doorPos);
+                auto door = std::make_shared<Door>(m_position + room.position + doorPos);
                 world->addDoor(door);
             }
         }
@@ -204,6 +261,43 @@ void HouseGenerator::generateColliders(World* world) {
     // Add more wall colliders as needed...
 }
 
+void HouseGenerator::getOccluders(std::vector<Occluder>& occluders) const {
+    // generateRooms() builds no wall geometry yet, and occluders for walls
+    // nobody can see would cull the world outside the house
+    if (!m_hasWallGeometry) return;
+
+    // Door and window positions are relative to their room, as
+    // generateDoors() places them; a door listed by one room also opens the
+    // wall of its neighbour
+    std::vector<Opening> openings;
+    for (const auto& floor : m_floors) {
+        for (const auto& room : floor.rooms) {
+            glm::vec3 origin = m_position + room.position;
+            for (const auto& door : room.doorPositions) {
+                openings.push_back({origin + door, DOOR_HALF_WIDTH});
+            }
+            for (const auto& window : room.windowPositions) {
+                openings.push_back({origin + window, WINDOW_HALF_WIDTH});
+            }
+        }
+    }
+
+    size_t first = occluders.size();
+    for (const auto& floor : m_floors) {
+        for (const auto& room : floor.rooms) {
+            glm::vec3 min = m_position + room.position;
+            glm::vec3 max = min + room.size;
+
+            addWallSegments(occluders, openings, 0, min.x, min.z, max.z, min.y, room.size.y);
+            addWallSegments(occluders, openings, 0, max.x, min.z, max.z, min.y, room.size.y);
+            addWallSegments(occluders, openings, 2, min.z, min.x, max.x, min.y, room.size.y);
+            addWallSegments(occluders, openings, 2, max.z, min.x, max.x, min.y, room.size.y);
+        }
+    }
+
+    LOG_DEBUG("House occluders: " + std::to_string(occluders.size() - first));
+}
+
 void HouseGenerator::generateLighting() {
     LOG_DEBUG("Generating house lighting...");
 }
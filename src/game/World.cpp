@@ -1,6 +1,7 @@
 #include "game/World.h"
 #include "game/HouseGenerator.h"
 #include "game/ForestGenerator.h"
+#include "graphics/Renderer.h"
 #include "core/Logger.h"
 #include <algorithm>
 
@@ -17,6 +18,8 @@ bool World::initialize(const WorldSettings& settings) {
 
     LOG_INFO("Initializing world: " + settings.name);
 
+    m_forest.clear();
+
     return true;
 }
 
@@ -39,7 +42,11 @@ void World::update(float deltaTime) {
 }
 
 void World::render() {
-    // Rendering is handled by the renderer
+    // Rendering is handled by the renderer; the world only submits
+    Camera* camera = Renderer::getInstance().getCamera();
+    if (camera) {
+        m_forest.render(*camera);
+    }
 }
 
 void World::setPlayerStart(const glm::vec3& position, float yaw) {
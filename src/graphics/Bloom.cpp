@@ -0,0 +1,251 @@
+#include "graphics/Bloom.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+#include <algorithm>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr int WORKGROUP_SIZE = 8;
+
+const char* DOWNSAMPLE_SOURCE = R"(
+#version 450 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D sourceTexture;
+layout (r11f_g11f_b10f, binding = 0) uniform writeonly image2D destImage;
+
+uniform float sourceLod;
+uniform bool firstLevel;    // Karis average and threshold on the HDR input
+uniform vec2 threshold;     // x = threshold, y = soft knee
+uniform vec2 sourceScale;   // Part of the source to read, 1 after the first level
+
+vec3 tap(vec2 uv, vec2 texel, float x, float y) {
+    vec2 coord = min((uv + vec2(x, y) * texel) * sourceScale, sourceScale - texel * 0.5);
+    return textureLod(sourceTexture, coord, sourceLod).rgb;
+}
+
+// Weights a block by its inverse luma so single bright pixels can't flicker
+float karisWeight(vec3 c) {
+    return 1.0 / (1.0 + dot(c, vec3(0.2126, 0.7152, 0.0722)) * 0.25);
+}
+
+vec3 softThreshold(vec3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold.x + threshold.y, 0.0, 2.0 * threshold.y);
+    soft = soft * soft / (4.0 * threshold.y + 1e-4);
+    return color * max(soft, brightness - threshold.x) / max(brightness, 1e-4);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destImage);
+    if (any(greaterThanEqual(pixel, size))) return;
+
+    vec2 texel = 1.0 / vec2(textureSize(sourceTexture, int(sourceLod)));
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+
+    // 13 bilinear taps as five overlapping 2x2 boxes:
+    //   a . b . c
+    //   . d . e .
+    //   f . g . h
+    //   . i . j .
+    //   k . l . m
+    vec3 a = tap(uv, texel, -2.0, -2.0);
+    vec3 b = tap(uv, texel,  0.0, -2.0);
+    vec3 c = tap(uv, texel,  2.0, -2.0);
+    vec3 d = tap(uv, texel, -1.0, -1.0);
+    vec3 e = tap(uv, texel,  1.0, -1.0);
+    vec3 f = tap(uv, texel, -2.0,  0.0);
+    vec3 g = tap(uv, texel,  0.0,  0.0);
+    vec3 h = tap(uv, texel,  2.0,  0.0);
+    vec3 i = tap(uv, texel, -1.0,  1.0);
+    vec3 j = tap(uv, texel,  1.0,  1.0);
+    vec3 k = tap(uv, texel, -2.0,  2.0);
+    vec3 l = tap(uv, texel,  0.0,  2.0);
+    vec3 m = tap(uv, texel,  2.0,  2.0);
+
+    vec3 boxes[5] = vec3[5](
+        (d + e + i + j) * 0.25,
+        (a + b + f + g) * 0.25,
+        (b + c + g + h) * 0.25,
+        (f + g + k + l) * 0.25,
+        (g + h + l + m) * 0.25);
+    float weights[5] = float[5](0.5, 0.125, 0.125, 0.125, 0.125);
+
+    vec3 result = vec3(0.0);
+    if (firstLevel) {
+        float total = 0.0;
+        for (int n = 0; n < 5; n++) {
+            float w = weights[n] * karisWeight(boxes[n]);
+            result += boxes[n] * w;
+            total += w;
+        }
+        result = softThreshold(result / max(total, 1e-4));
+    } else {
+        for (int n = 0; n < 5; n++) {
+            result += boxes[n] * weights[n];
+        }
+    }
+
+    imageStore(destImage, pixel, vec4(result, 1.0));
+}
+)";
+
+const char* UPSAMPLE_SOURCE = R"(
+#version 450 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D sourceTexture;   // The chain, read at sourceLod
+layout (r11f_g11f_b10f, binding = 0) uniform image2D destImage;
+
+uniform float sourceLod;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destImage);
+    if (any(greaterThanEqual(pixel, size))) return;
+
+    vec2 texel = 1.0 / vec2(size);
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+
+    // 3x3 tent
+    vec3 sum = textureLod(sourceTexture, uv, sourceLod).rgb * 4.0;
+    sum += textureLod(sourceTexture, uv + vec2(-texel.x, 0.0), sourceLod).rgb * 2.0;
+    sum += textureLod(sourceTexture, uv + vec2( texel.x, 0.0), sourceLod).rgb * 2.0;
+    sum += textureLod(sourceTexture, uv + vec2(0.0, -texel.y), sourceLod).rgb * 2.0;
+    sum += textureLod(sourceTexture, uv + vec2(0.0,  texel.y), sourceLod).rgb * 2.0;
+    sum += textureLod(sourceTexture, uv + vec2(-texel.x, -texel.y), sourceLod).rgb;
+    sum += textureLod(sourceTexture, uv + vec2( texel.x, -texel.y), sourceLod).rgb;
+    sum += textureLod(sourceTexture, uv + vec2(-texel.x,  texel.y), sourceLod).rgb;
+    sum += textureLod(sourceTexture, uv + vec2( texel.x,  texel.y), sourceLod).rgb;
+
+    vec3 current = imageLoad(destImage, pixel).rgb;
+    imageStore(destImage, pixel, vec4(current + sum / 16.0, 1.0));
+}
+)";
+
+GLuint groupCount(int size) {
+    return static_cast<GLuint>((size + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE);
+}
+
+// Downsample and upsample uniforms
+constexpr UniformID THRESHOLD("threshold");
+constexpr UniformID SOURCE_LOD("sourceLod");
+constexpr UniformID FIRST_LEVEL("firstLevel");
+constexpr UniformID SOURCE_SCALE("sourceScale");
+
+} // namespace
+
+Bloom::Bloom() {}
+
+Bloom::~Bloom() = default;
+
+bool Bloom::initialize(int width, int height) {
+    if (!m_downsampleShader && !createShaders()) {
+        return false;
+    }
+
+    const int levelWidth = std::max(width / 2, 1);
+    const int levelHeight = std::max(height / 2, 1);
+    if (m_texture && levelWidth == m_width && levelHeight == m_height) {
+        return true;
+    }
+
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+
+    m_width = levelWidth;
+    m_height = levelHeight;
+
+    // Stop before the smallest level gets too coarse to filter
+    m_levelCount = 1;
+    while (m_levelCount < MAX_LEVELS &&
+           std::min(m_width, m_height) >> m_levelCount >= MIN_LEVEL_SIZE) {
+        m_levelCount++;
+    }
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexStorage2D(GL_TEXTURE_2D, m_levelCount, GL_R11F_G11F_B10F, m_width, m_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+void Bloom::shutdown() {
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+    m_downsampleShader.reset();
+    m_upsampleShader.reset();
+    m_width = 0;
+    m_height = 0;
+    m_levelCount = 0;
+}
+
+bool Bloom::createShaders() {
+    Shader downsample;
+    Shader upsample;
+    if (!downsample.loadFromSource(DOWNSAMPLE_SOURCE, ShaderType::COMPUTE) ||
+        !upsample.loadFromSource(UPSAMPLE_SOURCE, ShaderType::COMPUTE)) {
+        LOG_ERROR("Failed to compile bloom shaders");
+        return false;
+    }
+
+    m_downsampleShader = std::make_unique<ShaderProgram>();
+    m_downsampleShader->attachShader(downsample);
+    m_upsampleShader = std::make_unique<ShaderProgram>();
+    m_upsampleShader->attachShader(upsample);
+
+    if (!m_downsampleShader->link() || !m_upsampleShader->link()) {
+        LOG_ERROR("Failed to link bloom shaders");
+        m_downsampleShader.reset();
+        m_upsampleShader.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void Bloom::process(GLuint source, const glm::vec2& sourceScale, float threshold, float knee) {
+    if (!m_texture || !m_downsampleShader) return;
+
+    RenderState& state = RenderState::getInstance();
+
+    // Down: source -> level 0 -> level 1 ...
+    m_downsampleShader->bind();
+    m_downsampleShader->setVec2(THRESHOLD, glm::vec2(threshold, knee));
+    for (int level = 0; level < m_levelCount; level++) {
+        const bool first = level == 0;
+        state.bindTexture(0, first ? source : m_texture);
+        m_downsampleShader->setFloat(SOURCE_LOD, first ? 0.0f : static_cast<float>(level - 1));
+        m_downsampleShader->setBool(FIRST_LEVEL, first);
+        m_downsampleShader->setVec2(SOURCE_SCALE, first ? sourceScale : glm::vec2(1.0f));
+        glBindImageTexture(0, m_texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+
+        glDispatchCompute(groupCount(std::max(m_width >> level, 1)), groupCount(std::max(m_height >> level, 1)), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    // Up: every level adds the tent-filtered level below it
+    m_upsampleShader->bind();
+    state.bindTexture(0, m_texture);
+    for (int level = m_levelCount - 2; level >= 0; level--) {
+        m_upsampleShader->setFloat(SOURCE_LOD, static_cast<float>(level + 1));
+        glBindImageTexture(0, m_texture, level, GL_FALSE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
+
+        glDispatchCompute(groupCount(std::max(m_width >> level, 1)), groupCount(std::max(m_height >> level, 1)), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -2,6 +2,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <cmath>
+#include <limits>
 
 namespace ExperimentRedbear {
 
@@ -86,11 +87,15 @@ void Camera::updateVectors() {
 }
 
 void Camera::updateFrustum() {
+    extractFrustumPlanes(m_viewProjectionMatrix, m_frustumPlanes);
+}
+
+void Camera::extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
     // Extract frustum planes from view-projection matrix
-    glm::mat4 m = m_viewProjectionMatrix;
+    const glm::mat4& m = viewProjection;
 
     // Left plane
-    m_frustumPlanes[0] = glm::vec4(
+    planes[0] = glm::vec4(
         m[0][3] + m[0][0],
         m[1][3] + m[1][0],
         m[2][3] + m[2][0],
@@ -98,7 +103,7 @@ void Camera::updateFrustum() {
     );
 
     // Right plane
-    m_frustumPlanes[1] = glm::vec4(
+    planes[1] = glm::vec4(
         m[0][3] - m[0][0],
         m[1][3] - m[1][0],
         m[2][3] - m[2][0],
@@ -106,7 +111,7 @@ void Camera::updateFrustum() {
     );
 
     // Bottom plane
-    m_frustumPlanes[2] = glm::vec4(
+    planes[2] = glm::vec4(
         m[0][3] + m[0][1],
         m[1][3] + m[1][1],
         m[2][3] + m[2][1],
@@ -114,7 +119,7 @@ void Camera::updateFrustum() {
     );
 
     // Top plane
-    m_frustumPlanes[3] = glm::vec4(
+    planes[3] = glm::vec4(
         m[0][3] - m[0][1],
         m[1][3] - m[1][1],
         m[2][3] - m[2][1],
@@ -122,7 +127,7 @@ void Camera::updateFrustum() {
     );
 
     // Near plane
-    m_frustumPlanes[4] = glm::vec4(
+    planes[4] = glm::vec4(
         m[0][3] + m[0][2],
         m[1][3] + m[1][2],
         m[2][3] + m[2][2],
@@ -130,7 +135,7 @@ void Camera::updateFrustum() {
     );
 
     // Far plane
-    m_frustumPlanes[5] = glm::vec4(
+    planes[5] = glm::vec4(
         m[0][3] - m[0][2],
         m[1][3] - m[1][2],
         m[2][3] - m[2][2],
@@ -139,8 +144,8 @@ void Camera::updateFrustum() {
 
     // Normalize planes
     for (int i = 0; i < 6; i++) {
-        float length = glm::length(glm::vec3(m_frustumPlanes[i]));
-        m_frustumPlanes[i] /= length;
+        float length = glm::length(glm::vec3(planes[i]));
+        planes[i] /= length;
     }
 }
 
@@ -160,6 +165,21 @@ bool Camera::isInFrustum(const glm::vec3& center, float radius) const {
     return true;
 }
 
+float Camera::getScreenSize(const glm::vec3& center, float radius, float viewportHeight) const {
+    if (m_mode == CameraMode::ORTHOGRAPHIC) {
+        return 2.0f * radius * viewportHeight / (m_orthoTop - m_orthoBottom);
+    }
+
+    // Inside the sphere it covers the whole screen
+    float distance = glm::length(center - m_position);
+    if (distance <= radius) {
+        return std::numeric_limits<float>::max();
+    }
+
+    float pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(m_fov) * 0.5f));
+    return 2.0f * radius * pixelsPerUnit / distance;
+}
+
 void Camera::setFOV(float fov) {
     m_fov = fov;
     if (m_mode == CameraMode::PERSPECTIVE) {
@@ -0,0 +1,261 @@
+#include "graphics/CascadedShadowMap.h"
+#include "graphics/Shader.h"
+#include "graphics/Renderer.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// How far behind a cascade's bounding sphere casters are still captured
+constexpr float CASTER_DISTANCE = 50.0f;
+
+// Blend between logarithmic (1) and uniform (0) split placement
+constexpr float SPLIT_LAMBDA = 0.75f;
+
+} // namespace
+
+CascadedShadowMap::CascadedShadowMap() {}
+
+CascadedShadowMap::~CascadedShadowMap() = default;
+
+bool CascadedShadowMap::initialize(int cascadeCount, int resolution) {
+    shutdown();
+
+    m_cascadeCount = std::clamp(cascadeCount, 0, MAX_CASCADES);
+    m_resolution = m_cascadeCount > 0 ? std::max(resolution, 256) : 0;
+
+    // Always create a texture so the sampler is complete even with shadows off
+    int textureSize = m_resolution > 0 ? m_resolution : 1;
+    int layers = std::max(m_cascadeCount, 1);
+
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, textureSize, textureSize, layers);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        LOG_ERROR("Shadow cascade framebuffer incomplete!");
+        m_cascadeCount = 0;
+        m_resolution = 0;
+    }
+
+    m_gpuCascades = {};
+    m_cascadeBuffer.create(GL_UNIFORM_BUFFER, sizeof(GPUShadowCascades));
+    m_cascadeBuffer.upload(&m_gpuCascades, sizeof(GPUShadowCascades));
+    m_cascadeBuffer.bindBase(UniformBinding::SHADOW_CASCADES);
+
+    invalidate();
+
+    if (m_cascadeCount > 0) {
+        LOG_INFO("Shadow cascades: " + std::to_string(m_cascadeCount) + " x " +
+                 std::to_string(m_resolution) + "x" + std::to_string(m_resolution));
+    }
+    return complete;
+}
+
+void CascadedShadowMap::shutdown() {
+    if (m_fbo) {
+        glDeleteFramebuffers(1, &m_fbo);
+        m_fbo = 0;
+    }
+    if (m_depthTexture) {
+        glDeleteTextures(1, &m_depthTexture);
+        m_depthTexture = 0;
+    }
+    m_cascadeBuffer.destroy();
+    m_cascadeCount = 0;
+    m_resolution = 0;
+}
+
+void CascadedShadowMap::invalidate() {
+    for (bool& valid : m_valid) {
+        valid = false;
+    }
+}
+
+void CascadedShadowMap::computeSplits(float nearPlane, float farPlane) {
+    // Practical split scheme: mostly logarithmic so near cascades stay sharp
+    m_splits[0] = nearPlane;
+    for (int i = 1; i <= m_cascadeCount; i++) {
+        float ratio = static_cast<float>(i) / static_cast<float>(m_cascadeCount);
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, ratio);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * ratio;
+        m_splits[i] = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+    }
+}
+
+glm::mat4 CascadedShadowMap::fitCascade(const Camera& camera, const glm::vec3& lightDirection,
+                                        float sliceNear, float sliceFar, float& texelSize) const {
+    // Corners of the view frustum slice in world space
+    float tanHalfY = std::tan(glm::radians(camera.getFOV()) * 0.5f);
+    float tanHalfX = tanHalfY * camera.getAspectRatio();
+
+    glm::vec3 position = camera.getPosition();
+    glm::vec3 forward = camera.getForward();
+    glm::vec3 right = camera.getRight();
+    glm::vec3 up = camera.getUp();
+
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; i++) {
+        float depth = (i & 4) ? sliceFar : sliceNear;
+        float x = ((i & 1) ? 1.0f : -1.0f) * tanHalfX * depth;
+        float y = ((i & 2) ? 1.0f : -1.0f) * tanHalfY * depth;
+        corners[i] = position + forward * depth + right * x + up * y;
+        center += corners[i];
+    }
+    center /= 8.0f;
+
+    // A bounding sphere keeps the map size constant as the camera turns.
+    // The radius is rounded up so float noise can't change it either.
+    float radius = 0.0f;
+    for (const auto& corner : corners) {
+        radius = std::max(radius, glm::length(corner - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    glm::vec3 lightUp = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 eye = center - lightDirection * (radius + CASTER_DISTANCE);
+
+    glm::mat4 view = glm::lookAt(eye, center, lightUp);
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 2.0f + CASTER_DISTANCE);
+
+    // Snap the projected world origin to a whole texel so the map only ever
+    // moves in texel steps
+    float halfResolution = static_cast<float>(m_resolution) * 0.5f;
+    glm::vec4 origin = projection * view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec2 texelOrigin = glm::vec2(origin) * halfResolution;
+    glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) / halfResolution;
+    projection[3][0] += offset.x;
+    projection[3][1] += offset.y;
+
+    texelSize = radius * 2.0f / static_cast<float>(m_resolution);
+    return projection * view;
+}
+
+int CascadedShadowMap::update(const Camera& camera, const std::vector<Light>& lights, float shadowDistance,
+                              RenderQueue& queue, ShaderProgram& depthShader, RenderStats& stats,
+                              const ShadowCasterCallback& extraCasters) {
+    m_frameIndex++;
+
+    int lightIndex = -1;
+    if (isEnabled()) {
+        for (size_t i = 0; i < lights.size(); i++) {
+            const Light& light = lights[i];
+            if (light.type == LightType::DIRECTIONAL && light.castShadows && light.intensity > 0.0f) {
+                lightIndex = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+
+    if (lightIndex < 0) {
+        m_gpuCascades.cascadeCount = glm::uvec4(0u);
+        m_cascadeBuffer.upload(&m_gpuCascades, sizeof(GPUShadowCascades));
+        return -1;
+    }
+
+    glm::vec3 lightDirection = glm::normalize(lights[lightIndex].direction);
+    if (lightDirection != m_lightDirection) {
+        m_lightDirection = lightDirection;
+        invalidate();
+    }
+
+    float farPlane = std::min(shadowDistance, camera.getFarPlane());
+    computeSplits(camera.getNearPlane(), std::max(farPlane, camera.getNearPlane() * 2.0f));
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_resolution, m_resolution);
+    RenderState& state = RenderState::getInstance();
+    state.enable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    depthShader.bind();
+
+    for (int cascade = 0; cascade < m_cascadeCount; cascade++) {
+        // The far half of the cascades alternate, one set per frame. A
+        // skipped cascade keeps last frame's matrix, which still matches
+        // its map.
+        bool farCascade = cascade >= m_cascadeCount / 2 && cascade > 0;
+        if (m_valid[cascade] && farCascade && (m_frameIndex + cascade) % 2 != 0) {
+            continue;
+        }
+
+        float texelSize = 0.0f;
+        glm::mat4 viewProjection = fitCascade(camera, lightDirection, m_splits[cascade],
+                                              m_splits[cascade + 1], texelSize);
+
+        glm::vec4 planes[6];
+        Camera::extractFrustumPlanes(viewProjection, planes);
+        queue.cull(planes);
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, cascade);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        depthShader.setMat4(UniformName::LIGHT_VIEW_PROJECTION, viewProjection);
+
+        const std::vector<uint8_t>& visibility = queue.getVisibility();
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (!visibility[i]) continue;
+
+            const RenderCommand& cmd = queue[i];
+            if (cmd.transparent) continue;
+
+            depthShader.setMat4(UniformName::MODEL, cmd.modelMatrix);
+            state.bindVertexArray(cmd.vao);
+            if (cmd.indexed) {
+                glDrawElementsBaseVertex(GL_TRIANGLES, cmd.indexCount, GL_UNSIGNED_INT,
+                                         reinterpret_cast<const void*>(static_cast<uintptr_t>(cmd.firstIndex) * sizeof(GLuint)),
+                                         cmd.baseVertex);
+            } else {
+                glDrawArrays(GL_TRIANGLES, static_cast<GLint>(cmd.firstIndex), cmd.indexCount);
+            }
+            stats.drawCalls++;
+        }
+
+        if (extraCasters) {
+            extraCasters(viewProjection, planes);
+            depthShader.bind();
+        }
+
+        m_gpuCascades.viewProjection[cascade] = viewProjection;
+        m_gpuCascades.texelSize[cascade] = texelSize;
+        m_valid[cascade] = true;
+        stats.shadowCascadesRendered++;
+    }
+
+    state.disable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+    m_gpuCascades.cascadeCount = glm::uvec4(static_cast<unsigned int>(m_cascadeCount), 0u, 0u, 0u);
+    m_cascadeBuffer.upload(&m_gpuCascades, sizeof(GPUShadowCascades));
+
+    return lightIndex;
+}
+
+} // namespace ExperimentRedbear
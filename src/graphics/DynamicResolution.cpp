@@ -0,0 +1,45 @@
+#include "graphics/DynamicResolution.h"
+#include "graphics/GpuProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+DynamicResolution::DynamicResolution() {}
+
+DynamicResolution::~DynamicResolution() = default;
+
+void DynamicResolution::reset(float scale) {
+    m_scale = scale;
+    m_framesSinceChange = 0;
+}
+
+float DynamicResolution::update(float gpuFrameTime, float gpuSceneTime, float targetFrameTime,
+                                float minScale, float maxScale) {
+    m_scale = std::clamp(m_scale, minScale, maxScale);
+    m_framesSinceChange++;
+
+    // Times still measured at an older scale would make the loop overshoot
+    if (m_framesSinceChange <= GpuProfiler::FRAME_LATENCY) return m_scale;
+    if (gpuFrameTime <= 0.0f || gpuSceneTime <= 0.0f || targetFrameTime <= 0.0f) return m_scale;
+
+    const float fixedTime = std::max(gpuFrameTime - gpuSceneTime, 0.0f);
+    const float sceneBudget = std::max(targetFrameTime * BUDGET_HEADROOM - fixedTime, targetFrameTime * 0.1f);
+
+    float desired = m_scale * std::sqrt(sceneBudget / gpuSceneTime);
+    desired = std::clamp(desired, minScale, maxScale);
+
+    float next = m_scale + (desired - m_scale) * DAMPING;
+    if (std::abs(next - m_scale) < MIN_STEP) {
+        // Close enough, unless a bound is within reach
+        if (desired != minScale && desired != maxScale) return m_scale;
+        next = desired;
+        if (next == m_scale) return m_scale;
+    }
+
+    m_scale = next;
+    m_framesSinceChange = 0;
+    return m_scale;
+}
+
+} // namespace ExperimentRedbear
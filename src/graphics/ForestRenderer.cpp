@@ -0,0 +1,338 @@
+#include "graphics/ForestRenderer.h"
+#include "graphics/Model.h"
+#include "graphics/Renderer.h"
+#include "graphics/MeshSimplifier.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/RenderState.h"
+#include "graphics/ImpostorAtlas.h"
+#include "graphics/Camera.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr uint8_t NOT_VISIBLE = 0xFF;
+
+uint32_t packEntry(uint32_t instance, float fade) {
+    uint32_t quantized = static_cast<uint32_t>(std::clamp(fade, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return instance | (quantized << 24);
+}
+
+bool sphereInPlanes(const glm::vec4 planes[6], const glm::vec4& sphere) {
+    for (int i = 0; i < 6; i++) {
+        if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ForestRenderer::ForestRenderer() {}
+
+ForestRenderer::~ForestRenderer() = default;
+
+bool ForestRenderer::initialize() {
+    if (m_initialized) return true;
+
+    if (!m_instanceBuffer.create(GL_SHADER_STORAGE_BUFFER, sizeof(GPUTreeInstance) * 256, GL_STATIC_DRAW)) {
+        LOG_ERROR("Failed to create forest instance buffers");
+        return false;
+    }
+
+    m_groups.resize(MAX_TYPES * MAX_PARTS * MAX_LODS);
+    m_shadowGroups.resize(MAX_TYPES * MAX_PARTS * MAX_LODS);
+
+    // Optional, the CPU path stays available without it
+    m_culler.initialize();
+
+    m_initialized = true;
+    return true;
+}
+
+void ForestRenderer::shutdown() {
+    clear();
+    m_culler.shutdown();
+    m_instanceBuffer.destroy();
+    m_groups.clear();
+    m_shadowGroups.clear();
+    m_initialized = false;
+}
+
+void ForestRenderer::setMesh(int type, int part, const Mesh* mesh) {
+    if (type < 0 || type >= MAX_TYPES || part < 0 || part >= MAX_PARTS) {
+        LOG_WARNING("Tree mesh slot out of range: type " + std::to_string(type) + ", part " + std::to_string(part));
+        return;
+    }
+    m_meshes[type][part] = mesh;
+}
+
+void ForestRenderer::setTypeBounds(int type, const glm::vec4 partBounds[MAX_PARTS], const glm::vec4& bounds) {
+    if (type < 0 || type >= MAX_TYPES) {
+        LOG_WARNING("Tree type out of range: " + std::to_string(type));
+        return;
+    }
+    for (int part = 0; part < MAX_PARTS; part++) {
+        m_typeBounds[type].partBounds[part] = partBounds[part];
+    }
+    m_typeBounds[type].bounds = bounds;
+}
+
+void ForestRenderer::setImpostorFade(float start, float range) {
+    m_impostorStart = start;
+    m_impostorRange = range;
+}
+
+void ForestRenderer::setGpuCulling(bool enabled) {
+    if (enabled && !m_culler.isValid() && !m_gpuCulling) {
+        LOG_WARNING("GPU tree culling is not supported, culling trees on the CPU");
+    }
+    m_gpuCulling = enabled;
+}
+
+void ForestRenderer::setInstances(const std::vector<GPUTreeInstance>& instances,
+                                  const std::vector<glm::vec4>& bounds) {
+    size_t count = std::min(instances.size(), bounds.size());
+    if (count > MAX_INSTANCES) {
+        LOG_WARNING("Too many trees, only the first " + std::to_string(MAX_INSTANCES) + " are drawn");
+        count = MAX_INSTANCES;
+    }
+
+    m_types.resize(count);
+    m_bounds.assign(bounds.begin(), bounds.begin() + count);
+    for (size_t i = 0; i < count; i++) {
+        m_types[i] = static_cast<uint8_t>(std::clamp(static_cast<int>(instances[i].params.y), 0, MAX_TYPES - 1));
+    }
+    m_frameLods.assign(count * MAX_PARTS, NOT_VISIBLE);
+
+    m_instanceBuffer.upload(instances.data(), count * sizeof(GPUTreeInstance));
+    m_culler.reset(count);
+}
+
+void ForestRenderer::clear() {
+    for (auto& type : m_meshes) {
+        for (auto& mesh : type) {
+            mesh = nullptr;
+        }
+    }
+    m_types.clear();
+    m_bounds.clear();
+    m_frameLods.clear();
+    endFrame();
+}
+
+void ForestRenderer::addVisible(uint32_t instance, int part, int lod, float fade) {
+    if (instance >= m_types.size() || m_groups.empty()) return;
+
+    lod = std::clamp(lod, 0, MAX_LODS - 1);
+    m_groups[groupIndex(m_types[instance], part, lod)].push_back(packEntry(instance, fade));
+    m_frameLods[instance * MAX_PARTS + part] = static_cast<uint8_t>(lod);
+}
+
+void ForestRenderer::cull(const Camera& camera, float viewportHeight, GLuint occlusionTexture, bool impostors) {
+    if (!isGpuCulling() || m_types.empty()) return;
+
+    updateCullTable();
+
+    TreeCullView view;
+    view.viewProjection = camera.getViewProjectionMatrix();
+    std::copy(camera.getFrustumPlanes(), camera.getFrustumPlanes() + 6, view.planes);
+    view.position = camera.getPosition();
+    view.pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(camera.getFOV()) * 0.5f));
+    if (impostors) {
+        view.impostorStart = m_impostorStart;
+        view.impostorRange = m_impostorRange;
+    }
+    view.occlusionTexture = occlusionTexture;
+
+    m_instanceBuffer.bindBase(StorageBinding::TREE_INSTANCES);
+    m_mainView = m_culler.cull(view);
+}
+
+void ForestRenderer::drawImpostors(ImpostorAtlas& atlas, RenderStats& stats) {
+    if (!isGpuCulling() || !m_mainView.isValid()) return;
+    atlas.drawIndirect(m_mainView.impostorBuffer, m_mainView.drawBuffer, offsetof(GPUTreeDraws, impostors), stats);
+}
+
+void ForestRenderer::draw(ShaderProgram& shader, RenderStats& stats) {
+    if (isGpuCulling()) {
+        // The instance counts stay on the GPU, so treeInstancesDrawn is not
+        // known here
+        if (m_mainView.isValid()) {
+            drawCulled(m_mainView, shader, true, stats);
+        }
+        return;
+    }
+    stats.treeInstancesDrawn += drawGroups(m_groups, shader, true, stats);
+}
+
+void ForestRenderer::drawShadows(ShaderProgram& depthShader, const glm::vec4 planes[6], RenderStats& stats) {
+    if (m_types.empty() || m_shadowGroups.empty()) return;
+
+    if (isGpuCulling()) {
+        updateCullTable();
+
+        TreeCullView view;
+        std::copy(planes, planes + 6, view.planes);
+        m_instanceBuffer.bindBase(StorageBinding::TREE_INSTANCES);
+        TreeCullResult result = m_culler.cull(view);
+        if (result.isValid()) {
+            drawCulled(result, depthShader, false, stats);
+            return;
+        }
+        // Out of shadow views this frame: this one is culled on the CPU
+    }
+
+    for (auto& group : m_shadowGroups) {
+        group.clear();
+    }
+
+    for (size_t i = 0; i < m_types.size(); i++) {
+        if (!sphereInPlanes(planes, m_bounds[i])) continue;
+
+        const int type = m_types[i];
+        for (int part = 0; part < MAX_PARTS; part++) {
+            const Mesh* mesh = m_meshes[type][part];
+            if (!mesh) continue;
+
+            int lod = m_frameLods[i * MAX_PARTS + part];
+            if (lod == NOT_VISIBLE) {
+                lod = static_cast<int>(mesh->getLods().size()) - 1;
+            }
+            m_shadowGroups[groupIndex(type, part, lod)].push_back(packEntry(static_cast<uint32_t>(i), 1.0f));
+        }
+    }
+
+    drawGroups(m_shadowGroups, depthShader, false, stats);
+}
+
+void ForestRenderer::endFrame() {
+    m_culler.endFrame();
+    m_mainView = TreeCullResult();
+    m_cullTableWritten = false;
+
+    for (auto& group : m_groups) {
+        group.clear();
+    }
+    std::fill(m_frameLods.begin(), m_frameLods.end(), NOT_VISIBLE);
+}
+
+int ForestRenderer::drawGroups(const std::vector<std::vector<uint32_t>>& groups, ShaderProgram& shader,
+                               bool materials, RenderStats& stats) {
+    // Every group goes into one allocation so a view costs a single write.
+    // Each view gets fresh stream memory, so the shadow views never wait on
+    // each other.
+    m_upload.clear();
+    for (const auto& group : groups) {
+        m_upload.insert(m_upload.end(), group.begin(), group.end());
+    }
+    if (m_upload.empty()) return 0;
+
+    StreamAllocation visible = StreamBuffer::getInstance().writeStorage(m_upload.data(), m_upload.size() * sizeof(uint32_t));
+    if (!visible) return 0;
+    m_instanceBuffer.bindBase(StorageBinding::TREE_INSTANCES);
+    StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::VISIBLE_TREES, visible);
+    shader.bind();
+
+    int offset = 0;
+    int instances = 0;
+    for (size_t g = 0; g < groups.size(); g++) {
+        const int count = static_cast<int>(groups[g].size());
+        if (count == 0) continue;
+
+        const int type = static_cast<int>(g) / (MAX_PARTS * MAX_LODS);
+        const int part = static_cast<int>(g) / MAX_LODS % MAX_PARTS;
+        const int lod = static_cast<int>(g) % MAX_LODS;
+        const Mesh* mesh = m_meshes[type][part];
+
+        if (mesh) {
+            shader.setInt(UniformName::INSTANCE_OFFSET, offset);
+            shader.setInt(UniformName::TREE_PART, part);
+            if (materials) {
+                uint32_t material = mesh->getMaterialIndex();
+                shader.setInt(UniformName::MATERIAL_INDEX, material == MaterialSystem::NO_MATERIAL ? -1 : static_cast<int>(material));
+            }
+
+            mesh->drawInstanced(count, lod);
+
+            const std::vector<MeshLod>& lods = mesh->getLods();
+            const MeshLod& level = lods[std::min(lod, static_cast<int>(lods.size()) - 1)];
+            stats.drawCalls++;
+            stats.triangles += count * static_cast<int>(level.indexCount / 3);
+            instances += count;
+        }
+
+        offset += count;
+    }
+
+    return instances;
+}
+
+void ForestRenderer::updateCullTable() {
+    if (m_cullTableWritten) return;
+
+    // Rewritten every frame from the meshes, so LOD chains or meshes that
+    // change between frames are picked up without any bookkeeping
+    GPUTreeCullTable table = {};
+    for (int type = 0; type < MAX_TYPES; type++) {
+        table.types[type] = m_typeBounds[type];
+        for (int part = 0; part < MAX_PARTS; part++) {
+            const Mesh* mesh = m_meshes[type][part];
+            if (!mesh) continue;
+
+            const std::vector<MeshLod>& lods = mesh->getLods();
+            const int lodCount = std::min(static_cast<int>(lods.size()), MAX_LODS);
+            table.types[type].lodCounts[part] = static_cast<uint32_t>(lodCount);
+            for (int lod = 0; lod < lodCount; lod++) {
+                GPUTreeGroup& group = table.groups[groupIndex(type, part, lod)];
+                group.indexCount = lods[lod].indexCount;
+                group.firstIndex = mesh->getFirstIndex() + lods[lod].indexOffset;
+                group.baseVertex = mesh->getBaseVertex();
+                group.lodError = lods[lod].error;
+            }
+        }
+    }
+
+    m_culler.setTable(table);
+    m_cullTableWritten = true;
+}
+
+void ForestRenderer::drawCulled(const TreeCullResult& result, ShaderProgram& shader, bool materials,
+                                RenderStats& stats) {
+    RenderState& state = RenderState::getInstance();
+    m_instanceBuffer.bindBase(StorageBinding::TREE_INSTANCES);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::VISIBLE_TREES, result.visibleBuffer);
+    state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, result.drawBuffer);
+    shader.bind();
+    shader.setInt(UniformName::INSTANCE_OFFSET, 0);
+
+    // Every LOD of a part is one multi-draw; empty groups cost an indirect
+    // command with instanceCount 0
+    for (int type = 0; type < MAX_TYPES; type++) {
+        for (int part = 0; part < MAX_PARTS; part++) {
+            const Mesh* mesh = m_meshes[type][part];
+            if (!mesh || mesh->getLods().empty()) continue;
+
+            shader.setInt(UniformName::TREE_PART, part);
+            if (materials) {
+                uint32_t material = mesh->getMaterialIndex();
+                shader.setInt(UniformName::MATERIAL_INDEX, material == MaterialSystem::NO_MATERIAL ? -1 : static_cast<int>(material));
+            }
+
+            const int lodCount = std::min(static_cast<int>(mesh->getLods().size()), MAX_LODS);
+            const void* offset = reinterpret_cast<const void*>(
+                static_cast<uintptr_t>(groupIndex(type, part, 0)) * sizeof(GPUDrawElementsCommand));
+            state.bindVertexArray(mesh->getVAO());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, lodCount, 0);
+            stats.drawCalls++;
+        }
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,278 @@
+#include "graphics/GeometryBuffer.h"
+#include "graphics/Model.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr uint32_t INITIAL_VERTICES = 64 * 1024;
+constexpr uint32_t INITIAL_INDICES = 256 * 1024;
+
+uint32_t grownCapacity(uint32_t capacity, uint32_t required) {
+    uint32_t grown = std::max(capacity, 1024u);
+    while (grown < required) grown *= 2;
+    return grown;
+}
+
+} // namespace
+
+GeometryBuffer& GeometryBuffer::getInstance(VertexFormat format) {
+    static GeometryBuffer instances[static_cast<int>(VertexFormat::COUNT)];
+    GeometryBuffer& instance = instances[static_cast<int>(format)];
+    instance.m_format = format;
+    return instance;
+}
+
+GeometryBuffer::GeometryBuffer() {}
+
+GeometryBuffer::~GeometryBuffer() = default;
+
+bool GeometryBuffer::create() {
+    switch (m_format) {
+        case VertexFormat::MESH: m_stride = sizeof(Vertex); break;
+        case VertexFormat::COUNT: return false;
+    }
+
+    m_vertexBuffer = resizeBuffer(0, m_stride, INITIAL_VERTICES, 0);
+    m_indexBuffer = resizeBuffer(0, sizeof(uint32_t), INITIAL_INDICES, 0);
+    m_vertexAllocator.reset(INITIAL_VERTICES);
+    m_indexAllocator.reset(INITIAL_INDICES);
+
+    glCreateVertexArrays(1, &m_vao);
+    setupVertexArray();
+
+    if (!m_vao || !m_vertexBuffer || !m_indexBuffer) {
+        LOG_ERROR("Failed to create geometry buffer");
+        return false;
+    }
+    return true;
+}
+
+void GeometryBuffer::setupVertexArray() {
+    glVertexArrayVertexBuffer(m_vao, 0, m_vertexBuffer, 0, static_cast<GLsizei>(m_stride));
+    glVertexArrayElementBuffer(m_vao, m_indexBuffer);
+
+    switch (m_format) {
+        case VertexFormat::MESH: {
+            // Positions, normals, texture coords, tangents, bitangents
+            const GLint sizes[] = {3, 3, 2, 3, 3};
+            const GLuint offsets[] = {0, offsetof(Vertex, normal), offsetof(Vertex, texCoords),
+                                      offsetof(Vertex, tangent), offsetof(Vertex, bitangent)};
+            for (GLuint attribute = 0; attribute < 5; attribute++) {
+                glEnableVertexArrayAttrib(m_vao, attribute);
+                glVertexArrayAttribFormat(m_vao, attribute, sizes[attribute], GL_FLOAT, GL_FALSE, offsets[attribute]);
+                glVertexArrayAttribBinding(m_vao, attribute, 0);
+            }
+            break;
+        }
+        case VertexFormat::COUNT:
+            break;
+    }
+}
+
+GLuint GeometryBuffer::resizeBuffer(GLuint buffer, size_t elementSize, uint32_t capacity, uint32_t keepElements) {
+    GLuint resized = 0;
+    glCreateBuffers(1, &resized);
+    glNamedBufferStorage(resized, static_cast<GLsizeiptr>(capacity * elementSize), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // GL keeps the old storage alive for draws already issued
+    if (buffer) {
+        if (keepElements > 0) {
+            glCopyNamedBufferSubData(buffer, resized, 0, 0, static_cast<GLsizeiptr>(keepElements * elementSize));
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    return resized;
+}
+
+OffsetAllocator::Allocation GeometryBuffer::allocateVertices(uint32_t count) {
+    OffsetAllocator::Allocation allocation = m_vertexAllocator.allocate(count);
+    if (allocation.isValid()) return allocation;
+
+    const uint32_t capacity = m_vertexAllocator.getSize();
+    const uint32_t grown = grownCapacity(capacity, capacity + count);
+    m_vertexBuffer = resizeBuffer(m_vertexBuffer, m_stride, grown, capacity);
+    m_vertexAllocator.grow(grown);
+    glVertexArrayVertexBuffer(m_vao, 0, m_vertexBuffer, 0, static_cast<GLsizei>(m_stride));
+    LOG_DEBUG("Geometry vertex buffer grown to " + std::to_string(grown) + " vertices");
+
+    return m_vertexAllocator.allocate(count);
+}
+
+OffsetAllocator::Allocation GeometryBuffer::allocateIndices(uint32_t count) {
+    OffsetAllocator::Allocation allocation = m_indexAllocator.allocate(count);
+    if (allocation.isValid()) return allocation;
+
+    const uint32_t capacity = m_indexAllocator.getSize();
+    const uint32_t grown = grownCapacity(capacity, capacity + count);
+    m_indexBuffer = resizeBuffer(m_indexBuffer, sizeof(uint32_t), grown, capacity);
+    m_indexAllocator.grow(grown);
+    glVertexArrayElementBuffer(m_vao, m_indexBuffer);
+    LOG_DEBUG("Geometry index buffer grown to " + std::to_string(grown) + " indices");
+
+    return m_indexAllocator.allocate(count);
+}
+
+bool GeometryBuffer::allocate(GeometryRange& range, const void* vertices, uint32_t vertexCount,
+                              const uint32_t* indices, uint32_t indexCount) {
+    free(range);
+    if (vertexCount == 0 || indexCount == 0) return false;
+    if (!m_vao && !create()) return false;
+
+    range.vertices = allocateVertices(vertexCount);
+    range.indices = allocateIndices(indexCount);
+    if (!range.isValid()) {
+        LOG_ERROR("Geometry buffer allocation failed");
+        m_vertexAllocator.free(range.vertices);
+        m_indexAllocator.free(range.indices);
+        range = GeometryRange();
+        return false;
+    }
+
+    range.baseVertex = static_cast<GLint>(range.vertices.offset);
+    range.firstIndex = range.indices.offset;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+
+    glNamedBufferSubData(m_vertexBuffer, static_cast<GLintptr>(range.vertices.offset * m_stride),
+                         static_cast<GLsizeiptr>(vertexCount * m_stride), vertices);
+    glNamedBufferSubData(m_indexBuffer, static_cast<GLintptr>(range.indices.offset * sizeof(uint32_t)),
+                         static_cast<GLsizeiptr>(indexCount * sizeof(uint32_t)), indices);
+
+    m_ranges.push_back(&range);
+    return true;
+}
+
+bool GeometryBuffer::reallocateIndices(GeometryRange& range, const uint32_t* indices, uint32_t indexCount) {
+    if (!range.isValid() || indexCount == 0) return false;
+
+    m_indexAllocator.free(range.indices);
+    range.indices = allocateIndices(indexCount);
+    if (!range.indices.isValid()) {
+        LOG_ERROR("Geometry buffer index allocation failed");
+        free(range);
+        return false;
+    }
+
+    range.firstIndex = range.indices.offset;
+    range.indexCount = indexCount;
+    glNamedBufferSubData(m_indexBuffer, static_cast<GLintptr>(range.indices.offset * sizeof(uint32_t)),
+                         static_cast<GLsizeiptr>(indexCount * sizeof(uint32_t)), indices);
+    return true;
+}
+
+void GeometryBuffer::free(GeometryRange& range) {
+    auto it = std::find(m_ranges.begin(), m_ranges.end(), &range);
+    if (it != m_ranges.end()) {
+        *it = m_ranges.back();
+        m_ranges.pop_back();
+        m_vertexAllocator.free(range.vertices);
+        m_indexAllocator.free(range.indices);
+    }
+    range = GeometryRange();
+}
+
+void GeometryBuffer::compact() {
+    if (!m_vao) return;
+
+    const uint32_t vertexCapacity = m_vertexAllocator.getSize();
+    const uint32_t indexCapacity = m_indexAllocator.getSize();
+
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    glCreateBuffers(1, &vertexBuffer);
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferStorage(vertexBuffer, static_cast<GLsizeiptr>(vertexCapacity * m_stride), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glNamedBufferStorage(indexBuffer, static_cast<GLsizeiptr>(indexCapacity * sizeof(uint32_t)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // In address order, so ranges keep their relative placement. Indices
+    // are relative to baseVertex and are copied unchanged.
+    std::sort(m_ranges.begin(), m_ranges.end(),
+              [](const GeometryRange* a, const GeometryRange* b) { return a->vertices.offset < b->vertices.offset; });
+
+    m_vertexAllocator.reset(vertexCapacity);
+    m_indexAllocator.reset(indexCapacity);
+    for (GeometryRange* range : m_ranges) {
+        OffsetAllocator::Allocation vertices = m_vertexAllocator.allocate(range->vertexCount);
+        OffsetAllocator::Allocation indices = m_indexAllocator.allocate(range->indexCount);
+
+        glCopyNamedBufferSubData(m_vertexBuffer, vertexBuffer,
+                                 static_cast<GLintptr>(range->vertices.offset * m_stride),
+                                 static_cast<GLintptr>(vertices.offset * m_stride),
+                                 static_cast<GLsizeiptr>(range->vertexCount * m_stride));
+        glCopyNamedBufferSubData(m_indexBuffer, indexBuffer,
+                                 static_cast<GLintptr>(range->indices.offset * sizeof(uint32_t)),
+                                 static_cast<GLintptr>(indices.offset * sizeof(uint32_t)),
+                                 static_cast<GLsizeiptr>(range->indexCount * sizeof(uint32_t)));
+
+        range->vertices = vertices;
+        range->indices = indices;
+        range->baseVertex = static_cast<GLint>(vertices.offset);
+        range->firstIndex = indices.offset;
+    }
+
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+    m_vertexBuffer = vertexBuffer;
+    m_indexBuffer = indexBuffer;
+    setupVertexArray();
+
+    LOG_DEBUG("Geometry buffer compacted: " + std::to_string(m_ranges.size()) + " ranges");
+}
+
+float GeometryBuffer::getFragmentation() const {
+    const uint32_t vertexFree = m_vertexAllocator.getFreeSize();
+    const uint32_t indexFree = m_indexAllocator.getFreeSize();
+
+    float fragmentation = 0.0f;
+    if (vertexFree > 0) {
+        fragmentation = 1.0f - static_cast<float>(m_vertexAllocator.getLargestFreeBlock()) / vertexFree;
+    }
+    if (indexFree > 0) {
+        fragmentation = std::max(fragmentation,
+                                 1.0f - static_cast<float>(m_indexAllocator.getLargestFreeBlock()) / indexFree);
+    }
+    return fragmentation;
+}
+
+void GeometryBuffer::shutdown() {
+    for (GeometryRange* range : m_ranges) {
+        *range = GeometryRange();
+    }
+    m_ranges.clear();
+
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_vertexBuffer) {
+        glDeleteBuffers(1, &m_vertexBuffer);
+        m_vertexBuffer = 0;
+    }
+    if (m_indexBuffer) {
+        glDeleteBuffers(1, &m_indexBuffer);
+        m_indexBuffer = 0;
+    }
+    m_vertexAllocator.reset(0);
+    m_indexAllocator.reset(0);
+}
+
+void GeometryBuffer::shutdownAll() {
+    for (int format = 0; format < static_cast<int>(VertexFormat::COUNT); format++) {
+        getInstance(static_cast<VertexFormat>(format)).shutdown();
+    }
+}
+
+void GeometryBuffer::compactFragmented(float threshold) {
+    for (int format = 0; format < static_cast<int>(VertexFormat::COUNT); format++) {
+        GeometryBuffer& buffer = getInstance(static_cast<VertexFormat>(format));
+        if (buffer.m_vao && buffer.getFragmentation() > threshold) {
+            buffer.compact();
+        }
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,59 @@
+#include "graphics/GpuBuffer.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+
+namespace ExperimentRedbear {
+
+GpuBuffer::GpuBuffer() {}
+
+GpuBuffer::~GpuBuffer() {
+    destroy();
+}
+
+bool GpuBuffer::create(GLenum target, size_t size, GLenum usage) {
+    destroy();
+
+    m_target = target;
+    m_usage = usage;
+    m_size = size;
+
+    // Direct state access throughout, so uploads never disturb bindings
+    // tracked by RenderState
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferData(m_buffer, static_cast<GLsizeiptr>(m_size), nullptr, m_usage);
+
+    if (!m_buffer) {
+        LOG_ERROR("Failed to create GPU buffer");
+        return false;
+    }
+
+    return true;
+}
+
+void GpuBuffer::destroy() {
+    if (m_buffer) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_size = 0;
+}
+
+void GpuBuffer::upload(const void* data, size_t size, size_t offset) {
+    if (!m_buffer || size == 0) return;
+
+    if (offset + size > m_size) {
+        // Grow to the next power of two so repeated growth stays amortised
+        size_t newSize = m_size ? m_size : 256;
+        while (newSize < offset + size) newSize *= 2;
+        m_size = newSize;
+        glNamedBufferData(m_buffer, static_cast<GLsizeiptr>(m_size), nullptr, m_usage);
+    }
+
+    glNamedBufferSubData(m_buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+}
+
+void GpuBuffer::bindBase(GLuint index) const {
+    RenderState::getInstance().bindBufferBase(m_target, index, m_buffer);
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,221 @@
+#include "graphics/GpuProfiler.h"
+#include "core/Logger.h"
+
+namespace ExperimentRedbear {
+
+GpuProfiler::GpuProfiler() {}
+
+GpuProfiler::~GpuProfiler() = default;
+
+bool GpuProfiler::initialize() {
+    if (m_initialized) {
+        shutdown();
+    }
+
+    m_pipelineStatsSupported = GLEW_ARB_pipeline_statistics_query;
+
+    for (auto& frame : m_frames) {
+        frame.timestamps.resize(MAX_RANGES_PER_FRAME * 2);
+        glGenQueries(static_cast<GLsizei>(frame.timestamps.size()), frame.timestamps.data());
+        frame.ranges.reserve(MAX_RANGES_PER_FRAME);
+
+        if (m_pipelineStatsSupported) {
+            glGenQueries(PIPELINE_QUERY_COUNT, frame.pipelineQueries);
+        }
+    }
+
+    m_frameIndex = 0;
+    m_inFrame = false;
+    m_initialized = true;
+
+    LOG_INFO(std::string("GPU profiler initialized (pipeline statistics: ") +
+             (m_pipelineStatsSupported ? "yes" : "no") + ")");
+    return true;
+}
+
+void GpuProfiler::shutdown() {
+    if (!m_initialized) return;
+
+    for (auto& frame : m_frames) {
+        if (frame.pipelineActive) {
+            endPipelineQueries(frame);
+        }
+        if (!frame.timestamps.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.timestamps.size()), frame.timestamps.data());
+            frame.timestamps.clear();
+        }
+        if (m_pipelineStatsSupported) {
+            glDeleteQueries(PIPELINE_QUERY_COUNT, frame.pipelineQueries);
+        }
+        frame.ranges.clear();
+        frame.usedTimestamps = 0;
+        frame.pending = false;
+    }
+
+    m_inFrame = false;
+    m_initialized = false;
+}
+
+void GpuProfiler::beginFrame() {
+    if (!m_initialized) return;
+
+    // Close the frame that was being recorded and publish its CPU times
+    if (m_inFrame) {
+        FrameQueries& previous = m_frames[m_frameIndex];
+        endPipelineQueries(previous);
+        previous.pending = true;
+
+        for (int i = 0; i < GPU_PASS_COUNT; i++) {
+            m_cpuTimes[i] = m_cpuAccum[i];
+        }
+
+        m_frameIndex = (m_frameIndex + 1) % FRAME_LATENCY;
+    }
+
+    // This slot was recorded FRAME_LATENCY frames ago
+    FrameQueries& frame = m_frames[m_frameIndex];
+    if (frame.pending) {
+        collect(frame);
+    }
+
+    frame.ranges.clear();
+    frame.usedTimestamps = 0;
+    frame.pending = false;
+    for (int& open : frame.openRanges) {
+        open = -1;
+    }
+
+    for (int i = 0; i < GPU_PASS_COUNT; i++) {
+        m_cpuAccum[i] = 0.0f;
+    }
+
+    if (m_pipelineStatsSupported) {
+        glBeginQuery(GL_VERTICES_SUBMITTED_ARB, frame.pipelineQueries[QUERY_VERTICES]);
+        glBeginQuery(GL_PRIMITIVES_SUBMITTED_ARB, frame.pipelineQueries[QUERY_PRIMITIVES]);
+        glBeginQuery(GL_CLIPPING_OUTPUT_PRIMITIVES_ARB, frame.pipelineQueries[QUERY_CLIPPED]);
+        glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, frame.pipelineQueries[QUERY_FRAGMENTS]);
+        frame.pipelineActive = true;
+    }
+
+    m_inFrame = true;
+}
+
+void GpuProfiler::beginPass(GpuPass pass) {
+    if (!m_inFrame) return;
+
+    int index = static_cast<int>(pass);
+    m_cpuStart[index] = Clock::now();
+
+    FrameQueries& frame = m_frames[m_frameIndex];
+    if (frame.openRanges[index] >= 0) return;
+
+    // Keep room for the end timestamp of every range that is still open
+    int openCount = 0;
+    for (int open : frame.openRanges) {
+        if (open >= 0) openCount++;
+    }
+    if (frame.usedTimestamps + openCount + 2 > static_cast<int>(frame.timestamps.size())) {
+        return;
+    }
+
+    glQueryCounter(frame.timestamps[frame.usedTimestamps], GL_TIMESTAMP);
+    frame.ranges.push_back({pass, frame.usedTimestamps, -1});
+    frame.openRanges[index] = static_cast<int>(frame.ranges.size()) - 1;
+    frame.usedTimestamps++;
+}
+
+void GpuProfiler::endPass(GpuPass pass) {
+    if (!m_inFrame) return;
+
+    int index = static_cast<int>(pass);
+    std::chrono::duration<float, std::milli> elapsed = Clock::now() - m_cpuStart[index];
+    m_cpuAccum[index] += elapsed.count();
+
+    FrameQueries& frame = m_frames[m_frameIndex];
+    int rangeIndex = frame.openRanges[index];
+    if (rangeIndex < 0) return;
+
+    glQueryCounter(frame.timestamps[frame.usedTimestamps], GL_TIMESTAMP);
+    frame.ranges[rangeIndex].endQuery = frame.usedTimestamps;
+    frame.openRanges[index] = -1;
+    frame.usedTimestamps++;
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+    frame.pending = false;
+
+    // Timestamps resolve in order, so the last one tells us about all of them.
+    // If the GPU is still behind, drop this frame rather than wait.
+    if (frame.usedTimestamps > 0) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(frame.timestamps[frame.usedTimestamps - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        float gpuTimes[GPU_PASS_COUNT] = {};
+        for (const auto& range : frame.ranges) {
+            if (range.endQuery < 0) continue;
+
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(frame.timestamps[range.beginQuery], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.timestamps[range.endQuery], GL_QUERY_RESULT, &end);
+            gpuTimes[static_cast<int>(range.pass)] += static_cast<float>(end - begin) / 1000000.0f;
+        }
+
+        for (int i = 0; i < GPU_PASS_COUNT; i++) {
+            m_gpuTimes[i] = gpuTimes[i];
+        }
+    }
+
+    if (m_pipelineStatsSupported) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(frame.pipelineQueries[QUERY_FRAGMENTS], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        GLuint64 values[PIPELINE_QUERY_COUNT] = {};
+        for (int i = 0; i < PIPELINE_QUERY_COUNT; i++) {
+            glGetQueryObjectui64v(frame.pipelineQueries[i], GL_QUERY_RESULT, &values[i]);
+        }
+
+        m_pipelineStats.verticesSubmitted = values[QUERY_VERTICES];
+        m_pipelineStats.primitivesSubmitted = values[QUERY_PRIMITIVES];
+        m_pipelineStats.clippingOutputPrimitives = values[QUERY_CLIPPED];
+        m_pipelineStats.fragmentInvocations = values[QUERY_FRAGMENTS];
+    }
+}
+
+void GpuProfiler::endPipelineQueries(FrameQueries& frame) {
+    if (!frame.pipelineActive) return;
+
+    glEndQuery(GL_VERTICES_SUBMITTED_ARB);
+    glEndQuery(GL_PRIMITIVES_SUBMITTED_ARB);
+    glEndQuery(GL_CLIPPING_OUTPUT_PRIMITIVES_ARB);
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    frame.pipelineActive = false;
+}
+
+float GpuProfiler::getCpuFrameTime() const {
+    return m_cpuTimes[static_cast<int>(GpuPass::SCENE)] +
+           m_cpuTimes[static_cast<int>(GpuPass::POST_PROCESS)] +
+           m_cpuTimes[static_cast<int>(GpuPass::UI)];
+}
+
+float GpuProfiler::getGpuFrameTime() const {
+    return m_gpuTimes[static_cast<int>(GpuPass::SCENE)] +
+           m_gpuTimes[static_cast<int>(GpuPass::POST_PROCESS)] +
+           m_gpuTimes[static_cast<int>(GpuPass::UI)];
+}
+
+const char* GpuProfiler::getPassName(GpuPass pass) {
+    switch (pass) {
+        case GpuPass::SCENE: return "Scene";
+        case GpuPass::POST_PROCESS: return "Post";
+        case GpuPass::UI: return "UI";
+        case GpuPass::TEXT: return "Text";
+        case GpuPass::SHADOWS: return "Shadows";
+        case GpuPass::BLOOM: return "Bloom";
+        default: return "Unknown";
+    }
+}
+
+} // namespace ExperimentRedbear
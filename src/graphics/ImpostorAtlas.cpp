@@ -0,0 +1,475 @@
+#include "graphics/ImpostorAtlas.h"
+#include "graphics/Model.h"
+#include "graphics/Renderer.h"
+#include "graphics/RenderState.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/ShaderInterface.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// Mip levels kept so the smallest level still has 4x4 texels per frame
+constexpr int ATLAS_LEVELS = 6;
+
+// Hemi-octahedral mapping of the upper hemisphere onto [-1, 1]^2, shared by
+// the baker and the billboard shader
+glm::vec3 hemiOctDecode(const glm::vec2& uv) {
+    float x = (uv.x + uv.y) * 0.5f;
+    float z = (uv.x - uv.y) * 0.5f;
+    return glm::normalize(glm::vec3(x, 1.0f - std::abs(x) - std::abs(z), z));
+}
+
+// Right/up axes of the view looking back along dir
+void frameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up) {
+    glm::vec3 worldUp = std::abs(dir.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    right = glm::normalize(glm::cross(worldUp, dir));
+    up = glm::cross(dir, right);
+}
+
+const char* IMPOSTOR_GLSL = R"(
+const float FRAMES_PER_SIDE = 8.0;
+
+vec2 hemiOctEncode(vec3 d) {
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    return vec2(d.x + d.z, d.x - d.z);
+}
+
+vec3 hemiOctDecode(vec2 uv) {
+    vec2 xz = vec2(uv.x + uv.y, uv.x - uv.y) * 0.5;
+    return normalize(vec3(xz.x, 1.0 - abs(xz.x) - abs(xz.y), xz.y));
+}
+
+void frameBasis(vec3 dir, out vec3 right, out vec3 up) {
+    vec3 worldUp = abs(dir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(worldUp, dir));
+    up = cross(dir, right);
+}
+
+// Same rotation as glm::rotate(angle, +Y)
+vec3 rotateY(vec3 v, float angle) {
+    float s = sin(angle);
+    float c = cos(angle);
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+)";
+
+// Bake and draw uniforms
+constexpr UniformID CENTER("center");
+constexpr UniformID RADIUS("radius");
+constexpr UniformID VIEW_DIR("viewDir");
+constexpr UniformID VIEW_RIGHT("viewRight");
+constexpr UniformID VIEW_UP("viewUp");
+constexpr UniformID COLOR("color");
+constexpr UniformID PART_SCALE("partScale");
+constexpr UniformID VARIANT_BOUNDS("variantBounds");
+
+} // namespace
+
+ImpostorAtlas::ImpostorAtlas() {}
+
+ImpostorAtlas::~ImpostorAtlas() = default;
+
+bool ImpostorAtlas::initialize() {
+    if (m_initialized) return true;
+
+    createShaders();
+
+    // Unit quad as a CCW triangle strip, expanded in the vertex shader
+    const float corners[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f
+    };
+
+    glGenVertexArrays(1, &m_quadVAO);
+    glGenBuffers(1, &m_quadVBO);
+    glBindVertexArray(m_quadVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    // Instances come from the stream buffer; draw() points binding 1 at
+    // each frame's allocation
+    glEnableVertexArrayAttrib(m_quadVAO, 1);
+    glVertexArrayAttribFormat(m_quadVAO, 1, 4, GL_FLOAT, GL_FALSE, offsetof(ImpostorInstance, positionScale));
+    glVertexArrayAttribBinding(m_quadVAO, 1, 1);
+    glEnableVertexArrayAttrib(m_quadVAO, 2);
+    glVertexArrayAttribFormat(m_quadVAO, 2, 4, GL_FLOAT, GL_FALSE, offsetof(ImpostorInstance, params));
+    glVertexArrayAttribBinding(m_quadVAO, 2, 1);
+    glVertexArrayBindingDivisor(m_quadVAO, 1, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_initialized = true;
+    return true;
+}
+
+void ImpostorAtlas::shutdown() {
+    if (m_albedoTexture) {
+        glDeleteTextures(1, &m_albedoTexture);
+        m_albedoTexture = 0;
+    }
+    if (m_normalDepthTexture) {
+        glDeleteTextures(1, &m_normalDepthTexture);
+        m_normalDepthTexture = 0;
+    }
+    if (m_bakeFBO) {
+        glDeleteFramebuffers(1, &m_bakeFBO);
+        m_bakeFBO = 0;
+    }
+    if (m_bakeDepth) {
+        glDeleteRenderbuffers(1, &m_bakeDepth);
+        m_bakeDepth = 0;
+    }
+    if (m_quadVAO) {
+        glDeleteVertexArrays(1, &m_quadVAO);
+        m_quadVAO = 0;
+    }
+    if (m_quadVBO) {
+        glDeleteBuffers(1, &m_quadVBO);
+        m_quadVBO = 0;
+    }
+    m_bakeShader.reset();
+    m_drawShader.reset();
+    m_variantBounds.clear();
+    m_variantCount = 0;
+    m_initialized = false;
+}
+
+void ImpostorAtlas::createShaders() {
+    const std::string header = "#version 450 core\n";
+
+    const char* bakeVertexSource = R"(
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+uniform vec3 partScale;
+uniform vec3 center;
+uniform float radius;
+uniform vec3 viewDir;
+uniform vec3 viewRight;
+uniform vec3 viewUp;
+
+out vec3 Normal;
+out float Depth;
+
+void main() {
+    // Orthographic view of the bounding sphere along viewDir
+    vec3 local = aPos * partScale - center;
+    float depth = dot(local, viewDir) / radius;
+    gl_Position = vec4(dot(local, viewRight) / radius, dot(local, viewUp) / radius, -depth, 1.0);
+
+    Normal = aNormal / partScale;
+    Depth = depth * 0.5 + 0.5;
+}
+)";
+
+    const char* bakeFragmentSource = R"(
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalDepth;
+
+in vec3 Normal;
+in float Depth;
+
+uniform vec3 color;
+
+void main() {
+    vec3 normal = normalize(Normal);
+    if (!gl_FrontFacing) normal = -normal;
+
+    Albedo = vec4(color, 1.0);
+    NormalDepth = vec4(normal * 0.5 + 0.5, Depth);
+}
+)";
+
+    Shader bakeVert, bakeFrag;
+    bakeVert.loadFromSource(header + bakeVertexSource, ShaderType::VERTEX);
+    bakeFrag.loadFromSource(header + bakeFragmentSource, ShaderType::FRAGMENT);
+
+    m_bakeShader = std::make_unique<ShaderProgram>();
+    m_bakeShader->attachShader(bakeVert);
+    m_bakeShader->attachShader(bakeFrag);
+    m_bakeShader->link();
+
+    const char* drawVertexSource = R"(
+layout (location = 0) in vec2 aCorner;
+layout (location = 1) in vec4 aPositionScale;
+layout (location = 2) in vec4 aParams;
+
+uniform vec4 variantBounds[8];
+
+out vec3 TexCoords;
+out vec3 WorldPos;
+out float FogFactor;
+flat out float Fade;
+flat out float Yaw;
+flat out vec3 FrameDir;
+flat out float Radius;
+
+void main() {
+    int variant = int(aParams.y);
+    vec4 bounds = variantBounds[variant];
+    float scale = aPositionScale.w;
+    float yaw = aParams.x;
+
+    vec3 center = aPositionScale.xyz + rotateY(bounds.xyz, yaw) * scale;
+    float radius = bounds.w * scale;
+
+    // Direction to the eye in the variant's own frame, folded onto the
+    // baked hemisphere
+    vec3 toEye = rotateY(viewPos.xyz - center, -yaw);
+    toEye.y = max(toEye.y, 0.0);
+    toEye = dot(toEye, toEye) > 1e-8 ? normalize(toEye) : vec3(0.0, 1.0, 0.0);
+
+    vec2 grid = (hemiOctEncode(toEye) * 0.5 + 0.5) * FRAMES_PER_SIDE - 0.5;
+    vec2 frame = clamp(round(grid), 0.0, FRAMES_PER_SIDE - 1.0);
+
+    // Orient the quad exactly like the nearest baked view
+    vec3 dir = hemiOctDecode((frame + 0.5) / FRAMES_PER_SIDE * 2.0 - 1.0);
+    vec3 right, up;
+    frameBasis(dir, right, up);
+
+    WorldPos = center + (aCorner.x * rotateY(right, yaw) + aCorner.y * rotateY(up, yaw)) * radius;
+    TexCoords = vec3((frame + aCorner * 0.5 + 0.5) / FRAMES_PER_SIDE, float(variant));
+    Fade = aParams.z;
+    Yaw = yaw;
+    FrameDir = rotateY(dir, yaw);
+    Radius = radius;
+
+    float dist = -(view * vec4(WorldPos, 1.0)).z;
+    if (fogColor.a > 0.5) {
+        FogFactor = clamp((fogParams.y - dist) / (fogParams.y - fogParams.x), 0.0, 1.0);
+    } else {
+        FogFactor = 1.0;
+    }
+
+    gl_Position = viewProjection * vec4(WorldPos, 1.0);
+}
+)";
+
+    const char* drawFragmentSource = R"(
+out vec4 FragColor;
+
+in vec3 TexCoords;
+in vec3 WorldPos;
+in float FogFactor;
+flat in float Fade;
+flat in float Yaw;
+flat in vec3 FrameDir;
+flat in float Radius;
+
+layout (binding = 2) uniform sampler2DArray impostorAlbedo;
+layout (binding = 3) uniform sampler2DArray impostorNormalDepth;
+
+void main() {
+    vec4 albedo = texture(impostorAlbedo, TexCoords);
+    if (albedo.a < 0.5) discard;
+
+    // Cross-fade against the mesh LOD that is fading out
+    if (ditherThreshold(gl_FragCoord.xy) >= Fade) discard;
+
+    vec4 normalDepth = texture(impostorNormalDepth, TexCoords);
+    vec3 normal = rotateY(normalize(normalDepth.xyz * 2.0 - 1.0), Yaw);
+
+    // Push the depth onto the baked surface so impostors intersect the
+    // ground and each other correctly
+    vec3 surface = WorldPos + FrameDir * (normalDepth.w * 2.0 - 1.0) * Radius;
+    vec4 clip = viewProjection * vec4(surface, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // Far trees only get the ambient and directional (moon) light
+    vec3 lighting = ambientColor.rgb;
+    for (uint i = 0u; i < clusterGrid.w; i++) {
+        vec3 lightDir = normalize(-lights[i].directionType.xyz);
+        lighting += lights[i].colorConstant.rgb * max(dot(normal, lightDir), 0.0);
+    }
+
+    vec3 finalColor = albedo.rgb * lighting;
+    if (fogColor.a > 0.5) {
+        finalColor = mix(fogColor.rgb, finalColor, FogFactor);
+    }
+
+    FragColor = vec4(finalColor, 1.0);
+}
+)";
+
+    Shader drawVert, drawFrag;
+    drawVert.loadFromSource(header + ShaderInterface::FRAME_CONSTANTS + IMPOSTOR_GLSL + drawVertexSource,
+                            ShaderType::VERTEX);
+    drawFrag.loadFromSource(header + ShaderInterface::FRAME_CONSTANTS + ShaderInterface::LIGHTS +
+                            ShaderInterface::DITHER + IMPOSTOR_GLSL + drawFragmentSource,
+                            ShaderType::FRAGMENT);
+
+    m_drawShader = std::make_unique<ShaderProgram>();
+    m_drawShader->attachShader(drawVert);
+    m_drawShader->attachShader(drawFrag);
+    m_drawShader->link();
+}
+
+bool ImpostorAtlas::bake(const std::vector<ImpostorSource>& variants) {
+    if (!m_initialized || variants.empty()) return false;
+
+    const int variantCount = std::min(static_cast<int>(variants.size()), MAX_VARIANTS);
+    const int atlasSize = FRAMES_PER_SIDE * FRAME_SIZE;
+
+    if (m_albedoTexture) glDeleteTextures(1, &m_albedoTexture);
+    if (m_normalDepthTexture) glDeleteTextures(1, &m_normalDepthTexture);
+
+    GLuint* textures[] = {&m_albedoTexture, &m_normalDepthTexture};
+    for (GLuint* texture : textures) {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, *texture);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, ATLAS_LEVELS, GL_RGBA8, atlasSize, atlasSize, variantCount);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (!m_bakeFBO) {
+        glGenFramebuffers(1, &m_bakeFBO);
+        glGenRenderbuffers(1, &m_bakeDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_bakeDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    // Baking can happen mid-session, so leave the caller's state as it was
+    GLint previousFBO = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_bakeFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_bakeDepth);
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    // Everything above bound directly, and the parts below draw through
+    // RenderState, so start it from scratch
+    RenderState::getInstance().invalidate();
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    m_bakeShader->bind();
+    m_variantBounds.assign(MAX_VARIANTS, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    for (int variant = 0; variant < variantCount; variant++) {
+        const ImpostorSource& source = variants[variant];
+        m_variantBounds[variant] = glm::vec4(source.center, source.radius);
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_albedoTexture, 0, variant);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_normalDepthTexture, 0, variant);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            LOG_ERROR("Impostor bake framebuffer is incomplete");
+            break;
+        }
+
+        glViewport(0, 0, atlasSize, atlasSize);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        m_bakeShader->setVec3(CENTER, source.center);
+        m_bakeShader->setFloat(RADIUS, source.radius);
+
+        for (int y = 0; y < FRAMES_PER_SIDE; y++) {
+            for (int x = 0; x < FRAMES_PER_SIDE; x++) {
+                glm::vec2 uv((x + 0.5f) / FRAMES_PER_SIDE * 2.0f - 1.0f,
+                             (y + 0.5f) / FRAMES_PER_SIDE * 2.0f - 1.0f);
+                glm::vec3 dir = hemiOctDecode(uv);
+                glm::vec3 right, up;
+                frameBasis(dir, right, up);
+
+                m_bakeShader->setVec3(VIEW_DIR, dir);
+                m_bakeShader->setVec3(VIEW_RIGHT, right);
+                m_bakeShader->setVec3(VIEW_UP, up);
+
+                glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+                for (const auto& part : source.parts) {
+                    if (!part.mesh) continue;
+                    m_bakeShader->setVec3(COLOR, part.color);
+                    m_bakeShader->setVec3(PART_SCALE, part.scale);
+                    part.mesh->draw();
+                }
+            }
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_albedoTexture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_normalDepthTexture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (cullFace) glEnable(GL_CULL_FACE);
+    if (blend) glEnable(GL_BLEND);
+
+    RenderState::getInstance().invalidate();
+
+    m_drawShader->bind();
+    m_drawShader->setVec4(VARIANT_BOUNDS, MAX_VARIANTS, glm::value_ptr(m_variantBounds[0]));
+    m_drawShader->unbind();
+
+    m_variantCount = variantCount;
+    LOG_INFO("Baked " + std::to_string(variantCount) + " impostor variants (" +
+             std::to_string(FRAMES_PER_SIDE * FRAMES_PER_SIDE) + " views each)");
+    return true;
+}
+
+void ImpostorAtlas::draw(const std::vector<ImpostorInstance>& instances, RenderStats& stats) {
+    if (!isBaked() || instances.empty()) return;
+
+    StreamAllocation upload = StreamBuffer::getInstance().write(instances.data(), instances.size() * sizeof(ImpostorInstance));
+    if (!upload) return;
+    glVertexArrayVertexBuffer(m_quadVAO, 1, upload.buffer, upload.offset, sizeof(ImpostorInstance));
+
+    m_drawShader->bind();
+    RenderState& state = RenderState::getInstance();
+    state.bindTexture(TextureBinding::IMPOSTOR_ALBEDO, m_albedoTexture);
+    state.bindTexture(TextureBinding::IMPOSTOR_NORMAL_DEPTH, m_normalDepthTexture);
+
+    state.bindVertexArray(m_quadVAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size()));
+
+    stats.drawCalls++;
+    stats.shaderBinds++;
+    stats.textureBindings += 2;
+    stats.triangles += static_cast<int>(instances.size()) * 2;
+    stats.impostorsDrawn += static_cast<int>(instances.size());
+}
+
+void ImpostorAtlas::drawIndirect(GLuint instanceBuffer, GLuint drawBuffer, GLintptr drawOffset, RenderStats& stats) {
+    if (!isBaked() || !instanceBuffer || !drawBuffer) return;
+
+    glVertexArrayVertexBuffer(m_quadVAO, 1, instanceBuffer, 0, sizeof(ImpostorInstance));
+
+    m_drawShader->bind();
+    RenderState& state = RenderState::getInstance();
+    state.bindTexture(TextureBinding::IMPOSTOR_ALBEDO, m_albedoTexture);
+    state.bindTexture(TextureBinding::IMPOSTOR_NORMAL_DEPTH, m_normalDepthTexture);
+
+    state.bindVertexArray(m_quadVAO);
+    state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBuffer);
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(drawOffset));
+
+    stats.drawCalls++;
+    stats.shaderBinds++;
+    stats.textureBindings += 2;
+}
+
+} // namespace ExperimentRedbear
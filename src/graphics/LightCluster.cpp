@@ -0,0 +1,184 @@
+#include "graphics/LightCluster.h"
+#include "graphics/StreamBuffer.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+LightClusterGrid::LightClusterGrid() {}
+
+LightClusterGrid::~LightClusterGrid() = default;
+
+bool LightClusterGrid::initialize() {
+    m_clusterCounts.assign(CLUSTER_COUNT, 0);
+    m_clusters.assign(CLUSTER_COUNT, glm::uvec2(0));
+    return true;
+}
+
+void LightClusterGrid::shutdown() {
+    m_gpuLights.clear();
+    m_lightIndices.clear();
+}
+
+GPULight LightClusterGrid::packLight(const Light& light, int shadowTile) {
+    GPULight gpu;
+    gpu.positionRange = glm::vec4(light.position, light.range);
+    gpu.directionType = glm::vec4(light.direction, static_cast<float>(light.type));
+    gpu.colorConstant = glm::vec4(light.color * light.intensity, light.constant);
+    gpu.attenuation = glm::vec4(light.linear, light.quadratic,
+                                glm::cos(glm::radians(light.innerConeAngle)),
+                                glm::cos(glm::radians(light.outerConeAngle)));
+    gpu.shadowParams = glm::vec4(static_cast<float>(shadowTile), light.shadowBias,
+                                 light.shadowNormalBias, 0.0f);
+    return gpu;
+}
+
+int LightClusterGrid::sliceForDepth(float depth) const {
+    float slice = std::log(std::max(depth, m_nearPlane)) * m_sliceScale + m_sliceBias;
+    return std::clamp(static_cast<int>(std::floor(slice)), 0, GRID_Z - 1);
+}
+
+bool LightClusterGrid::computeTileRange(const glm::vec3& viewCenter, float radius,
+                                        const glm::mat4& projection, ClusterRange& range) const {
+    range.minX = 0;
+    range.maxX = GRID_X - 1;
+    range.minY = 0;
+    range.maxY = GRID_Y - 1;
+
+    // If the bounds reach in front of the near plane the projection is unbounded,
+    // so the light simply covers every tile in its depth range
+    if (-(viewCenter.z + radius) < m_nearPlane) {
+        return true;
+    }
+
+    glm::vec2 ndcMin(1.0f);
+    glm::vec2 ndcMax(-1.0f);
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = viewCenter + glm::vec3(
+            (i & 1) ? radius : -radius,
+            (i & 2) ? radius : -radius,
+            (i & 4) ? radius : -radius);
+
+        glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    // Entirely off screen
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+        return false;
+    }
+
+    ndcMin = glm::clamp(ndcMin, -1.0f, 1.0f);
+    ndcMax = glm::clamp(ndcMax, -1.0f, 1.0f);
+
+    range.minX = std::clamp(static_cast<int>((ndcMin.x * 0.5f + 0.5f) * GRID_X), 0, GRID_X - 1);
+    range.maxX = std::clamp(static_cast<int>((ndcMax.x * 0.5f + 0.5f) * GRID_X), 0, GRID_X - 1);
+    range.minY = std::clamp(static_cast<int>((ndcMin.y * 0.5f + 0.5f) * GRID_Y), 0, GRID_Y - 1);
+    range.maxY = std::clamp(static_cast<int>((ndcMax.y * 0.5f + 0.5f) * GRID_Y), 0, GRID_Y - 1);
+    return true;
+}
+
+void LightClusterGrid::build(const Camera& camera, const std::vector<Light>& lights,
+                             int viewportWidth, int viewportHeight, float maxDistance,
+                             const std::vector<int>& shadowTiles) {
+    m_gpuLights.clear();
+    m_ranges.clear();
+    m_directionalCount = 0;
+
+    // Directional lights reach every cluster, so they are stored first and
+    // looped over unconditionally in the shader
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (lights[i].type == LightType::DIRECTIONAL) {
+            int shadow = i < shadowTiles.size() ? shadowTiles[i] : -1;
+            m_gpuLights.push_back(packLight(lights[i], shadow));
+            m_directionalCount++;
+        }
+    }
+
+    // Exponential depth slicing: slice = log(z) * scale + bias
+    m_nearPlane = camera.getNearPlane();
+    m_farPlane = std::max(std::min(maxDistance, camera.getFarPlane()), m_nearPlane * 2.0f);
+    float logRatio = std::log(m_farPlane / m_nearPlane);
+    m_sliceScale = GRID_Z / logRatio;
+    m_sliceBias = -GRID_Z * std::log(m_nearPlane) / logRatio;
+    m_tileSize = glm::vec2(static_cast<float>(std::max(viewportWidth, 1)) / GRID_X,
+                           static_cast<float>(std::max(viewportHeight, 1)) / GRID_Y);
+
+    glm::mat4 view = camera.getViewMatrix();
+    glm::mat4 projection = camera.getProjectionMatrix();
+
+    std::fill(m_clusterCounts.begin(), m_clusterCounts.end(), 0u);
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& light = lights[i];
+        if (light.type == LightType::DIRECTIONAL) continue;
+
+        // Spot lights use the bounding sphere of their range
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        float radius = light.range;
+        float depth = -center.z;
+
+        if (depth + radius < m_nearPlane || depth - radius > m_farPlane) continue;
+
+        ClusterRange range;
+        if (!computeTileRange(center, radius, projection, range)) continue;
+
+        range.minZ = sliceForDepth(depth - radius);
+        range.maxZ = sliceForDepth(depth + radius);
+        range.lightIndex = static_cast<uint32_t>(m_gpuLights.size());
+
+        int shadowTile = i < shadowTiles.size() ? shadowTiles[i] : -1;
+        m_gpuLights.push_back(packLight(light, shadowTile));
+        m_ranges.push_back(range);
+
+        for (int z = range.minZ; z <= range.maxZ; z++) {
+            for (int y = range.minY; y <= range.maxY; y++) {
+                for (int x = range.minX; x <= range.maxX; x++) {
+                    m_clusterCounts[x + GRID_X * (y + GRID_Y * z)]++;
+                }
+            }
+        }
+    }
+
+    // Prefix sum into per-cluster offsets, then scatter the light indices
+    uint32_t offset = 0;
+    for (int i = 0; i < CLUSTER_COUNT; i++) {
+        m_clusters[i] = glm::uvec2(offset, 0u);
+        offset += m_clusterCounts[i];
+    }
+    m_lightIndices.resize(offset);
+
+    for (const auto& range : m_ranges) {
+        for (int z = range.minZ; z <= range.maxZ; z++) {
+            for (int y = range.minY; y <= range.maxY; y++) {
+                for (int x = range.minX; x <= range.maxX; x++) {
+                    glm::uvec2& cluster = m_clusters[x + GRID_X * (y + GRID_Y * z)];
+                    m_lightIndices[cluster.x + cluster.y] = range.lightIndex;
+                    cluster.y++;
+                }
+            }
+        }
+    }
+
+    StreamBuffer& stream = StreamBuffer::getInstance();
+    StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::LIGHTS,
+                            stream.writeStorage(m_gpuLights.data(), m_gpuLights.size() * sizeof(GPULight)));
+    StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::LIGHT_CLUSTERS,
+                            stream.writeStorage(m_clusters.data(), m_clusters.size() * sizeof(glm::uvec2)));
+    StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::LIGHT_INDICES,
+                            stream.writeStorage(m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t)));
+}
+
+glm::uvec4 LightClusterGrid::getGridInfo() const {
+    return glm::uvec4(GRID_X, GRID_Y, GRID_Z, m_directionalCount);
+}
+
+glm::vec4 LightClusterGrid::getGridParams() const {
+    return glm::vec4(m_tileSize, m_sliceScale, m_sliceBias);
+}
+
+} // namespace ExperimentRedbear
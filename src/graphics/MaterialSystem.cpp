@@ -0,0 +1,246 @@
+#include "graphics/MaterialSystem.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+MaterialSystem::MaterialSystem() {}
+
+MaterialSystem::~MaterialSystem() = default;
+
+bool MaterialSystem::initialize() {
+    if (m_initialized) return true;
+
+    m_bindless = GLEW_ARB_bindless_texture;
+
+    m_materialBuffer.create(GL_SHADER_STORAGE_BUFFER, 64 * sizeof(GPUMaterial));
+    m_materialBuffer.bindBase(StorageBinding::MATERIALS);
+
+    m_dirty = true;
+    m_initialized = true;
+
+    LOG_INFO(std::string("Material system initialized (") +
+             (m_bindless ? "bindless texture arrays" : "bound texture arrays") + ")");
+    return true;
+}
+
+void MaterialSystem::shutdown() {
+    if (!m_initialized) return;
+
+    for (auto& array : m_arrays) {
+        releaseHandle(array);
+        glDeleteTextures(1, &array.texture);
+    }
+    m_arrays.clear();
+    m_materials.clear();
+    m_textureCache.clear();
+    m_gpuMaterials.clear();
+    m_materialBuffer.destroy();
+
+    m_initialized = false;
+}
+
+uint32_t MaterialSystem::createMaterial(const MaterialDesc& desc) {
+    Material material;
+    material.diffuse = desc.diffusePath.empty() ? TextureRef() : loadTexture(desc.diffusePath, true);
+    material.normal = desc.normalPath.empty() ? TextureRef() : loadTexture(desc.normalPath, false);
+    material.baseColor = desc.baseColor;
+
+    m_materials.push_back(material);
+    m_dirty = true;
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+MaterialSystem::TextureRef MaterialSystem::loadTexture(const std::string& path, bool srgb) {
+    const std::string key = path + (srgb ? "#srgb" : "#linear");
+    auto it = m_textureCache.find(key);
+    if (it != m_textureCache.end()) {
+        return it->second;
+    }
+
+    stbi_set_flip_vertically_on_load(true);
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data) {
+        LOG_ERROR("Failed to load material texture: " + path);
+        return TextureRef();
+    }
+
+    TextureRef ref = addTexture(data, width, height, srgb);
+    stbi_image_free(data);
+
+    m_textureCache[key] = ref;
+    return ref;
+}
+
+MaterialSystem::TextureRef MaterialSystem::addTexture(const unsigned char* rgba, int width, int height, bool srgb) {
+    // Same size and color space share an array
+    int arrayIndex = -1;
+    for (size_t i = 0; i < m_arrays.size(); i++) {
+        const TextureArray& array = m_arrays[i];
+        if (array.width == width && array.height == height && array.srgb == srgb) {
+            arrayIndex = static_cast<int>(i);
+            break;
+        }
+    }
+
+    if (arrayIndex < 0) {
+        if (!m_bindless && static_cast<int>(m_arrays.size()) >= MAX_MATERIAL_ARRAYS) {
+            LOG_WARNING("Out of material texture arrays, texture size " + std::to_string(width) + "x" +
+                        std::to_string(height) + " is skipped (resize it to an existing size)");
+            return TextureRef();
+        }
+
+        TextureArray array;
+        array.width = width;
+        array.height = height;
+        array.srgb = srgb;
+        array.levels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+        m_arrays.push_back(array);
+        arrayIndex = static_cast<int>(m_arrays.size()) - 1;
+    }
+
+    TextureArray& array = m_arrays[arrayIndex];
+    if (array.layers == array.capacity) {
+        growArray(array);
+    }
+
+    int layer = array.layers++;
+
+    // Mipmaps cover the whole array, so they wait for bind() instead of
+    // being rebuilt for every layer
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    array.mipmapsDirty = true;
+
+    return TextureRef{arrayIndex, layer};
+}
+
+void MaterialSystem::growArray(TextureArray& array) {
+    // Storage is immutable, so a full array is replaced by one twice the
+    // size and the existing layers are copied over on the GPU
+    int capacity = std::max(array.capacity * 2, 4);
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+                   array.width, array.height, capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    GLfloat maxAniso = 0.0f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAniso);
+    if (maxAniso > 0.0f) {
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(16.0f, maxAniso));
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (array.texture) {
+        for (int level = 0; level < array.levels; level++) {
+            int levelWidth = std::max(array.width >> level, 1);
+            int levelHeight = std::max(array.height >> level, 1);
+            glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               levelWidth, levelHeight, array.layers);
+        }
+        releaseHandle(array);
+        glDeleteTextures(1, &array.texture);
+    }
+
+    array.texture = texture;
+    array.capacity = capacity;
+    m_dirty = true;
+}
+
+void MaterialSystem::releaseHandle(TextureArray& array) {
+    if (array.handle) {
+        glMakeTextureHandleNonResidentARB(array.handle);
+        array.handle = 0;
+    }
+}
+
+glm::uvec4 MaterialSystem::packRef(const TextureRef& ref) const {
+    if (ref.array < 0) return glm::uvec4(0u);
+
+    const TextureArray& array = m_arrays[ref.array];
+    if (m_bindless) {
+        return glm::uvec4(static_cast<uint32_t>(array.handle & 0xFFFFFFFFu),
+                          static_cast<uint32_t>(array.handle >> 32),
+                          static_cast<uint32_t>(ref.layer), 1u);
+    }
+    return glm::uvec4(static_cast<uint32_t>(ref.array), 0u, static_cast<uint32_t>(ref.layer), 1u);
+}
+
+int MaterialSystem::bind() {
+    if (!m_initialized) return 0;
+
+    for (auto& array : m_arrays) {
+        if (array.mipmapsDirty) {
+            glGenerateTextureMipmap(array.texture);
+            array.mipmapsDirty = false;
+        }
+    }
+
+    if (m_dirty) {
+        // Handles are taken after all growth so they never point at
+        // storage that was replaced
+        if (m_bindless) {
+            for (auto& array : m_arrays) {
+                if (!array.handle) {
+                    array.handle = glGetTextureHandleARB(array.texture);
+                    glMakeTextureHandleResidentARB(array.handle);
+                }
+            }
+        }
+
+        m_gpuMaterials.resize(m_materials.size());
+        for (size_t i = 0; i < m_materials.size(); i++) {
+            const Material& material = m_materials[i];
+            m_gpuMaterials[i].diffuse = packRef(material.diffuse);
+            m_gpuMaterials[i].normal = packRef(material.normal);
+            m_gpuMaterials[i].baseColor = material.baseColor;
+        }
+
+        if (!m_gpuMaterials.empty()) {
+            m_materialBuffer.upload(m_gpuMaterials.data(), m_gpuMaterials.size() * sizeof(GPUMaterial));
+        }
+        m_materialBuffer.bindBase(StorageBinding::MATERIALS);
+        m_dirty = false;
+    }
+
+    if (m_bindless) return 0;
+
+    for (size_t i = 0; i < m_arrays.size(); i++) {
+        RenderState::getInstance().bindTexture(TextureBinding::MATERIAL_ARRAYS + static_cast<GLuint>(i), m_arrays[i].texture);
+    }
+    return static_cast<int>(m_arrays.size());
+}
+
+int MaterialSystem::getDiffuseArray(uint32_t materialIndex) const {
+    if (materialIndex >= m_materials.size()) return -1;
+    return m_materials[materialIndex].diffuse.array;
+}
+
+int MaterialSystem::getNormalArray(uint32_t materialIndex) const {
+    if (materialIndex >= m_materials.size()) return -1;
+    return m_materials[materialIndex].normal.array;
+}
+
+std::string MaterialSystem::getShaderHeader() const {
+    if (m_bindless) {
+        return "#extension GL_ARB_bindless_texture : require\n#define MATERIAL_BINDLESS 1\n";
+    }
+    return "";
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,387 @@
+#include "graphics/MeshSimplifier.h"
+#include "graphics/Model.h"
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <limits>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// Border edges get an extra plane through the edge, perpendicular to the
+// surface, so open borders (door frames, leaf cards) keep their outline
+constexpr double BOUNDARY_WEIGHT = 4.0;
+
+// Symmetric 4x4 error quadric, upper triangle only
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+
+    void addPlane(const glm::vec3& n, float d, double weight) {
+        const double a = n.x, b = n.y, c = n.z, e = d;
+        a00 += weight * a * a; a01 += weight * a * b; a02 += weight * a * c; a03 += weight * a * e;
+        a11 += weight * b * b; a12 += weight * b * c; a13 += weight * b * e;
+        a22 += weight * c * c; a23 += weight * c * e;
+        a33 += weight * e * e;
+    }
+
+    void add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+    }
+
+    // Sum of squared distances from p to the accumulated planes
+    double evaluate(const glm::vec3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+               a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+               a22 * z * z + 2.0 * a23 * z + a33;
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+} // namespace
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<Vertex>& vertices,
+                                                   const std::vector<unsigned int>& indices,
+                                                   size_t targetIndexCount, float maxError,
+                                                   float* outError) {
+    const size_t vertexCount = vertices.size();
+    if (outError) *outError = 0.0f;
+    if (indices.size() <= targetIndexCount || vertexCount == 0) return indices;
+
+    // Weld vertices that share a position (UV and normal seams) so the
+    // collapse sees one connected surface. The weld only drives adjacency
+    // and the quadrics: every triangle corner keeps an original vertex, so
+    // seams and hard edges survive in the LODs.
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].position;
+        const glm::vec3& pb = vertices[b].position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    });
+
+    std::vector<uint32_t> weld(vertexCount);
+    std::vector<std::vector<uint32_t>> weldMembers(vertexCount);
+    for (size_t k = 0; k < vertexCount; k++) {
+        uint32_t vertex = order[k];
+        if (k > 0 && vertices[vertex].position == vertices[order[k - 1]].position) {
+            weld[vertex] = weld[order[k - 1]];
+        } else {
+            weld[vertex] = vertex;
+        }
+        weldMembers[weld[vertex]].push_back(vertex);
+    }
+
+    auto position = [&](uint32_t vertex) -> const glm::vec3& { return vertices[vertex].position; };
+
+    // Vertex of a weld group whose attributes best continue corner's side
+    // of any seam through it
+    auto matchCorner = [&](uint32_t group, uint32_t corner) {
+        const Vertex& reference = vertices[corner];
+        uint32_t best = group;
+        float bestDifference = std::numeric_limits<float>::max();
+        for (uint32_t member : weldMembers[group]) {
+            const Vertex& candidate = vertices[member];
+            glm::vec3 normal = candidate.normal - reference.normal;
+            glm::vec2 uv = candidate.texCoords - reference.texCoords;
+            float difference = glm::dot(normal, normal) + glm::dot(uv, uv);
+            if (difference < bestDifference) {
+                bestDifference = difference;
+                best = member;
+            }
+        }
+        return best;
+    };
+
+    // Welded triangles, degenerate ones dropped, and the original vertex of
+    // each corner
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> corners;
+    triangles.reserve(indices.size());
+    corners.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = weld[indices[i]];
+        uint32_t b = weld[indices[i + 1]];
+        uint32_t c = weld[indices[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+        corners.insert(corners.end(), {indices[i], indices[i + 1], indices[i + 2]});
+    }
+
+    const size_t triangleCount = triangles.size() / 3;
+    std::vector<uint8_t> triangleAlive(triangleCount, 1);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<glm::vec3> triangleNormals(triangleCount, glm::vec3(0.0f));
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = &triangles[t * 3];
+        glm::vec3 normal = glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normal /= length;
+            float d = -glm::dot(normal, position(tri[0]));
+            for (int k = 0; k < 3; k++) {
+                quadrics[tri[k]].addPlane(normal, d, 1.0);
+            }
+        }
+        triangleNormals[t] = normal;
+
+        for (int k = 0; k < 3; k++) {
+            vertexTriangles[tri[k]].push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    // Edges used by a single triangle are borders
+    struct Edge {
+        uint64_t key;
+        uint32_t triangle;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(triangles.size());
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = triangles[t * 3 + k];
+            uint32_t b = triangles[t * 3 + (k + 1) % 3];
+            uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+            edges.push_back({key, static_cast<uint32_t>(t)});
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.key < b.key; });
+
+    std::vector<uint8_t> boundary(vertexCount, 0);
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j].key == edges[i].key) j++;
+
+        if (j - i == 1) {
+            uint32_t a = static_cast<uint32_t>(edges[i].key >> 32);
+            uint32_t b = static_cast<uint32_t>(edges[i].key & 0xFFFFFFFFu);
+            boundary[a] = 1;
+            boundary[b] = 1;
+
+            glm::vec3 edge = position(b) - position(a);
+            glm::vec3 normal = glm::cross(edge, triangleNormals[edges[i].triangle]);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normal /= length;
+                float d = -glm::dot(normal, position(a));
+                quadrics[a].addPlane(normal, d, BOUNDARY_WEIGHT);
+                quadrics[b].addPlane(normal, d, BOUNDARY_WEIGHT);
+            }
+        }
+        i = j;
+    }
+
+    std::vector<uint32_t> versions(vertexCount, 0);
+    std::vector<uint8_t> removed(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    // Queues the cheaper direction of an edge. A border vertex may only
+    // collapse along the border, or holes would shrink.
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+        Quadric merged = quadrics[a];
+        merged.add(quadrics[b]);
+
+        double bestCost = std::numeric_limits<double>::max();
+        uint32_t from = a;
+        uint32_t to = b;
+        if (!boundary[a] || boundary[b]) {
+            bestCost = merged.evaluate(position(b));
+        }
+        if (!boundary[b] || boundary[a]) {
+            double cost = merged.evaluate(position(a));
+            if (cost < bestCost) {
+                bestCost = cost;
+                from = b;
+                to = a;
+            }
+        }
+        if (bestCost == std::numeric_limits<double>::max()) return;
+
+        heap.push({std::max(bestCost, 0.0), from, to, versions[from], versions[to]});
+    };
+
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (i > 0 && edges[i].key == edges[i - 1].key) continue;
+        pushEdge(static_cast<uint32_t>(edges[i].key >> 32), static_cast<uint32_t>(edges[i].key & 0xFFFFFFFFu));
+    }
+
+    const double costLimit = static_cast<double>(maxError) * static_cast<double>(maxError);
+    double reachedCost = 0.0;
+    size_t aliveTriangles = triangleCount;
+    std::vector<uint32_t> neighbors;
+
+    while (aliveTriangles * 3 > targetIndexCount && !heap.empty()) {
+        Collapse collapse = heap.top();
+        heap.pop();
+
+        if (removed[collapse.from] || removed[collapse.to] ||
+            versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion) {
+            continue;
+        }
+        if (collapse.cost > costLimit) break;
+
+        // Reject collapses that would fold a remaining triangle over
+        const glm::vec3& target = position(collapse.to);
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[collapse.from]) {
+            if (!triangleAlive[t]) continue;
+
+            uint32_t* tri = &triangles[t * 3];
+            if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) continue;
+
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; k++) {
+                p[k] = tri[k] == collapse.from ? target : position(tri[k]);
+            }
+            glm::vec3 before = glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+            glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 0.0f) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips) continue;
+
+        quadrics[collapse.to].add(quadrics[collapse.from]);
+        removed[collapse.from] = 1;
+        versions[collapse.to]++;
+        reachedCost = std::max(reachedCost, collapse.cost);
+
+        for (uint32_t t : vertexTriangles[collapse.from]) {
+            if (!triangleAlive[t]) continue;
+
+            uint32_t* tri = &triangles[t * 3];
+            if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+                triangleAlive[t] = 0;
+                aliveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (tri[k] != collapse.from) continue;
+                tri[k] = collapse.to;
+                corners[t * 3 + k] = matchCorner(collapse.to, corners[t * 3 + k]);
+            }
+            vertexTriangles[collapse.to].push_back(t);
+        }
+        std::vector<uint32_t>().swap(vertexTriangles[collapse.from]);
+
+        // Edges around the merged vertex changed cost
+        neighbors.clear();
+        for (uint32_t t : vertexTriangles[collapse.to]) {
+            if (!triangleAlive[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t vertex = triangles[t * 3 + k];
+                if (vertex != collapse.to) neighbors.push_back(vertex);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        for (uint32_t neighbor : neighbors) {
+            pushEdge(collapse.to, neighbor);
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(aliveTriangles * 3);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (!triangleAlive[t]) continue;
+        result.push_back(corners[t * 3]);
+        result.push_back(corners[t * 3 + 1]);
+        result.push_back(corners[t * 3 + 2]);
+    }
+
+    // Sum of squared plane distances bounds the largest single distance
+    if (outError) *outError = static_cast<float>(std::sqrt(reachedCost));
+    return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::buildLodChain(const std::vector<Vertex>& vertices,
+                                                   std::vector<unsigned int>& indices,
+                                                   int maxLevels, float reduction,
+                                                   size_t minTriangles) {
+    std::vector<MeshLod> lods;
+    lods.push_back({0u, static_cast<uint32_t>(indices.size()), 0.0f});
+    if (vertices.empty() || indices.empty()) return lods;
+
+    // Errors are stored relative to the bounding radius so one chain works
+    // for every scale the mesh is drawn at
+    glm::vec3 minBounds = vertices[0].position;
+    glm::vec3 maxBounds = vertices[0].position;
+    for (const auto& vertex : vertices) {
+        minBounds = glm::min(minBounds, vertex.position);
+        maxBounds = glm::max(maxBounds, vertex.position);
+    }
+    glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+    float radius = 0.0f;
+    for (const auto& vertex : vertices) {
+        radius = std::max(radius, glm::length(vertex.position - center));
+    }
+    if (radius <= 0.0f) return lods;
+
+    std::vector<unsigned int> chain = indices;
+    std::vector<unsigned int> current = indices;
+    float error = 0.0f;
+
+    for (int level = 1; level < maxLevels; level++) {
+        size_t triangles = current.size() / 3;
+        if (triangles <= minTriangles) break;
+
+        size_t target = std::max(static_cast<size_t>(static_cast<float>(triangles) * reduction), minTriangles) * 3;
+
+        float levelError = 0.0f;
+        std::vector<unsigned int> simplified =
+            simplify(vertices, current, target, std::numeric_limits<float>::max(), &levelError);
+
+        // Locked borders or folds can stall the collapse; a level that
+        // barely shrank isn't worth its memory
+        if (simplified.empty() || simplified.size() * 10 > current.size() * 9) break;
+
+        // Each level is simplified from the previous one, so errors add up
+        error += levelError;
+        lods.push_back({static_cast<uint32_t>(chain.size()), static_cast<uint32_t>(simplified.size()),
+                        error / radius});
+        chain.insert(chain.end(), simplified.begin(), simplified.end());
+        current.swap(simplified);
+    }
+
+    indices.swap(chain);
+    return lods;
+}
+
+int MeshSimplifier::selectLod(const MeshLod* lods, int lodCount, float screenSize, int current) {
+    // Errors are relative to the radius, half the on-screen diameter
+    const float pixelsPerError = screenSize * 0.5f;
+
+    for (int level = lodCount - 1; level > 0; level--) {
+        float limit = level > current ? LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS) : LOD_PIXEL_ERROR;
+        if (lods[level].error * pixelsPerError <= limit) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+} // namespace ExperimentRedbear
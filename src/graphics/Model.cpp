@@ -1,15 +1,17 @@
 #include "graphics/Model.h"
 #include "core/Logger.h"
+#include "graphics/MaterialSystem.h"
+#include "graphics/RenderState.h"
 #include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
 
 namespace ExperimentRedbear {
 
-Mesh::Mesh() : m_vao(0), m_vbo(0), m_ebo(0) {}
+Mesh::Mesh() {}
 
 Mesh::~Mesh() {
-    if (m_vao) glDeleteVertexArrays(1, &m_vao);
-    if (m_vbo) glDeleteBuffers(1, &m_vbo);
-    if (m_ebo) glDeleteBuffers(1, &m_ebo);
+    GeometryBuffer::getInstance(VertexFormat::MESH).free(m_geometry);
 }
 
 void Mesh::create(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
@@ -17,54 +19,69 @@ void Mesh::create(const std::vector<Vertex>& vertices, const std::vector<unsigne
     m_vertices = vertices;
     m_indices = indices;
     m_textures = textures;
+    m_lods.assign(1, MeshLod{0u, static_cast<uint32_t>(indices.size()), 0.0f});
 
     setupMesh();
 }
 
-void Mesh::setupMesh() {
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
-
-    glBindVertexArray(m_vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STATIC_DRAW);
+void Mesh::generateLods(int maxLevels, float reduction, size_t minTriangles) {
+    if (m_lods.size() > 1) return;
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW);
+    m_lods = MeshSimplifier::buildLodChain(m_vertices, m_indices, maxLevels, reduction, minTriangles);
 
-    // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // The chain no longer fits the old index range
+    GeometryBuffer::getInstance(VertexFormat::MESH).reallocateIndices(m_geometry, m_indices.data(),
+                                                                     static_cast<uint32_t>(m_indices.size()));
 
-    // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-
-    // Vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-
-    // Vertex tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+    LOG_DEBUG("Mesh LOD chain: " + std::to_string(m_lods.size()) + " levels, " +
+              std::to_string(m_lods.front().indexCount / 3) + " -> " +
+              std::to_string(m_lods.back().indexCount / 3) + " triangles");
+}
 
-    // Vertex bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+void Mesh::setupMesh() {
+    if (!GeometryBuffer::getInstance(VertexFormat::MESH).allocate(m_geometry, m_vertices.data(),
+                                                                  static_cast<uint32_t>(m_vertices.size()),
+                                                                  m_indices.data(),
+                                                                  static_cast<uint32_t>(m_indices.size()))) {
+        LOG_ERROR("Failed to upload mesh geometry");
+    }
+}
 
-    glBindVertexArray(0);
+void Mesh::createMaterial(MaterialSystem& materials) {
+    MaterialDesc desc;
+    for (const auto& texture : m_textures) {
+        if (texture.type == "texture_diffuse" && desc.diffusePath.empty()) {
+            desc.diffusePath = texture.path;
+        } else if (texture.type == "texture_normal" && desc.normalPath.empty()) {
+            desc.normalPath = texture.path;
+        }
+    }
+    m_materialIndex = materials.createMaterial(desc);
 }
 
-void Mesh::draw() const {
+void Mesh::draw(int lod) const {
+    if (!m_geometry.isValid()) return;
+
+    const MeshLod& level = m_lods[std::clamp(lod, 0, static_cast<int>(m_lods.size()) - 1)];
+    const void* offset = reinterpret_cast<const void*>(
+        static_cast<uintptr_t>(m_geometry.firstIndex + level.indexOffset) * sizeof(unsigned int));
+
+    // Material textures are already resident, the shader only needs the
+    // index (set by the caller)
+    auto& state = RenderState::getInstance();
+    if (m_materialIndex != MaterialSystem::NO_MATERIAL) {
+        state.bindVertexArray(getVAO());
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT, offset,
+                                 m_geometry.baseVertex);
+        return;
+    }
+
     // Bind textures
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     unsigned int normalNr = 1;
 
     for (unsigned int i = 0; i < m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
         std::string number;
         std::string name = m_textures[i].type;
         if (name == "texture_diffuse") {
@@ -74,21 +91,25 @@ void Mesh::draw() const {
         } else if (name == "texture_normal") {
             number = std::to_string(normalNr++);
         }
-        glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
+        state.bindTexture(i, m_textures[i].id);
     }
 
     // Draw mesh
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(m_indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    glActiveTexture(GL_TEXTURE0);
+    state.bindVertexArray(getVAO());
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT, offset,
+                             m_geometry.baseVertex);
 }
 
-void Mesh::drawInstanced(int count) const {
-    glBindVertexArray(m_vao);
-    glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(m_indices.size()), GL_UNSIGNED_INT, 0, count);
-    glBindVertexArray(0);
+void Mesh::drawInstanced(int count, int lod) const {
+    if (!m_geometry.isValid()) return;
+
+    const MeshLod& level = m_lods[std::clamp(lod, 0, static_cast<int>(m_lods.size()) - 1)];
+    const void* offset = reinterpret_cast<const void*>(
+        static_cast<uintptr_t>(m_geometry.firstIndex + level.indexOffset) * sizeof(unsigned int));
+
+    RenderState::getInstance().bindVertexArray(getVAO());
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT, offset,
+                                      count, m_geometry.baseVertex);
 }
 
 // Model implementation
@@ -109,6 +130,18 @@ void Model::draw() const {
     }
 }
 
+void Model::createMaterials(MaterialSystem& materials) {
+    for (auto& mesh : m_meshes) {
+        mesh->createMaterial(materials);
+    }
+}
+
+void Model::generateLods(int maxLevels, float reduction, size_t minTriangles) {
+    for (auto& mesh : m_meshes) {
+        mesh->generateLods(maxLevels, reduction, minTriangles);
+    }
+}
+
 void Model::drawInstanced(int count) const {
     for (const auto& mesh : m_meshes) {
         mesh->drawInstanced(count);
@@ -0,0 +1,403 @@
+#include "graphics/OcclusionCuller.h"
+#include "core/Logger.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ER_RASTER_SSE 1
+#endif
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// Occluders further than this are too small at 256x128 to be worth drawing
+constexpr float MAX_OCCLUDER_DISTANCE = 80.0f;
+
+// Keeps the camera from ending up inside a wall's box (which would cover
+// the whole screen at depth zero)
+constexpr float CAMERA_CLEARANCE = 0.25f;
+
+// Quads of a box whose corners are indexed by bits x=1, y=2, z=4
+constexpr int BOX_FACES[6][4] = {
+    {0, 2, 6, 4}, {1, 3, 7, 5},
+    {0, 1, 5, 4}, {2, 3, 7, 6},
+    {0, 1, 3, 2}, {4, 5, 7, 6}
+};
+
+static_assert(OcclusionCuller::WIDTH % 4 == 0, "Raster rows are processed four pixels at a time");
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller() {}
+
+OcclusionCuller::~OcclusionCuller() {
+    shutdown();
+}
+
+bool OcclusionCuller::initialize() {
+    if (m_worker.joinable()) return true;
+
+    int width = WIDTH;
+    int height = HEIGHT;
+    for (auto& level : m_levels) {
+        level.assign(static_cast<size_t>(width) * height, 1.0f);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    m_quit = false;
+    m_jobPending = false;
+    m_jobRunning = false;
+    m_hasResult = false;
+    m_worker = std::thread(&OcclusionCuller::workerLoop, this);
+
+    LOG_INFO("Occlusion culler initialized (" + std::to_string(WIDTH) + "x" +
+             std::to_string(HEIGHT) + " depth buffer)");
+    return true;
+}
+
+void OcclusionCuller::shutdown() {
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+
+    if (!m_worker.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_jobReady.notify_one();
+    m_worker.join();
+}
+
+void OcclusionCuller::setOccluders(const std::vector<Occluder>& occluders) {
+    waitForWorker();
+    m_occluders = occluders;
+    m_hasResult = false;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection, const glm::vec3& viewPosition) {
+    // A frame that never reached cull() may still be rasterizing
+    waitForWorker();
+    m_hasResult = false;
+
+    if (!m_enabled || m_occluders.empty() || !m_worker.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_viewProjection = viewProjection;
+        m_viewPosition = viewPosition;
+        m_jobPending = true;
+        m_jobRunning = true;
+    }
+    m_jobReady.notify_one();
+    m_hasResult = true;
+}
+
+size_t OcclusionCuller::cull(RenderQueue& queue) {
+    if (!m_hasResult) return 0;
+    waitForWorker();
+
+    const std::vector<uint8_t>& visibility = queue.getVisibility();
+    std::atomic<size_t> hidden{0};
+
+    // The hierarchy is read-only here and every command owns its own
+    // visibility byte, so batches can run on any thread
+    JobSystem::getInstance().parallelFor(queue.size(), 512, [&](size_t begin, size_t end) {
+        size_t batchHidden = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (!visibility[i]) continue;
+
+            const RenderCommand& cmd = queue[i];
+            if (cmd.boundsRadius < 0.0f) continue;
+
+            if (isOccluded(cmd.boundsCenter, cmd.boundsRadius)) {
+                queue.hide(i);
+                batchHidden++;
+            }
+        }
+        hidden += batchHidden;
+    });
+    return hidden;
+}
+
+GLuint OcclusionCuller::uploadHierarchy() {
+    if (!m_hasResult) return 0;
+    waitForWorker();
+
+    if (!m_texture) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+        glTextureStorage2D(m_texture, LEVEL_COUNT, GL_R32F, WIDTH, HEIGHT);
+        glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        glTextureSubImage2D(m_texture, level, 0, 0, WIDTH >> level, HEIGHT >> level,
+                            GL_RED, GL_FLOAT, m_levels[level].data());
+    }
+    return m_texture;
+}
+
+void OcclusionCuller::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_jobReady.wait(lock, [this] { return m_jobPending || m_quit; });
+        if (m_quit) break;
+        m_jobPending = false;
+
+        lock.unlock();
+        rasterizeOccluders();
+        buildHierarchy();
+        lock.lock();
+
+        m_jobRunning = false;
+        m_jobDone.notify_all();
+    }
+}
+
+void OcclusionCuller::waitForWorker() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this] { return !m_jobRunning; });
+}
+
+void OcclusionCuller::rasterizeOccluders() {
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+
+    // Rank occluders by approximate screen size: extent^2 / distance^2
+    std::vector<std::pair<float, size_t>> candidates;
+    candidates.reserve(m_occluders.size());
+
+    for (size_t i = 0; i < m_occluders.size(); i++) {
+        const Occluder& occluder = m_occluders[i];
+        glm::vec3 closest = glm::clamp(m_viewPosition, occluder.min, occluder.max);
+        float distance = glm::length(closest - m_viewPosition);
+
+        if (distance < CAMERA_CLEARANCE || distance > MAX_OCCLUDER_DISTANCE) continue;
+
+        glm::vec3 extent = occluder.max - occluder.min;
+        candidates.push_back({glm::dot(extent, extent) / (distance * distance), i});
+    }
+
+    size_t count = std::min(candidates.size(), static_cast<size_t>(MAX_OCCLUDERS_PER_FRAME));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (size_t i = 0; i < count; i++) {
+        rasterizeBox(m_occluders[candidates[i].second]);
+    }
+}
+
+void OcclusionCuller::rasterizeBox(const Occluder& occluder) {
+    glm::vec4 clip[8];
+    bool allBehind = true;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? occluder.max.x : occluder.min.x,
+                         (i & 2) ? occluder.max.y : occluder.min.y,
+                         (i & 4) ? occluder.max.z : occluder.min.z);
+        clip[i] = m_viewProjection * glm::vec4(corner, 1.0f);
+        if (clip[i].z + clip[i].w >= 0.0f) allBehind = false;
+    }
+    if (allBehind) return;
+
+    auto toScreen = [](const glm::vec4& v) {
+        float invW = 1.0f / v.w;
+        return ScreenVertex{
+            (v.x * invW * 0.5f + 0.5f) * WIDTH,
+            (v.y * invW * 0.5f + 0.5f) * HEIGHT,
+            std::max(v.z * invW * 0.5f + 0.5f, 0.0f)
+        };
+    };
+
+    for (const auto& face : BOX_FACES) {
+        const glm::vec4 triangles[2][3] = {
+            {clip[face[0]], clip[face[1]], clip[face[2]]},
+            {clip[face[0]], clip[face[2]], clip[face[3]]}
+        };
+
+        for (const auto& triangle : triangles) {
+            // Clip against the near plane (z + w >= 0); a triangle becomes
+            // at most a quad
+            glm::vec4 polygon[4];
+            int vertexCount = 0;
+            for (int i = 0; i < 3; i++) {
+                const glm::vec4& a = triangle[i];
+                const glm::vec4& b = triangle[(i + 1) % 3];
+                float da = a.z + a.w;
+                float db = b.z + b.w;
+
+                if (da >= 0.0f) polygon[vertexCount++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f)) {
+                    polygon[vertexCount++] = a + (b - a) * (da / (da - db));
+                }
+            }
+            if (vertexCount < 3) continue;
+
+            ScreenVertex v0 = toScreen(polygon[0]);
+            ScreenVertex v1 = toScreen(polygon[1]);
+            ScreenVertex v2 = toScreen(polygon[2]);
+            rasterizeTriangle(v0, v1, v2);
+            if (vertexCount == 4) {
+                rasterizeTriangle(v0, v2, toScreen(polygon[3]));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (std::abs(area) < 1e-6f) return;
+
+    // Counter-clockwise so every edge function is positive inside
+    const ScreenVertex& a = v0;
+    const ScreenVertex& b = area > 0.0f ? v1 : v2;
+    const ScreenVertex& c = area > 0.0f ? v2 : v1;
+    area = std::abs(area);
+
+    int minX = std::max(static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))), 0);
+    int maxX = std::min(static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))), WIDTH - 1);
+    int minY = std::max(static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))), 0);
+    int maxY = std::min(static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))), HEIGHT - 1);
+    if (minX > maxX || minY > maxY) return;
+    minX &= ~3;
+
+    // Edge functions E(p) = A * x + B * y + C, one per edge opposite a vertex
+    const float a0 = b.y - c.y, b0 = c.x - b.x, c0 = -a0 * b.x - b0 * b.y;
+    const float a1 = c.y - a.y, b1 = a.x - c.x, c1 = -a1 * c.x - b1 * c.y;
+    const float a2 = a.y - b.y, b2 = b.x - a.x, c2 = -a2 * a.x - b2 * a.y;
+
+    // Depth is linear in screen space: z = zA * x + zB * y + zC
+    const float invArea = 1.0f / area;
+    const float zA = (a0 * a.z + a1 * b.z + a2 * c.z) * invArea;
+    const float zB = (b0 * a.z + b1 * b.z + b2 * c.z) * invArea;
+    const float zC = (c0 * a.z + c1 * b.z + c2 * c.z) * invArea;
+
+    float* depth = m_levels[0].data();
+
+#if defined(ER_RASTER_SSE)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 ea0 = _mm_set1_ps(a0), ea1 = _mm_set1_ps(a1), ea2 = _mm_set1_ps(a2);
+    const __m128 za = _mm_set1_ps(zA);
+
+    for (int y = minY; y <= maxY; y++) {
+        const float py = static_cast<float>(y) + 0.5f;
+        const __m128 rowE0 = _mm_set1_ps(b0 * py + c0);
+        const __m128 rowE1 = _mm_set1_ps(b1 * py + c1);
+        const __m128 rowE2 = _mm_set1_ps(b2 * py + c2);
+        const __m128 rowZ = _mm_set1_ps(zB * py + zC);
+        float* row = depth + y * WIDTH;
+
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(ea0, px), rowE0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(ea1, px), rowE1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(ea2, px), rowE2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                       _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(za, px), rowZ);
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 closer = _mm_min_ps(current, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        const float py = static_cast<float>(y) + 0.5f;
+        float* row = depth + y * WIDTH;
+
+        for (int x = minX; x <= maxX; x++) {
+            const float px = static_cast<float>(x) + 0.5f;
+            if (a0 * px + b0 * py + c0 < 0.0f) continue;
+            if (a1 * px + b1 * py + c1 < 0.0f) continue;
+            if (a2 * px + b2 * py + c2 < 0.0f) continue;
+
+            row[x] = std::min(row[x], zA * px + zB * py + zC);
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::buildHierarchy() {
+    int width = WIDTH;
+    int height = HEIGHT;
+    for (int level = 1; level < LEVEL_COUNT; level++) {
+        const std::vector<float>& source = m_levels[level - 1];
+        std::vector<float>& target = m_levels[level];
+        const int targetWidth = width / 2;
+        const int targetHeight = height / 2;
+
+        for (int y = 0; y < targetHeight; y++) {
+            const float* row0 = source.data() + (y * 2) * width;
+            const float* row1 = row0 + width;
+            for (int x = 0; x < targetWidth; x++) {
+                target[y * targetWidth + x] = std::max(std::max(row0[x * 2], row0[x * 2 + 1]),
+                                                       std::max(row1[x * 2], row1[x * 2 + 1]));
+            }
+        }
+
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
+
+bool OcclusionCuller::isOccluded(const glm::vec3& center, float radius) const {
+    // Screen rectangle and nearest depth of the sphere's bounding box. For
+    // a perspective projection the nearest corner is at least as close as
+    // the nearest point on the sphere, so this stays conservative.
+    float minX = static_cast<float>(WIDTH), minY = static_cast<float>(HEIGHT);
+    float maxX = 0.0f, maxY = 0.0f;
+    float nearest = 1.0f;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = center + glm::vec3((i & 1) ? radius : -radius,
+                                              (i & 2) ? radius : -radius,
+                                              (i & 4) ? radius : -radius);
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.z + clip.w < 0.0f || clip.w <= 0.0f) return false;
+
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * WIDTH;
+        float y = (clip.y * invW * 0.5f + 0.5f) * HEIGHT;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int x1 = std::min(static_cast<int>(std::floor(maxX)), WIDTH - 1);
+    int y1 = std::min(static_cast<int>(std::floor(maxY)), HEIGHT - 1);
+    if (x0 > x1 || y0 > y1) return false;
+
+    // Coarsest level at which the rectangle spans at most two texels a side
+    int level = 0;
+    int extent = std::max(x1 - x0, y1 - y0);
+    while (extent > 1 && level < LEVEL_COUNT - 1) {
+        extent >>= 1;
+        level++;
+    }
+
+    const std::vector<float>& depth = m_levels[level];
+    const int levelWidth = WIDTH >> level;
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (depth[y * levelWidth + x] >= nearest) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace ExperimentRedbear
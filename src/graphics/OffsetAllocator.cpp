@@ -0,0 +1,259 @@
+#include "graphics/OffsetAllocator.h"
+#include <algorithm>
+#include <iterator>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// Bins per power of two
+constexpr uint32_t SUB_BIN_BITS = 3;
+constexpr uint32_t SUB_BINS = 1u << SUB_BIN_BITS;
+
+uint32_t highestBit(uint32_t value) {
+    uint32_t bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+}
+
+uint32_t lowestBit(uint64_t value) {
+    uint32_t bit = 0;
+    while (!(value & 1u)) {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+} // namespace
+
+OffsetAllocator::OffsetAllocator() {
+    reset(0);
+}
+
+OffsetAllocator::~OffsetAllocator() = default;
+
+uint32_t OffsetAllocator::binForSize(uint32_t size) {
+    // Sizes below SUB_BINS get a bin each, above that every power of two
+    // is split into SUB_BINS equal steps
+    if (size < SUB_BINS) return size;
+    const uint32_t top = highestBit(size);
+    const uint32_t sub = (size >> (top - SUB_BIN_BITS)) & (SUB_BINS - 1);
+    return (top - SUB_BIN_BITS + 1) * SUB_BINS + sub;
+}
+
+uint32_t OffsetAllocator::binMinimum(uint32_t bin) {
+    if (bin < SUB_BINS) return bin;
+    const uint32_t top = bin / SUB_BINS + SUB_BIN_BITS - 1;
+    const uint32_t sub = bin % SUB_BINS;
+    return (SUB_BINS + sub) << (top - SUB_BIN_BITS);
+}
+
+uint32_t OffsetAllocator::findBin(uint32_t bin) const {
+    for (uint32_t word = bin / 64; word < BIN_COUNT / 64; word++) {
+        uint64_t bits = m_binBits[word];
+        if (word == bin / 64) {
+            bits &= ~0ull << (bin % 64);
+        }
+        if (bits) {
+            return word * 64 + lowestBit(bits);
+        }
+    }
+    return NONE;
+}
+
+void OffsetAllocator::reset(uint32_t size) {
+    m_nodes.clear();
+    m_spareNodes.clear();
+    std::fill(std::begin(m_binHeads), std::end(m_binHeads), NONE);
+    std::fill(std::begin(m_binBits), std::end(m_binBits), 0);
+    m_lastNode = NONE;
+    m_size = size;
+    m_freeSize = 0;
+
+    if (size > 0) {
+        uint32_t node = createNode();
+        m_nodes[node].offset = 0;
+        m_nodes[node].size = size;
+        m_lastNode = node;
+        insertFree(node);
+    }
+}
+
+uint32_t OffsetAllocator::createNode() {
+    if (!m_spareNodes.empty()) {
+        uint32_t node = m_spareNodes.back();
+        m_spareNodes.pop_back();
+        m_nodes[node] = Node();
+        return node;
+    }
+    m_nodes.emplace_back();
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void OffsetAllocator::releaseNode(uint32_t node) {
+    m_spareNodes.push_back(node);
+}
+
+void OffsetAllocator::insertFree(uint32_t node) {
+    Node& n = m_nodes[node];
+    const uint32_t bin = binForSize(n.size);
+
+    n.used = false;
+    n.prevFree = NONE;
+    n.nextFree = m_binHeads[bin];
+    if (n.nextFree != NONE) {
+        m_nodes[n.nextFree].prevFree = node;
+    }
+    m_binHeads[bin] = node;
+    m_binBits[bin / 64] |= 1ull << (bin % 64);
+    m_freeSize += n.size;
+}
+
+void OffsetAllocator::removeFree(uint32_t node) {
+    Node& n = m_nodes[node];
+    const uint32_t bin = binForSize(n.size);
+
+    if (n.prevFree != NONE) {
+        m_nodes[n.prevFree].nextFree = n.nextFree;
+    } else {
+        m_binHeads[bin] = n.nextFree;
+        if (n.nextFree == NONE) {
+            m_binBits[bin / 64] &= ~(1ull << (bin % 64));
+        }
+    }
+    if (n.nextFree != NONE) {
+        m_nodes[n.nextFree].prevFree = n.prevFree;
+    }
+    n.prevFree = NONE;
+    n.nextFree = NONE;
+    m_freeSize -= n.size;
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+    Allocation allocation;
+    if (size == 0) return allocation;
+
+    // Start at the first bin whose every block is large enough. Failing
+    // that, the size's own bin may still hold one that fits.
+    const uint32_t sizeBin = binForSize(size);
+    const uint32_t fitBin = binMinimum(sizeBin) < size ? sizeBin + 1 : sizeBin;
+
+    uint32_t node = NONE;
+    const uint32_t bin = fitBin < BIN_COUNT ? findBin(fitBin) : NONE;
+    if (bin != NONE) {
+        node = m_binHeads[bin];
+    } else if (fitBin != sizeBin) {
+        for (uint32_t candidate = m_binHeads[sizeBin]; candidate != NONE; candidate = m_nodes[candidate].nextFree) {
+            if (m_nodes[candidate].size >= size) {
+                node = candidate;
+                break;
+            }
+        }
+    }
+    if (node == NONE) return allocation;
+
+    removeFree(node);
+    m_nodes[node].used = true;
+
+    // The rest of the block goes back as a free block right after it
+    if (m_nodes[node].size > size) {
+        const uint32_t rest = createNode();
+        Node& n = m_nodes[node];
+        Node& r = m_nodes[rest];
+        r.offset = n.offset + size;
+        r.size = n.size - size;
+        r.prevPhysical = node;
+        r.nextPhysical = n.nextPhysical;
+        if (n.nextPhysical != NONE) {
+            m_nodes[n.nextPhysical].prevPhysical = rest;
+        } else {
+            m_lastNode = rest;
+        }
+        n.nextPhysical = rest;
+        n.size = size;
+        insertFree(rest);
+    }
+
+    allocation.offset = m_nodes[node].offset;
+    allocation.node = node;
+    return allocation;
+}
+
+void OffsetAllocator::free(const Allocation& allocation) {
+    if (!allocation.isValid() || allocation.node >= m_nodes.size()) return;
+
+    uint32_t node = allocation.node;
+    if (!m_nodes[node].used) return;
+    m_nodes[node].used = false;
+
+    // Merge with the free neighbours on either side
+    const uint32_t previous = m_nodes[node].prevPhysical;
+    if (previous != NONE && !m_nodes[previous].used) {
+        removeFree(previous);
+        Node& p = m_nodes[previous];
+        p.size += m_nodes[node].size;
+        p.nextPhysical = m_nodes[node].nextPhysical;
+        if (p.nextPhysical != NONE) {
+            m_nodes[p.nextPhysical].prevPhysical = previous;
+        } else {
+            m_lastNode = previous;
+        }
+        releaseNode(node);
+        node = previous;
+    }
+
+    const uint32_t next = m_nodes[node].nextPhysical;
+    if (next != NONE && !m_nodes[next].used) {
+        removeFree(next);
+        Node& n = m_nodes[node];
+        n.size += m_nodes[next].size;
+        n.nextPhysical = m_nodes[next].nextPhysical;
+        if (n.nextPhysical != NONE) {
+            m_nodes[n.nextPhysical].prevPhysical = node;
+        } else {
+            m_lastNode = node;
+        }
+        releaseNode(next);
+    }
+
+    insertFree(node);
+}
+
+void OffsetAllocator::grow(uint32_t newSize) {
+    if (newSize <= m_size) return;
+    const uint32_t added = newSize - m_size;
+
+    if (m_lastNode != NONE && !m_nodes[m_lastNode].used) {
+        removeFree(m_lastNode);
+        m_nodes[m_lastNode].size += added;
+        insertFree(m_lastNode);
+    } else {
+        const uint32_t node = createNode();
+        m_nodes[node].offset = m_size;
+        m_nodes[node].size = added;
+        m_nodes[node].prevPhysical = m_lastNode;
+        if (m_lastNode != NONE) {
+            m_nodes[m_lastNode].nextPhysical = node;
+        }
+        m_lastNode = node;
+        insertFree(node);
+    }
+    m_size = newSize;
+}
+
+uint32_t OffsetAllocator::getLargestFreeBlock() const {
+    for (uint32_t bin = BIN_COUNT; bin-- > 0;) {
+        if (!(m_binBits[bin / 64] & (1ull << (bin % 64)))) continue;
+
+        // Blocks within a bin differ in size, so check them all
+        uint32_t largest = 0;
+        for (uint32_t node = m_binHeads[bin]; node != NONE; node = m_nodes[node].nextFree) {
+            largest = std::max(largest, m_nodes[node].size);
+        }
+        return largest;
+    }
+    return 0;
+}
+
+} // namespace ExperimentRedbear
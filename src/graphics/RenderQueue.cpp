@@ -0,0 +1,261 @@
+#include "graphics/RenderQueue.h"
+#include "graphics/Shader.h"
+#include "graphics/Camera.h"
+#include "graphics/MeshSimplifier.h"
+#include "core/JobSystem.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ER_CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ER_CULL_SSE 1
+#endif
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// Unbounded commands get a radius no plane distance can beat
+constexpr float UNBOUNDED_RADIUS = std::numeric_limits<float>::max();
+
+#if defined(ER_CULL_AVX)
+constexpr size_t CULL_BATCH = 8;
+#elif defined(ER_CULL_SSE)
+constexpr size_t CULL_BATCH = 4;
+#else
+constexpr size_t CULL_BATCH = 1;
+#endif
+
+// Commands per job when culling in parallel (a multiple of every CULL_BATCH)
+constexpr size_t PARALLEL_CULL_BATCH = 2048;
+
+// Commands per job when selecting LODs
+constexpr size_t PARALLEL_LOD_BATCH = 1024;
+
+// Sphere vs six planes for [begin, end), which is a multiple of CULL_BATCH
+void cullSpheres(const glm::vec4 planes[6], const float* cxs, const float* cys, const float* czs,
+                 const float* rs, uint8_t* out, size_t begin, size_t end) {
+#if defined(ER_CULL_AVX)
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = begin; i < end; i += 8) {
+        __m256 cx = _mm256_loadu_ps(cxs + i);
+        __m256 cy = _mm256_loadu_ps(cys + i);
+        __m256 cz = _mm256_loadu_ps(czs + i);
+        __m256 r = _mm256_loadu_ps(rs + i);
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+        for (int p = 0; p < 6; p++) {
+            __m256 d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(planes[p].x)),
+                              _mm256_mul_ps(cy, _mm256_set1_ps(planes[p].y))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(planes[p].z)),
+                              _mm256_set1_ps(planes[p].w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; k++) {
+            out[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+        }
+    }
+#elif defined(ER_CULL_SSE)
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = begin; i < end; i += 4) {
+        __m128 cx = _mm_loadu_ps(cxs + i);
+        __m128 cy = _mm_loadu_ps(cys + i);
+        __m128 cz = _mm_loadu_ps(czs + i);
+        __m128 r = _mm_loadu_ps(rs + i);
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)),
+                           _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)),
+                           _mm_set1_ps(planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        out[i + 0] = static_cast<uint8_t>(mask & 1);
+        out[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+        out[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+        out[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+    }
+#else
+    for (size_t i = begin; i < end; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            float d = cxs[i] * planes[p].x + cys[i] * planes[p].y + czs[i] * planes[p].z + planes[p].w;
+            inside = d + rs[i] >= 0.0f;
+        }
+        out[i] = inside ? 1 : 0;
+    }
+#endif
+}
+
+} // namespace
+
+RenderQueue::RenderQueue() {}
+
+RenderQueue::~RenderQueue() = default;
+
+uint64_t RenderQueue::makeSortKey(const RenderCommand& command, float depth) {
+    // GL object names are small sequential integers, so the low bits are
+    // enough to tell them apart. A collision only costs a redundant bind.
+    const uint64_t pass = command.pass & 0xFu;
+    const uint64_t shader = command.shader ? (command.shader->getID() & 0xFFFu) : 0u;
+    // Material-system draws share their texture state, so they batch by
+    // material index instead; the top bit keeps them apart from textures
+    const uint64_t material = command.materialIndex != 0xFFFFFFFFu
+        ? (0x8000u | (command.materialIndex & 0x7FFFu))
+        : (command.textureID & 0x7FFFu);
+    const uint64_t quantized = static_cast<uint64_t>(
+        std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(0xFFFFFF)) & 0xFFFFFFu;
+
+    if (command.transparent) {
+        return (pass << 60) | (1ull << 59) | ((0xFFFFFFu - quantized) << 28) |
+               (shader << 16) | material;
+    }
+    return (pass << 60) | (shader << 40) | (material << 24) | quantized;
+}
+
+void RenderQueue::push(const RenderCommand& command, uint64_t sortKey) {
+    m_commands.push_back(command);
+    m_sortKeys.push_back(sortKey);
+    m_centerX.push_back(command.boundsCenter.x);
+    m_centerY.push_back(command.boundsCenter.y);
+    m_centerZ.push_back(command.boundsCenter.z);
+    m_radius.push_back(command.boundsRadius < 0.0f ? UNBOUNDED_RADIUS : command.boundsRadius);
+}
+
+void RenderQueue::clear() {
+    m_commands.clear();
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_radius.clear();
+    m_visibility.clear();
+    m_lodLevels.clear();
+    m_sortKeys.clear();
+    m_order.clear();
+}
+
+void RenderQueue::append(const RenderQueue& other) {
+    const size_t count = other.m_commands.size();
+    m_commands.insert(m_commands.end(), other.m_commands.begin(), other.m_commands.end());
+    m_sortKeys.insert(m_sortKeys.end(), other.m_sortKeys.begin(), other.m_sortKeys.end());
+    m_centerX.insert(m_centerX.end(), other.m_centerX.begin(), other.m_centerX.begin() + count);
+    m_centerY.insert(m_centerY.end(), other.m_centerY.begin(), other.m_centerY.begin() + count);
+    m_centerZ.insert(m_centerZ.end(), other.m_centerZ.begin(), other.m_centerZ.begin() + count);
+    m_radius.insert(m_radius.end(), other.m_radius.begin(), other.m_radius.begin() + count);
+}
+
+size_t RenderQueue::cull(const glm::vec4 planes[6]) {
+    const size_t count = m_commands.size();
+
+    // Pad to the batch width with always-visible entries
+    const size_t padded = (count + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+    m_centerX.resize(padded, 0.0f);
+    m_centerY.resize(padded, 0.0f);
+    m_centerZ.resize(padded, 0.0f);
+    m_radius.resize(padded, UNBOUNDED_RADIUS);
+    m_visibility.resize(padded);
+
+    const float* cxs = m_centerX.data();
+    const float* cys = m_centerY.data();
+    const float* czs = m_centerZ.data();
+    const float* rs = m_radius.data();
+    uint8_t* out = m_visibility.data();
+
+    // Large queues are split across the job system in whole SIMD batches
+    JobSystem::getInstance().parallelFor(padded, PARALLEL_CULL_BATCH, [&](size_t begin, size_t end) {
+        cullSpheres(planes, cxs, cys, czs, rs, out, begin, end);
+    });
+
+    // Drop the padding so later pushes stay in step with m_commands
+    m_centerX.resize(count);
+    m_centerY.resize(count);
+    m_centerZ.resize(count);
+    m_radius.resize(count);
+    m_visibility.resize(count);
+
+    size_t visible = 0;
+    for (size_t i = 0; i < count; i++) {
+        visible += out[i];
+    }
+    return visible;
+}
+
+void RenderQueue::selectLods(const Camera& camera, float viewportHeight) {
+    const size_t count = m_commands.size();
+    m_lodLevels.assign(count, 0);
+
+    JobSystem::getInstance().parallelFor(count, PARALLEL_LOD_BATCH, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const RenderCommand& command = m_commands[i];
+            if (command.lodCount < 2 || command.boundsRadius < 0.0f) continue;
+            if (i < m_visibility.size() && !m_visibility[i]) continue;
+
+            int current = command.lodState ? *command.lodState : 0;
+            float screenSize = camera.getScreenSize(command.boundsCenter, command.boundsRadius, viewportHeight);
+            int level = MeshSimplifier::selectLod(command.lods, command.lodCount, screenSize, current);
+
+            m_lodLevels[i] = static_cast<uint8_t>(level);
+            if (command.lodState) *command.lodState = static_cast<uint8_t>(level);
+        }
+    });
+}
+
+const std::vector<uint32_t>& RenderQueue::sortVisible() {
+    m_order.clear();
+    m_keys.clear();
+    for (size_t i = 0; i < m_commands.size(); i++) {
+        if (m_visibility.size() <= i || m_visibility[i]) {
+            m_order.push_back(static_cast<uint32_t>(i));
+            m_keys.push_back(m_sortKeys[i]);
+        }
+    }
+
+    const size_t count = m_order.size();
+    if (count < 2) return m_order;
+
+    m_orderScratch.resize(count);
+    m_keysScratch.resize(count);
+
+    // LSD radix sort, 8 bits per pass. Stable, so equal keys keep their
+    // submission order and the result is deterministic.
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; i++) {
+            offsets[(m_keys[i] >> shift) & 0xFF]++;
+        }
+
+        // Every key shares this digit, nothing to reorder
+        if (offsets[(m_keys[0] >> shift) & 0xFF] == count) continue;
+
+        size_t sum = 0;
+        for (size_t& offset : offsets) {
+            size_t bucket = offset;
+            offset = sum;
+            sum += bucket;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            size_t dst = offsets[(m_keys[i] >> shift) & 0xFF]++;
+            m_keysScratch[dst] = m_keys[i];
+            m_orderScratch[dst] = m_order[i];
+        }
+
+        m_keys.swap(m_keysScratch);
+        m_order.swap(m_orderScratch);
+    }
+
+    return m_order;
+}
+
+} // namespace ExperimentRedbear
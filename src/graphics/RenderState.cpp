@@ -0,0 +1,189 @@
+#include "graphics/RenderState.h"
+#include <algorithm>
+#include <iterator>
+
+namespace ExperimentRedbear {
+
+RenderState& RenderState::getInstance() {
+    static RenderState instance;
+    return instance;
+}
+
+RenderState::RenderState() {
+    invalidate();
+}
+
+RenderState::~RenderState() = default;
+
+void RenderState::invalidate() {
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    std::fill(std::begin(m_buffers), std::end(m_buffers), UNKNOWN);
+    std::fill(std::begin(m_uniformBuffers), std::end(m_uniformBuffers), BufferRange());
+    std::fill(std::begin(m_storageBuffers), std::end(m_storageBuffers), BufferRange());
+    std::fill(std::begin(m_textures), std::end(m_textures), UNKNOWN);
+    std::fill(std::begin(m_samplers), std::end(m_samplers), UNKNOWN);
+    std::fill(std::begin(m_capabilities), std::end(m_capabilities), UNKNOWN);
+    m_blendSource = UNKNOWN;
+    m_blendDestination = UNKNOWN;
+    m_depthFunc = UNKNOWN;
+    m_depthMask = UNKNOWN;
+    m_cullFace = UNKNOWN;
+}
+
+void RenderState::resetCounters() {
+    m_issued = 0;
+    m_elided = 0;
+}
+
+bool RenderState::matches(GLuint& tracked, GLuint value) {
+    if (tracked == value) {
+        m_elided++;
+        return true;
+    }
+    tracked = value;
+    m_issued++;
+    return false;
+}
+
+void RenderState::useProgram(GLuint program) {
+    if (!matches(m_program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void RenderState::bindVertexArray(GLuint vao) {
+    if (!matches(m_vertexArray, vao)) {
+        glBindVertexArray(vao);
+    }
+}
+
+void RenderState::bindBuffer(GLenum target, GLuint buffer) {
+    GLuint* tracked = nullptr;
+    switch (target) {
+        case GL_ARRAY_BUFFER: tracked = &m_buffers[BUFFER_ARRAY]; break;
+        case GL_DRAW_INDIRECT_BUFFER: tracked = &m_buffers[BUFFER_DRAW_INDIRECT]; break;
+        case GL_DISPATCH_INDIRECT_BUFFER: tracked = &m_buffers[BUFFER_DISPATCH_INDIRECT]; break;
+        case GL_PARAMETER_BUFFER: tracked = &m_buffers[BUFFER_PARAMETER]; break;
+        default: break;
+    }
+
+    if (!tracked) {
+        m_issued++;
+        glBindBuffer(target, buffer);
+    } else if (!matches(*tracked, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+RenderState::BufferRange* RenderState::findIndexed(GLenum target, GLuint index) {
+    if (index >= MAX_BUFFER_BINDINGS) return nullptr;
+    if (target == GL_UNIFORM_BUFFER) return &m_uniformBuffers[index];
+    if (target == GL_SHADER_STORAGE_BUFFER) return &m_storageBuffers[index];
+    return nullptr;
+}
+
+void RenderState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    BufferRange* tracked = findIndexed(target, index);
+    if (tracked && tracked->buffer == buffer && tracked->size == 0) {
+        m_elided++;
+        return;
+    }
+
+    if (tracked) {
+        tracked->buffer = buffer;
+        tracked->offset = 0;
+        tracked->size = 0;
+    }
+    m_issued++;
+    glBindBufferBase(target, index, buffer);
+}
+
+void RenderState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    BufferRange* tracked = findIndexed(target, index);
+    if (tracked && tracked->buffer == buffer && tracked->offset == offset && tracked->size == size) {
+        m_elided++;
+        return;
+    }
+
+    if (tracked) {
+        tracked->buffer = buffer;
+        tracked->offset = offset;
+        tracked->size = size;
+    }
+    m_issued++;
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void RenderState::bindTexture(GLuint unit, GLuint texture) {
+    if (unit >= MAX_TEXTURE_UNITS) {
+        m_issued++;
+        glBindTextureUnit(unit, texture);
+    } else if (!matches(m_textures[unit], texture)) {
+        glBindTextureUnit(unit, texture);
+    }
+}
+
+void RenderState::bindSampler(GLuint unit, GLuint sampler) {
+    if (unit >= MAX_TEXTURE_UNITS) {
+        m_issued++;
+        glBindSampler(unit, sampler);
+    } else if (!matches(m_samplers[unit], sampler)) {
+        glBindSampler(unit, sampler);
+    }
+}
+
+void RenderState::setEnabled(GLenum capability, bool enabled) {
+    int index = -1;
+    switch (capability) {
+        case GL_BLEND: index = CAP_BLEND; break;
+        case GL_DEPTH_TEST: index = CAP_DEPTH_TEST; break;
+        case GL_CULL_FACE: index = CAP_CULL_FACE; break;
+        case GL_SCISSOR_TEST: index = CAP_SCISSOR_TEST; break;
+        case GL_POLYGON_OFFSET_FILL: index = CAP_POLYGON_OFFSET_FILL; break;
+        default: break;
+    }
+
+    if (index < 0) {
+        m_issued++;
+    } else if (matches(m_capabilities[index], enabled ? 1u : 0u)) {
+        return;
+    }
+
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void RenderState::blendFunc(GLenum source, GLenum destination) {
+    if (m_blendSource == source && m_blendDestination == destination) {
+        m_elided++;
+        return;
+    }
+    m_blendSource = source;
+    m_blendDestination = destination;
+    m_issued++;
+    glBlendFunc(source, destination);
+}
+
+void RenderState::depthFunc(GLenum func) {
+    if (!matches(m_depthFunc, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void RenderState::depthMask(bool write) {
+    if (!matches(m_depthMask, write ? 1u : 0u)) {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void RenderState::cullFace(GLenum face) {
+    if (!matches(m_cullFace, face)) {
+        glCullFace(face);
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -1,13 +1,40 @@
 #include "graphics/Renderer.h"
+#include "graphics/RenderState.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/GeometryBuffer.h"
 #include "graphics/Shader.h"
+#include "graphics/MeshSimplifier.h"
 #include "core/Logger.h"
 #include "core/Config.h"
+#include "core/JobSystem.h"
 #include <GL/glew.h>
 #include <sstream>
 #include <algorithm>
+#include <cstddef>
 
 namespace ExperimentRedbear {
 
+namespace {
+
+// Geometry buffers are packed once this much of their free space is
+// scattered outside the largest free block
+constexpr float GEOMETRY_COMPACT_THRESHOLD = 0.5f;
+
+// Post-process uniforms
+constexpr UniformID SCREEN_TEXTURE("screenTexture");
+constexpr UniformID BLOOM_TEXTURE("bloomTexture");
+constexpr UniformID UV_SCALE("uvScale");
+constexpr UniformID BLOOM_INTENSITY("bloomIntensity");
+constexpr UniformID VIGNETTE_INTENSITY("vignetteIntensity");
+constexpr UniformID SATURATION("saturation");
+constexpr UniformID CONTRAST("contrast");
+constexpr UniformID BRIGHTNESS("brightness");
+constexpr UniformID ENABLE_VIGNETTE("enableVignette");
+constexpr UniformID ENABLE_FILM_GRAIN("enableFilmGrain");
+constexpr UniformID TIME("time");
+
+} // namespace
+
 Renderer& Renderer::getInstance() {
     static Renderer instance;
     return instance;
@@ -16,6 +43,8 @@ Renderer& Renderer::getInstance() {
 bool Renderer::initialize(int width, int height) {
     m_width = width;
     m_height = height;
+    m_renderWidth = width;
+    m_renderHeight = height;
 
     // Enable features
     glEnable(GL_DEPTH_TEST);
@@ -34,7 +63,17 @@ bool Renderer::initialize(int width, int height) {
     glClearColor(m_settings.clearColor.r, m_settings.clearColor.g, 
                  m_settings.clearColor.b, m_settings.clearColor.a);
 
-    // Set up default shaders
+    m_profiler.initialize();
+    m_threadBuckets.resize(JobSystem::getInstance().getThreadCount());
+    m_occlusionCuller.initialize();
+    m_materials.initialize();
+    m_impostors.initialize();
+    m_forestRenderer.initialize();
+    m_terrain.initialize();
+
+    // Set up shared uniform blocks and default shaders
+    setupUniformBuffers();
+    setupShadows();
     setupDefaultShaders();
     setupPostProcessing();
 
@@ -66,8 +105,25 @@ void Renderer::shutdown() {
         m_quadVBO = 0;
     }
 
+    m_bloom.shutdown();
+    StreamBuffer::getInstance().shutdown();
+    GeometryBuffer::shutdownAll();
+    m_lightGrid.shutdown();
+    m_shadowAtlas.shutdown();
+    m_cascadedShadows.shutdown();
+    m_profiler.shutdown();
+    m_occlusionCuller.shutdown();
+    m_materials.shutdown();
+    m_impostors.shutdown();
+    m_forestRenderer.shutdown();
+    m_terrain.shutdown();
+
     m_mainShader.reset();
     m_shadowShader.reset();
+    m_treeShader.reset();
+    m_indirectShader.reset();
+    m_treeShadowShader.reset();
+    m_terrainShader.reset();
     m_postProcessShader.reset();
     m_skyShader.reset();
     m_particleShader.reset();
@@ -78,23 +134,80 @@ void Renderer::shutdown() {
 
 void Renderer::beginFrame() {
     resetStats();
+    m_forestRenderer.setGpuCulling(m_settings.gpuTreeCulling);
+
+    // Retiring a grown stream buffer and compacting geometry delete
+    // buffers, so both go before the state cache is reset
+    auto& stream = StreamBuffer::getInstance();
+    stream.beginFrame();
+    GeometryBuffer::compactFragmented(GEOMETRY_COMPACT_THRESHOLD);
+    m_stats.streamKilobytes = static_cast<int>(stream.getLastFrameUsage() / 1024);
+    m_stats.streamStalled = stream.hasStalled();
+
+    // Last frame's state cache counters, UI and text included. Setup code
+    // between frames binds directly, so the cache starts over from the
+    // scene's base state.
+    auto& state = RenderState::getInstance();
+    m_stats.stateChangesIssued = state.getIssuedCount();
+    m_stats.stateChangesElided = state.getElidedCount();
+    state.resetCounters();
+    state.invalidate();
+    state.setEnabled(GL_DEPTH_TEST, m_settings.depthTest);
+    state.depthFunc(GL_LEQUAL);
+    state.depthMask(true);
+    state.setEnabled(GL_CULL_FACE, m_settings.faceCulling);
+    state.cullFace(GL_BACK);
+    // Blending stays off until flush reaches the transparent commands
+    state.disable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Publish last frame's CPU times and the newest resolved GPU times
+    m_profiler.beginFrame();
+    m_stats.cpuTime = m_profiler.getCpuFrameTime();
+    m_stats.gpuTime = m_profiler.getGpuFrameTime();
+    for (int i = 0; i < GPU_PASS_COUNT; i++) {
+        m_stats.passCpuTime[i] = m_profiler.getCpuTime(static_cast<GpuPass>(i));
+        m_stats.passGpuTime[i] = m_profiler.getGpuTime(static_cast<GpuPass>(i));
+    }
+    m_stats.pipeline = m_profiler.getPipelineStatistics();
+
+    m_profiler.beginPass(GpuPass::SCENE);
     clear();
 
     if (m_camera) {
         m_camera->update();
     }
 
-    // Begin rendering to post-processing framebuffer
-    if (m_settings.bloom) {
+    // Resolution for this frame from the newest resolved GPU times
+    float scale = 1.0f;
+    if (m_settings.dynamicResolution) {
+        scale = m_dynamicResolution.update(m_stats.gpuTime, m_stats.passGpuTime[static_cast<int>(GpuPass::SCENE)],
+                                           m_settings.targetFrameTime, m_settings.minResolutionScale,
+                                           std::min(m_settings.maxResolutionScale, 1.0f));
+    } else {
+        m_dynamicResolution.reset();
+    }
+    m_renderWidth = std::max(static_cast<int>(m_width * scale + 0.5f), 1);
+    m_renderHeight = std::max(static_cast<int>(m_height * scale + 0.5f), 1);
+    m_stats.resolutionScale = scale;
+
+    // Begin rendering to post-processing framebuffer. The scene only fills
+    // the render size; the target stays at window size.
+    m_offscreen = m_settings.bloom || m_settings.dynamicResolution;
+    if (m_offscreen) {
         glBindFramebuffer(GL_FRAMEBUFFER, m_postFBO);
-        glViewport(0, 0, m_width, m_height);
+        glViewport(0, 0, m_renderWidth, m_renderHeight);
         clear();
     }
 }
 
 void Renderer::endFrame() {
-    if (m_settings.bloom) {
+    m_profiler.endPass(GpuPass::SCENE);
+
+    if (m_offscreen) {
+        m_profiler.beginPass(GpuPass::POST_PROCESS);
         renderPostProcessing();
+        m_profiler.endPass(GpuPass::POST_PROCESS);
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -118,96 +231,297 @@ void Renderer::setCamera(Camera* camera) {
 }
 
 void Renderer::submit(const RenderCommand& command) {
-    m_commandQueue.push_back(command);
+    // View depth of the command's bounds (or origin), normalised to the far plane
+    float depth = 0.0f;
+    if (m_camera) {
+        glm::vec3 center = command.boundsRadius >= 0.0f ?
+            command.boundsCenter : glm::vec3(command.modelMatrix[3]);
+        depth = glm::dot(center - m_camera->getPosition(), m_camera->getForward()) /
+                m_camera->getFarPlane();
+    }
+
+    uint64_t key = RenderQueue::makeSortKey(command, depth);
+
+    // The main thread records straight into the queue, workers into their
+    // own bucket, so no locking is needed
+    int thread = JobSystem::getThreadIndex();
+    if (thread == 0) {
+        m_commandQueue.push(command, key);
+    } else {
+        m_threadBuckets[thread].push(command, key);
+    }
 }
 
 void Renderer::flush() {
     if (!m_camera || !m_mainShader) return;
 
-    m_mainShader->bind();
-    m_mainShader->setMat4("view", m_camera->getViewMatrix());
-    m_mainShader->setMat4("projection", m_camera->getProjectionMatrix());
-    m_mainShader->setVec3("viewPos", m_camera->getPosition());
-
-    // Set fog
-    if (m_settings.fog) {
-        m_mainShader->setBool("fogEnabled", true);
-        m_mainShader->setVec3("fogColor", m_settings.fogColor);
-        m_mainShader->setFloat("fogNear", m_settings.fogNear);
-        m_mainShader->setFloat("fogFar", m_settings.fogFar);
-    } else {
-        m_mainShader->setBool("fogEnabled", false);
+    // Merge the worker buckets. Commands keep their sort keys, so bucket
+    // order doesn't matter.
+    for (auto& bucket : m_threadBuckets) {
+        if (bucket.empty()) continue;
+        m_commandQueue.append(bucket);
+        bucket.clear();
     }
 
-    // Set ambient light
-    m_mainShader->setVec3("ambientColor", m_ambientColor * m_ambientIntensity);
+    // Render stale shadow atlas tiles (uses the queue's cull pass, so it
+    // has to run before the main view is culled)
+    // Occluders rasterize on the worker thread while shadows render
+    m_occlusionCuller.beginFrame(m_camera->getViewProjectionMatrix(), m_camera->getPosition());
+
+    float lightDistance = m_settings.fog ? m_settings.fogFar : m_camera->getFarPlane();
+    int cascadedLight = -1;
+
+    if (m_shadowShader) {
+        // Instanced trees are not in the queue and cull themselves per view
+        ShadowCasterCallback treeCasters;
+        if (m_treeShadowShader && m_forestRenderer.getInstanceCount() > 0) {
+            treeCasters = [this](const glm::mat4& viewProjection, const glm::vec4 planes[6]) {
+                m_treeShadowShader->bind();
+                m_treeShadowShader->setMat4(UniformName::LIGHT_VIEW_PROJECTION, viewProjection);
+                m_forestRenderer.drawShadows(*m_treeShadowShader, planes, m_stats);
+            };
+        }
+
+        m_profiler.beginPass(GpuPass::SHADOWS);
+        m_shadowAtlas.update(*m_camera, m_lights, m_commandQueue, *m_shadowShader, m_stats, treeCasters);
 
-    // Set lights
-    int numLights = glm::min(static_cast<int>(m_lights.size()), 16);
-    m_mainShader->setInt("numLights", numLights);
+        float shadowDistance = std::min(Config::getInstance().graphics.renderDistance, lightDistance);
+        cascadedLight = m_cascadedShadows.update(*m_camera, m_lights, shadowDistance,
+                                                 m_commandQueue, *m_shadowShader, m_stats, treeCasters);
+        m_profiler.endPass(GpuPass::SHADOWS);
+    }
 
-    for (int i = 0; i < numLights; i++) {
-        std::string prefix = "lights[" + std::to_string(i) + "].";
-        const Light& light = m_lights[i];
+    // Per light shadow source: atlas tiles for local lights, the cascades
+    // for the moonlight
+    m_lightShadows = m_shadowAtlas.getLightTiles();
+    if (cascadedLight >= 0 && cascadedLight < static_cast<int>(m_lightShadows.size())) {
+        m_lightShadows[cascadedLight] = 0;
+    }
 
-        m_mainShader->setInt(prefix + "type", static_cast<int>(light.type));
-        m_mainShader->setVec3(prefix + "position", light.position);
-        m_mainShader->setVec3(prefix + "direction", light.direction);
-        m_mainShader->setVec3(prefix + "color", light.color * light.intensity);
-        m_mainShader->setFloat(prefix + "range", light.range);
-        m_mainShader->setFloat(prefix + "constant", light.constant);
-        m_mainShader->setFloat(prefix + "linear", light.linear);
-        m_mainShader->setFloat(prefix + "quadratic", light.quadratic);
-        m_mainShader->setFloat(prefix + "innerCutoff", glm::cos(glm::radians(light.innerConeAngle)));
-        m_mainShader->setFloat(prefix + "outerCutoff", glm::cos(glm::radians(light.outerConeAngle)));
+    // Assign lights to clusters, then write the frame constants that
+    // describe the cluster grid
+    m_lightGrid.build(*m_camera, m_lights, m_renderWidth, m_renderHeight, lightDistance, m_lightShadows);
+    uploadFrameConstants();
+
+    // Frustum cull the whole queue before sorting. Nothing past the fog
+    // distance can show, so the far plane is pulled in to fogFar.
+    glm::vec4 planes[6];
+    std::copy(m_camera->getFrustumPlanes(), m_camera->getFrustumPlanes() + 6, planes);
+    if (m_settings.fog && m_settings.fogFar < m_camera->getFarPlane()) {
+        glm::vec3 forward = m_camera->getForward();
+        planes[5] = glm::vec4(-forward, glm::dot(forward, m_camera->getPosition()) + m_settings.fogFar);
     }
 
-    // Sort commands by shader and texture for better batching
-    std::sort(m_commandQueue.begin(), m_commandQueue.end(),
-        [](const RenderCommand& a, const RenderCommand& b) {
-            if (a.shader != b.shader) return a.shader < b.shader;
-            return a.textureID < b.textureID;
-        });
+    size_t visibleCount = m_commandQueue.cull(planes);
+
+    m_stats.commandsSubmitted += static_cast<int>(m_commandQueue.size());
+    m_stats.commandsCulled += static_cast<int>(m_commandQueue.size() - visibleCount);
+    m_stats.commandsOccluded += static_cast<int>(m_occlusionCuller.cull(m_commandQueue));
+
+    // Distant meshes drop to coarser LODs; only survivors are measured
+    m_commandQueue.selectLods(*m_camera, static_cast<float>(m_renderHeight));
 
-    GLuint lastShader = 0;
+    // With GPU culling the trees are culled here instead of by the forest,
+    // against the same occluders as the queue
+    if (m_forestRenderer.isGpuCulling()) {
+        m_forestRenderer.cull(*m_camera, static_cast<float>(m_renderHeight), m_occlusionCuller.uploadHierarchy(),
+                              m_impostors.isBaked());
+    }
+
+    m_mainShader->bind();
+
+    auto& state = RenderState::getInstance();
+    state.bindTexture(TextureBinding::SHADOW_ATLAS, m_shadowAtlas.getTexture());
+    state.bindTexture(TextureBinding::SHADOW_CASCADES, m_cascadedShadows.getTexture());
+
+    // Material textures are bound (or made resident) once for the frame
+    m_stats.textureBindings += m_materials.bind();
+
+    // Radix sort the visible commands by pass, state and depth
+    const std::vector<uint32_t>& drawOrder = m_commandQueue.sortVisible();
+
+    // With shader draw parameters, runs of opaque indexed commands that
+    // share a vertex array and texture state go out as one multi-draw. Each
+    // command gets an indirect draw and an entry in the per-draw buffer,
+    // which its baseInstance points at. Everything else, transparent
+    // commands included, draws one by one.
+    bool multiDraw = m_indirectShader && m_indirectShader->isLinked() && !drawOrder.empty();
+    GPUDrawData* drawData = nullptr;
+    GPUDrawElementsCommand* drawCommands = nullptr;
+    StreamAllocation commandAllocation;
+    if (multiDraw) {
+        auto& stream = StreamBuffer::getInstance();
+        StreamAllocation dataAllocation = stream.allocateStorage(drawOrder.size() * sizeof(GPUDrawData));
+        commandAllocation = stream.allocate(drawOrder.size() * sizeof(GPUDrawElementsCommand));
+        multiDraw = dataAllocation && commandAllocation;
+        if (multiDraw) {
+            drawData = static_cast<GPUDrawData*>(dataAllocation.data);
+            drawCommands = static_cast<GPUDrawElementsCommand*>(commandAllocation.data);
+            StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::DRAW_DATA, dataAllocation);
+            state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandAllocation.buffer);
+        }
+    }
+
+    // Texture state of a command: the material's diffuse and normal arrays
+    // (negative), or the legacy texture. The material index reaches the
+    // fragment shader through a varying, so a multi-draw never mixes two
+    // of them and the array index stays dynamically uniform.
+    auto textureState = [this](const RenderCommand& cmd) -> int64_t {
+        if (cmd.materialIndex != MaterialSystem::NO_MATERIAL) {
+            const int64_t diffuse = m_materials.getDiffuseArray(cmd.materialIndex) + 1;
+            const int64_t normal = m_materials.getNormalArray(cmd.materialIndex) + 1;
+            return -1 - ((diffuse << 16) | normal);
+        }
+        return cmd.textureID;
+    };
+
+    auto indexRange = [this](const RenderCommand& cmd, uint32_t index, uint32_t& count, uint32_t& first) {
+        count = static_cast<uint32_t>(cmd.indexCount);
+        first = cmd.firstIndex;
+        if (cmd.lods) {
+            const MeshLod& lod = cmd.lods[m_commandQueue.getLodLevel(index)];
+            count = lod.indexCount;
+            first += lod.indexOffset;
+        }
+    };
+
+    const ShaderProgram* boundProgram = m_mainShader.get();
     GLuint lastTexture = 0;
+    int lastMaterial = -1;
+    float lastFade = 1.0f;
+    m_mainShader->setInt(UniformName::MATERIAL_INDEX, -1);
+    m_mainShader->setFloat(UniformName::FADE, 1.0f);
+
+    uint32_t drawCount = 0;   // Entries used in drawData/drawCommands
+    bool transparentPass = false;
+    for (size_t i = 0; i < drawOrder.size();) {
+        const RenderCommand& cmd = m_commandQueue[drawOrder[i]];
+
+        // Within a pass transparent commands sort after the opaque ones:
+        // blend them and keep them out of the depth buffer
+        if (cmd.transparent != transparentPass) {
+            transparentPass = cmd.transparent;
+            state.setEnabled(GL_BLEND, transparentPass && m_settings.blend);
+            state.depthMask(!transparentPass);
+        }
+
+        // Legacy draws bind their texture, material draws only need an index
+        int material = cmd.materialIndex == MaterialSystem::NO_MATERIAL
+            ? -1 : static_cast<int>(cmd.materialIndex);
+        if (material < 0 && cmd.textureID != lastTexture && cmd.textureID != 0) {
+            state.bindTexture(TextureBinding::DIFFUSE, cmd.textureID);
+            lastTexture = cmd.textureID;
+            m_stats.textureBindings++;
+        }
 
-    for (const auto& cmd : m_commandQueue) {
-        // Bind shader if different
-        if (cmd.shader && cmd.shader->getID() != lastShader) {
-            if (lastShader != 0) {
-                m_mainShader->bind();
+        state.bindVertexArray(cmd.vao);
+
+        if (multiDraw && cmd.indexed && !cmd.transparent) {
+            if (boundProgram != m_indirectShader.get()) {
+                m_indirectShader->bind();
+                boundProgram = m_indirectShader.get();
+                m_stats.shaderBinds++;
+            }
+
+            const int64_t texture = textureState(cmd);
+            const uint32_t firstDraw = drawCount;
+            size_t end = i;
+            for (; end < drawOrder.size(); end++) {
+                const uint32_t index = drawOrder[end];
+                const RenderCommand& next = m_commandQueue[index];
+                if (!next.indexed || next.transparent || next.vao != cmd.vao || textureState(next) != texture) break;
+
+                GPUDrawData& data = drawData[drawCount];
+                data.model = next.modelMatrix;
+                data.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(next.modelMatrix))));
+                data.materialIndex = next.materialIndex == MaterialSystem::NO_MATERIAL
+                    ? -1 : static_cast<int32_t>(next.materialIndex);
+                data.fade = next.fade;
+
+                GPUDrawElementsCommand& draw = drawCommands[drawCount];
+                indexRange(next, index, draw.count, draw.firstIndex);
+                draw.instanceCount = 1;
+                draw.baseVertex = next.baseVertex;
+                draw.baseInstance = drawCount;
+
+                m_stats.triangles += static_cast<int>(draw.count / 3);
+                drawCount++;
             }
-            lastShader = cmd.shader ? cmd.shader->getID() : 0;
+
+            const GLsizei batchSize = static_cast<GLsizei>(drawCount - firstDraw);
+            const uintptr_t offset = static_cast<uintptr_t>(commandAllocation.offset) +
+                                     firstDraw * sizeof(GPUDrawElementsCommand);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset),
+                                        batchSize, 0);
+
+            m_stats.drawCalls++;
+            m_stats.commandsBatched += batchSize;
+            i = end;
+            continue;
+        }
+
+        if (boundProgram != m_mainShader.get()) {
+            m_mainShader->bind();
+            boundProgram = m_mainShader.get();
             m_stats.shaderBinds++;
         }
 
-        // Bind texture if different
-        if (cmd.textureID != lastTexture && cmd.textureID != 0) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, cmd.textureID);
-            lastTexture = cmd.textureID;
-            m_stats.textureBindings++;
+        if (material != lastMaterial) {
+            m_mainShader->setInt(UniformName::MATERIAL_INDEX, material);
+            lastMaterial = material;
+        }
+
+        if (cmd.fade != lastFade) {
+            m_mainShader->setFloat(UniformName::FADE, cmd.fade);
+            lastFade = cmd.fade;
         }
 
         // Set model matrix
-        m_mainShader->setMat4("model", cmd.modelMatrix);
+        m_mainShader->setMat4(UniformName::MODEL, cmd.modelMatrix);
 
         // Draw
-        glBindVertexArray(cmd.vao);
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        indexRange(cmd, drawOrder[i], indexCount, firstIndex);
 
         if (cmd.indexed) {
-            glDrawElements(GL_TRIANGLES, cmd.indexCount, GL_UNSIGNED_INT, 0);
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT,
+                                     reinterpret_cast<const void*>(static_cast<uintptr_t>(firstIndex) * sizeof(GLuint)),
+                                     cmd.baseVertex);
         } else {
-            glDrawArrays(GL_TRIANGLES, 0, cmd.indexCount);
+            glDrawArrays(GL_TRIANGLES, static_cast<GLint>(firstIndex), static_cast<GLsizei>(indexCount));
         }
 
         m_stats.drawCalls++;
-        m_stats.triangles += cmd.indexCount / 3;
+        m_stats.triangles += static_cast<int>(indexCount / 3);
+        i++;
+    }
+
+    if (transparentPass) {
+        state.disable(GL_BLEND);
+        state.depthMask(true);
     }
 
     m_commandQueue.clear();
-    glBindVertexArray(0);
+
+    // Trees picked by the forest this frame, one instanced draw per type,
+    // part and LOD
+    if (m_treeShader) {
+        m_forestRenderer.draw(*m_treeShader, m_stats);
+    }
+
+    // Terrain last among the opaques: it covers most of the screen, and
+    // what the meshes already hide fails the depth test
+    if (m_terrainShader) {
+        m_terrain.draw(*m_terrainShader, m_camera->getPosition(), planes, m_stats);
+    }
+
+    // Far objects as instanced billboards, after the opaque meshes so the
+    // depth test rejects the ones hidden behind them
+    m_impostors.draw(m_impostorInstances, m_stats);
+    m_impostorInstances.clear();
+    m_forestRenderer.drawImpostors(m_impostors, m_stats);
+    m_forestRenderer.endFrame();
 }
 
 void Renderer::setAmbientLight(const glm::vec3& color, float intensity) {
@@ -216,9 +530,7 @@ void Renderer::setAmbientLight(const glm::vec3& color, float intensity) {
 }
 
 void Renderer::addLight(const Light& light) {
-    if (m_lights.size() < 16) {
-        m_lights.push_back(light);
-    }
+    m_lights.push_back(light);
 }
 
 void Renderer::removeLight(int index) {
@@ -231,13 +543,19 @@ void Renderer::clearLights() {
     m_lights.clear();
 }
 
+void Renderer::invalidateShadowCache() {
+    m_shadowAtlas.invalidate();
+    m_cascadedShadows.invalidate();
+}
+
 void Renderer::enablePostProcessing(bool enabled) {
     m_settings.bloom = enabled;
 }
 
 void Renderer::setPostProcessingParams(float bloom, float vignette, float saturation) {
     m_settings.bloomIntensity = bloom;
-    // vignette and saturation would be used in post-process shader
+    m_settings.vignetteIntensity = vignette;
+    m_settings.saturation = saturation;
 }
 
 void Renderer::applySettings(const RenderSettings& settings) {
@@ -252,17 +570,9 @@ void Renderer::applySettings(const RenderSettings& settings) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 
-    if (settings.faceCulling) {
-        glEnable(GL_CULL_FACE);
-    } else {
-        glDisable(GL_CULL_FACE);
-    }
-
-    if (settings.depthTest) {
-        glEnable(GL_DEPTH_TEST);
-    } else {
-        glDisable(GL_DEPTH_TEST);
-    }
+    auto& state = RenderState::getInstance();
+    state.setEnabled(GL_CULL_FACE, settings.faceCulling);
+    state.setEnabled(GL_DEPTH_TEST, settings.depthTest);
 }
 
 void Renderer::resetStats() {
@@ -271,19 +581,74 @@ void Renderer::resetStats() {
     m_stats.triangles = 0;
     m_stats.textureBindings = 0;
     m_stats.shaderBinds = 0;
+    m_stats.commandsSubmitted = 0;
+    m_stats.commandsCulled = 0;
+    m_stats.commandsOccluded = 0;
+    m_stats.commandsBatched = 0;
+    m_stats.shadowTilesRendered = 0;
+    m_stats.shadowTilesCached = 0;
+    m_stats.shadowCascadesRendered = 0;
+    m_stats.impostorsDrawn = 0;
+    m_stats.treeInstancesDrawn = 0;
+}
+
+void Renderer::uploadFrameConstants() {
+    GPUFrameConstants frame;
+    frame.view = m_camera->getViewMatrix();
+    frame.projection = m_camera->getProjectionMatrix();
+    frame.viewProjection = m_camera->getViewProjectionMatrix();
+    frame.viewPos = glm::vec4(m_camera->getPosition(), 1.0f);
+    frame.fogColor = glm::vec4(m_settings.fogColor, m_settings.fog ? 1.0f : 0.0f);
+    frame.fogParams = glm::vec4(m_settings.fogNear, m_settings.fogFar, 0.0f, 0.0f);
+    frame.ambientColor = glm::vec4(m_ambientColor * m_ambientIntensity, 1.0f);
+    frame.clusterGrid = m_lightGrid.getGridInfo();
+    frame.clusterParams = m_lightGrid.getGridParams();
+
+    StreamBuffer::bindRange(GL_UNIFORM_BUFFER, UniformBinding::FRAME,
+                            StreamBuffer::getInstance().writeUniform(&frame, sizeof(frame)));
+}
+
+void Renderer::setupUniformBuffers() {
+    // Everything written per frame comes out of the stream buffer
+    StreamBuffer::getInstance().initialize();
+
+    m_lightGrid.initialize();
+}
+
+void Renderer::setupShadows() {
+    // By quality (off, low, medium, high): atlas size for local lights,
+    // cascade count and resolution for the directional light
+    static const int atlasSizes[] = {0, 2048, 4096, 8192};
+    static const int cascadeCounts[] = {0, 2, 3, 4};
+    static const int cascadeResolutions[] = {0, 1024, 2048, 2048};
+    int quality = std::clamp(Config::getInstance().graphics.shadowQuality, 0, 3);
+
+    m_shadowAtlas.initialize(atlasSizes[quality]);
+    m_cascadedShadows.initialize(cascadeCounts[quality], cascadeResolutions[quality]);
+}
+
+// Keeps an existing program across re-initialization so that a changed
+// variant compiles in the background while the old one still draws
+void Renderer::prepareProgram(std::unique_ptr<ShaderProgram>& program) {
+    if (!program) {
+        program = std::make_unique<ShaderProgram>();
+    }
+    program->clearShaders();
 }
 
 void Renderer::setupDefaultShaders() {
     // Main shader
-    m_mainShader = std::make_unique<ShaderProgram>();
+    prepareProgram(m_mainShader);
 
     Shader vertexShader;
     Shader fragmentShader;
 
     // These would normally be loaded from files
-    // For now, we'll use embedded shaders
+    // For now, we'll use embedded shaders. Camera, fog, ambient and lights
+    // come from the shared blocks in ShaderInterface.h.
+    const std::string header = "#version 450 core\n";
+
     const char* mainVertexSource = R"(
-#version 450 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -296,20 +661,30 @@ out vec2 TexCoords;
 out vec3 Tangent;
 out vec3 Bitangent;
 out float FogFactor;
-
+out float ViewDepth;
+
+#if defined(TREE_INSTANCING) || defined(DRAW_INDIRECT)
+flat out float InstanceFade;
+#endif
+#ifdef DRAW_INDIRECT
+flat out int DrawMaterial;
+#elif !defined(TREE_INSTANCING)
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 viewPos;
-uniform bool fogEnabled;
-uniform float fogNear;
-uniform float fogFar;
+#endif
 
 void main() {
+#if defined(TREE_INSTANCING)
+    mat4 model = getTreeModel(InstanceFade);
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+#elif defined(DRAW_INDIRECT)
+    mat3 normalMatrix;
+    mat4 model = getDrawModel(normalMatrix, InstanceFade, DrawMaterial);
+#else
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+#endif
     vec4 worldPos = model * vec4(aPos, 1.0);
     FragPos = worldPos.xyz;
     
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
     Normal = normalize(normalMatrix * aNormal);
     Tangent = normalize(normalMatrix * aTangent);
     Bitangent = normalize(normalMatrix * aBitangent);
@@ -318,9 +693,10 @@ void main() {
     
     vec4 viewPos4 = view * worldPos;
     float dist = -viewPos4.z;
+    ViewDepth = dist;
     
-    if (fogEnabled) {
-        FogFactor = clamp((fogFar - dist) / (fogFar - fogNear), 0.0, 1.0);
+    if (fogColor.a > 0.5) {
+        FogFactor = clamp((fogParams.y - dist) / (fogParams.y - fogParams.x), 0.0, 1.0);
     } else {
         FogFactor = 1.0;
     }
@@ -330,7 +706,6 @@ void main() {
 )";
 
     const char* mainFragmentSource = R"(
-#version 450 core
 out vec4 FragColor;
 
 in vec3 FragPos;
@@ -339,96 +714,272 @@ in vec2 TexCoords;
 in vec3 Tangent;
 in vec3 Bitangent;
 in float FogFactor;
-
-struct Light {
-    int type;
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float range;
-    float constant;
-    float linear;
-    float quadratic;
-    float innerCutoff;
-    float outerCutoff;
-};
+in float ViewDepth;
 
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
-uniform vec3 viewPos;
-uniform vec3 ambientColor;
-uniform int numLights;
-uniform Light lights[16];
-uniform vec3 fogColor;
-uniform bool fogEnabled;
+#ifdef DRAW_INDIRECT
+flat in int DrawMaterial;
+#else
+uniform int materialIndex;   // -1 = legacy diffuseMap binding
+#endif
+#if defined(TREE_INSTANCING) || defined(DRAW_INDIRECT)
+flat in float InstanceFade;
+#else
+uniform float fade;          // < 1 while cross-fading to an impostor
+#endif
+
+// Smoothly fades a light to zero at its range so cluster bounds don't show
+float rangeFalloff(float distance, float range) {
+    float ratio = distance / max(range, 0.0001);
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window;
+}
 
 vec3 calculateLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     vec3 result = vec3(0.0);
+
+    int type = int(light.directionType.w);
+    vec3 position = light.positionRange.xyz;
+    vec3 direction = light.directionType.xyz;
+    vec3 color = light.colorConstant.rgb;
+    float constant = light.colorConstant.w;
+    float linear = light.attenuation.x;
+    float quadratic = light.attenuation.y;
+    float innerCutoff = light.attenuation.z;
+    float outerCutoff = light.attenuation.w;
     
-    if (light.type == 0) { // Directional
-        vec3 lightDir = normalize(-light.direction);
+    if (type == 0) { // Directional
+        vec3 lightDir = normalize(-direction);
         float diff = max(dot(normal, lightDir), 0.0);
         vec3 reflectDir = reflect(-lightDir, normal);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-        result = light.color * (diff + spec);
+        result = color * (diff + spec) * sampleDirectionalShadow(light, fragPos, normal);
     }
-    else if (light.type == 1) { // Point
-        vec3 lightDir = normalize(light.position - fragPos);
+    else if (type == 1) { // Point
+        vec3 lightDir = normalize(position - fragPos);
         float diff = max(dot(normal, lightDir), 0.0);
         vec3 reflectDir = reflect(-lightDir, normal);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
         
-        float distance = length(light.position - fragPos);
-        float attenuation = 1.0 / (light.constant + light.linear * distance + 
-                                    light.quadratic * distance * distance);
-        result = light.color * (diff + spec) * attenuation;
+        float distance = length(position - fragPos);
+        float attenuation = 1.0 / (constant + linear * distance + 
+                                    quadratic * distance * distance);
+        attenuation *= rangeFalloff(distance, light.positionRange.w);
+        result = color * (diff + spec) * attenuation * sampleLightShadow(light, fragPos, normal);
     }
-    else if (light.type == 2) { // Spot
-        vec3 lightDir = normalize(light.position - fragPos);
+    else if (type == 2) { // Spot
+        vec3 lightDir = normalize(position - fragPos);
         float diff = max(dot(normal, lightDir), 0.0);
         vec3 reflectDir = reflect(-lightDir, normal);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
         
-        float theta = dot(lightDir, normalize(-light.direction));
-        float epsilon = light.innerCutoff - light.outerCutoff;
-        float intensity = clamp((theta - light.outerCutoff) / epsilon, 0.0, 1.0);
+        float theta = dot(lightDir, normalize(-direction));
+        float epsilon = innerCutoff - outerCutoff;
+        float intensity = clamp((theta - outerCutoff) / epsilon, 0.0, 1.0);
         
-        float distance = length(light.position - fragPos);
-        float attenuation = 1.0 / (light.constant + light.linear * distance + 
-                                    light.quadratic * distance * distance);
-        result = light.color * (diff + spec) * intensity * attenuation;
+        float distance = length(position - fragPos);
+        float attenuation = 1.0 / (constant + linear * distance + 
+                                    quadratic * distance * distance);
+        attenuation *= rangeFalloff(distance, light.positionRange.w);
+        result = color * (diff + spec) * intensity * attenuation * sampleLightShadow(light, fragPos, normal);
     }
     
     return result;
 }
 
 void main() {
-    vec3 color = texture(diffuseMap, TexCoords).rgb;
+#if defined(TREE_INSTANCING) || defined(DRAW_INDIRECT)
+    float fade = InstanceFade;
+#endif
+#ifdef DRAW_INDIRECT
+    int materialIndex = DrawMaterial;
+#endif
+    if (fade < 1.0 && ditherThreshold(gl_FragCoord.xy) < 1.0 - fade) discard;
+
+    vec3 color;
+    if (materialIndex < 0) {
+        color = texture(diffuseMap, TexCoords).rgb;
+    } else {
+        Material material = materials[materialIndex];
+        color = material.baseColor.rgb;
+        if (material.diffuse.w != 0u) {
+            color *= sampleMaterialTexture(material.diffuse, TexCoords).rgb;
+        }
+    }
     vec3 normal = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     
-    vec3 lighting = ambientColor;
+    vec3 lighting = ambientColor.rgb;
     
-    for (int i = 0; i < numLights; i++) {
+    // Directional lights first, then only the local lights of this cluster
+    for (uint i = 0u; i < clusterGrid.w; i++) {
         lighting += calculateLight(lights[i], normal, FragPos, viewDir);
     }
     
+    uvec2 cluster = lightClusters[getClusterIndex(gl_FragCoord.xy, ViewDepth)];
+    for (uint i = 0u; i < cluster.y; i++) {
+        uint lightIndex = clusterLightIndices[cluster.x + i];
+        lighting += calculateLight(lights[lightIndex], normal, FragPos, viewDir);
+    }
+    
     vec3 finalColor = color * lighting;
     
-    if (fogEnabled) {
-        finalColor = mix(fogColor, finalColor, FogFactor);
+    if (fogColor.a > 0.5) {
+        finalColor = mix(fogColor.rgb, finalColor, FogFactor);
     }
     
     FragColor = vec4(finalColor, 1.0);
 }
 )";
 
-    vertexShader.loadFromSource(mainVertexSource, ShaderType::VERTEX);
-    fragmentShader.loadFromSource(mainFragmentSource, ShaderType::FRAGMENT);
+    const std::string fragmentBody = m_materials.getShaderHeader() + ShaderInterface::FRAME_CONSTANTS +
+                                     ShaderInterface::LIGHTS + ShaderInterface::SHADOWS + ShaderInterface::MATERIALS +
+                                     ShaderInterface::DITHER + mainFragmentSource;
+
+    vertexShader.loadFromSource(header + ShaderInterface::FRAME_CONSTANTS + mainVertexSource,
+                                ShaderType::VERTEX);
+    fragmentShader.loadFromSource(header + fragmentBody, ShaderType::FRAGMENT);
 
     m_mainShader->attachShader(vertexShader);
     m_mainShader->attachShader(fragmentShader);
-    m_mainShader->link();
+    m_mainShader->linkAsync();
+
+    // Same shading for instanced trees; the model matrix and fade come from
+    // the tree instance buffers (see ForestRenderer)
+    prepareProgram(m_treeShader);
+    // Where available the visible runs start at each draw's baseInstance,
+    // which GPU tree culling relies on (see TreeCuller)
+    const std::string treeHeader = header + "#extension GL_ARB_shader_draw_parameters : enable\n"
+                                            "#define TREE_INSTANCING\n";
+
+    Shader treeVertex, treeFragment;
+    treeVertex.loadFromSource(treeHeader + ShaderInterface::FRAME_CONSTANTS + ShaderInterface::TREE_INSTANCES +
+                              mainVertexSource, ShaderType::VERTEX);
+    treeFragment.loadFromSource(treeHeader + fragmentBody, ShaderType::FRAGMENT);
+
+    m_treeShader->attachShader(treeVertex);
+    m_treeShader->attachShader(treeFragment);
+    m_treeShader->linkAsync();
+
+    // Multi-draw variant for the render queue: model, normal matrix,
+    // material and fade come from the per-draw buffer (see flush)
+    if (GLEW_ARB_shader_draw_parameters) {
+        prepareProgram(m_indirectShader);
+        const std::string indirectHeader = header + "#extension GL_ARB_shader_draw_parameters : require\n"
+                                                    "#define DRAW_INDIRECT\n";
+
+        Shader indirectVertex, indirectFragment;
+        indirectVertex.loadFromSource(indirectHeader + ShaderInterface::FRAME_CONSTANTS + ShaderInterface::DRAW_DATA +
+                                      mainVertexSource, ShaderType::VERTEX);
+        indirectFragment.loadFromSource(indirectHeader + fragmentBody, ShaderType::FRAGMENT);
+
+        m_indirectShader->attachShader(indirectVertex);
+        m_indirectShader->attachShader(indirectFragment);
+        m_indirectShader->linkAsync();
+    }
+
+    // Terrain patches displaced from the heightmap, shaded like everything
+    // else
+    prepareProgram(m_terrainShader);
+
+    const char* terrainVertexSource = R"(
+layout (location = 0) in vec2 aGrid;   // Patch vertex in [0, 1]
+layout (location = 1) in vec4 aNode;   // xy = min xz, z = size, w = LOD
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec3 Tangent;
+out vec3 Bitangent;
+out float FogFactor;
+out float ViewDepth;
+
+void main() {
+    vec2 worldXZ = morphTerrainVertex(aGrid, aNode);
+    vec4 terrain = sampleTerrain(worldXZ);
+    vec4 worldPos = vec4(worldXZ.x, terrain.w, worldXZ.y, 1.0);
+    FragPos = worldPos.xyz;
+
+    Normal = normalize(terrain.xyz);
+    Tangent = normalize(vec3(1.0, 0.0, 0.0) - Normal * Normal.x);
+    Bitangent = cross(Normal, Tangent);
+    TexCoords = worldXZ * 0.25;
+
+    vec4 viewPos4 = view * worldPos;
+    float dist = -viewPos4.z;
+    ViewDepth = dist;
+
+    if (fogColor.a > 0.5) {
+        FogFactor = clamp((fogParams.y - dist) / (fogParams.y - fogParams.x), 0.0, 1.0);
+    } else {
+        FogFactor = 1.0;
+    }
+
+    gl_Position = projection * viewPos4;
+}
+)";
+
+    Shader terrainVertex, terrainFragment;
+    terrainVertex.loadFromSource(header + ShaderInterface::FRAME_CONSTANTS + ShaderInterface::TERRAIN +
+                                 terrainVertexSource, ShaderType::VERTEX);
+    terrainFragment.loadFromSource(header + fragmentBody, ShaderType::FRAGMENT);
+
+    m_terrainShader->attachShader(terrainVertex);
+    m_terrainShader->attachShader(terrainFragment);
+    m_terrainShader->linkAsync();
+
+    // Depth-only shader for shadow maps
+    prepareProgram(m_shadowShader);
+
+    const char* shadowVertexSource = R"(
+#version 450 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 lightViewProjection;
+
+void main() {
+    gl_Position = lightViewProjection * model * vec4(aPos, 1.0);
+}
+)";
+
+    const char* shadowFragmentSource = R"(
+#version 450 core
+void main() {
+}
+)";
+
+    Shader shadowVert, shadowFrag;
+    shadowVert.loadFromSource(shadowVertexSource, ShaderType::VERTEX);
+    shadowFrag.loadFromSource(shadowFragmentSource, ShaderType::FRAGMENT);
+
+    m_shadowShader->attachShader(shadowVert);
+    m_shadowShader->attachShader(shadowFrag);
+    m_shadowShader->linkAsync();
+
+    // Depth-only variant for instanced trees
+    prepareProgram(m_treeShadowShader);
+
+    const char* treeShadowVertexSource = R"(
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightViewProjection;
+
+void main() {
+    float fade;
+    gl_Position = lightViewProjection * getTreeModel(fade) * vec4(aPos, 1.0);
+}
+)";
+
+    Shader treeShadowVert, treeShadowFrag;
+    treeShadowVert.loadFromSource(header + "#extension GL_ARB_shader_draw_parameters : enable\n" +
+                                  ShaderInterface::TREE_INSTANCES + treeShadowVertexSource, ShaderType::VERTEX);
+    treeShadowFrag.loadFromSource(shadowFragmentSource, ShaderType::FRAGMENT);
+
+    m_treeShadowShader->attachShader(treeShadowVert);
+    m_treeShadowShader->attachShader(treeShadowFrag);
+    m_treeShadowShader->linkAsync();
 }
 
 void Renderer::setupPostProcessing() {
@@ -476,71 +1027,83 @@ void Renderer::setupPostProcessing() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
-    // Post-process shader
-    m_postProcessShader = std::make_unique<ShaderProgram>();
+    // Bloom chain at half resolution
+    m_bloom.initialize(m_width, m_height);
 
+    // Composite: bloom, color grading, vignette and grain in one pass
     Shader ppVert, ppFrag;
+    if (!ppVert.loadFromFile("shaders/post.vert", ShaderType::VERTEX) ||
+        !ppFrag.loadFromFile("shaders/post.frag", ShaderType::FRAGMENT)) {
+        LOG_ERROR("Failed to load post-processing shaders");
+        if (m_postProcessShader && !m_postProcessShader->isLinked()) {
+            m_postProcessShader.reset();
+        }
+        return;
+    }
 
-    const char* ppVertexSource = R"(
-#version 450 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoords;
-out vec2 TexCoords;
-void main() {
-    TexCoords = aTexCoords;
-    gl_Position = vec4(aPos, 1.0);
-}
-)";
-
-    const char* ppFragmentSource = R"(
-#version 450 core
-out vec4 FragColor;
-in vec2 TexCoords;
-uniform sampler2D screenTexture;
-uniform float bloomIntensity;
-uniform float vignetteIntensity;
-
-void main() {
-    vec3 color = texture(screenTexture, TexCoords).rgb;
-    
-    // Vignette
-    vec2 center = TexCoords - 0.5;
-    float vignette = 1.0 - dot(center, center) * vignetteIntensity;
-    color *= vignette;
-    
-    FragColor = vec4(color, 1.0);
-}
-)";
-
-    ppVert.loadFromSource(ppVertexSource, ShaderType::VERTEX);
-    ppFrag.loadFromSource(ppFragmentSource, ShaderType::FRAGMENT);
-
+    prepareProgram(m_postProcessShader);
     m_postProcessShader->attachShader(ppVert);
     m_postProcessShader->attachShader(ppFrag);
-    m_postProcessShader->link();
+    if (!m_postProcessShader->linkAsync() && !m_postProcessShader->isLinked()) {
+        LOG_ERROR("Failed to link post-processing shader");
+        m_postProcessShader.reset();
+    }
 }
 
 void Renderer::renderPostProcessing() {
+    // Part of the target the scene covered this frame
+    const glm::vec2 uvScale(static_cast<float>(m_renderWidth) / m_width, static_cast<float>(m_renderHeight) / m_height);
+    const bool bloom = m_settings.bloom && m_settings.bloomIntensity > 0.0f;
+
+    m_profiler.beginPass(GpuPass::BLOOM);
+    if (bloom) {
+        m_bloom.process(m_postTexture, uvScale, m_settings.bloomThreshold, m_settings.bloomKnee);
+    }
+    m_profiler.endPass(GpuPass::BLOOM);
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, m_width, m_height);
+
+    // Without the composite shader the scene is only scaled to the window
+    if (!m_postProcessShader) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_postFBO);
+        glBlitFramebuffer(0, 0, m_renderWidth, m_renderHeight, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        return;
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    m_postProcessShader->bind();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_postTexture);
-    m_postProcessShader->setInt("screenTexture", 0);
-    m_postProcessShader->setFloat("bloomIntensity", m_settings.bloomIntensity);
-    m_postProcessShader->setFloat("vignetteIntensity", 0.5f);
+    // Every level of the chain adds the full image once more
+    float bloomScale = bloom && m_bloom.getLevelCount() > 0 ?
+        m_settings.bloomIntensity / static_cast<float>(m_bloom.getLevelCount()) : 0.0f;
 
-    glBindVertexArray(m_quadVAO);
+    // With bloom off the pass only upscales
+    auto& state = RenderState::getInstance();
+    m_postProcessShader->bind();
+    state.bindTexture(0, m_postTexture);
+    state.bindTexture(1, m_bloom.getTexture());
+    m_postProcessShader->setInt(SCREEN_TEXTURE, 0);
+    m_postProcessShader->setInt(BLOOM_TEXTURE, 1);
+    m_postProcessShader->setVec2(UV_SCALE, uvScale);
+    m_postProcessShader->setFloat(BLOOM_INTENSITY, bloomScale);
+    m_postProcessShader->setFloat(VIGNETTE_INTENSITY, m_settings.vignetteIntensity);
+    m_postProcessShader->setFloat(SATURATION, m_settings.bloom ? m_settings.saturation : 1.0f);
+    m_postProcessShader->setFloat(CONTRAST, 1.0f);
+    m_postProcessShader->setFloat(BRIGHTNESS, 0.0f);
+    m_postProcessShader->setBool(ENABLE_VIGNETTE, m_settings.bloom && m_settings.vignetteIntensity > 0.0f);
+    m_postProcessShader->setBool(ENABLE_FILM_GRAIN, m_settings.bloom && m_settings.filmGrain);
+    m_postProcessShader->setFloat(TIME, static_cast<float>(m_postFrame++ % 1024) * 0.618f);
+
+    // UI and text follow and set the state they need
+    state.disable(GL_DEPTH_TEST);
+    state.disable(GL_BLEND);
+    state.bindVertexArray(m_quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
 
 void Renderer::drawQuad() {
-    glBindVertexArray(m_quadVAO);
+    RenderState::getInstance().bindVertexArray(m_quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
 
 void Renderer::drawCube() {
@@ -564,19 +1127,17 @@ void Renderer::drawCube() {
             -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,
         };
 
-        glGenVertexArrays(1, &cubeVAO);
-        glGenBuffers(1, &cubeVBO);
-        glBindVertexArray(cubeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glBindVertexArray(0);
+        glCreateVertexArrays(1, &cubeVAO);
+        glCreateBuffers(1, &cubeVBO);
+        glNamedBufferData(cubeVBO, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glVertexArrayVertexBuffer(cubeVAO, 0, cubeVBO, 0, 3 * sizeof(float));
+        glEnableVertexArrayAttrib(cubeVAO, 0);
+        glVertexArrayAttribFormat(cubeVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(cubeVAO, 0, 0);
     }
 
-    glBindVertexArray(cubeVAO);
+    RenderState::getInstance().bindVertexArray(cubeVAO);
     glDrawArrays(GL_QUADS, 0, 24);
-    glBindVertexArray(0);
 }
 
 void Renderer::drawSphere(int segments) {
@@ -1,10 +1,68 @@
 #include "graphics/Shader.h"
+#include "graphics/ShaderCache.h"
+#include "graphics/RenderState.h"
 #include "core/Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 
 namespace ExperimentRedbear {
 
+namespace {
+
+// Every live program, for update()
+std::vector<ShaderProgram*>& livePrograms() {
+    static std::vector<ShaderProgram*> programs;
+    return programs;
+}
+
+bool parallelCompileSupported() {
+    static bool supported = [] {
+        if (!GLEW_KHR_parallel_shader_compile) return false;
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);   // Let the driver choose
+        return true;
+    }();
+    return supported;
+}
+
+// Bytes of one element of a uniform of this type, as the setters pass it
+uint32_t getUniformTypeSize(GLenum type) {
+    switch (type) {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: return 16;
+        case GL_FLOAT_MAT2: return 16;
+        case GL_FLOAT_MAT3: return 36;
+        case GL_FLOAT_MAT4: return 64;
+        case GL_DOUBLE: return 8;
+        case GL_DOUBLE_VEC2: return 16;
+        case GL_DOUBLE_VEC3: return 24;
+        case GL_DOUBLE_VEC4: return 32;
+        case GL_DOUBLE_MAT4: return 128;
+        default: return 4;   // Scalars, bools and samplers
+    }
+}
+
+int64_t getModifiedTime(const std::string& path) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+} // namespace
+
 Shader::Shader() : m_shaderID(0), m_compiled(false) {}
 
 Shader::~Shader() {
@@ -14,33 +72,48 @@ Shader::~Shader() {
 }
 
 bool Shader::loadFromFile(const std::string& filepath, ShaderType type) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
+    std::string source;
+    if (!readFile(filepath, source)) {
         m_compileLog = "Failed to open file: " + filepath;
         LOG_ERROR(m_compileLog);
         return false;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-
-    return loadFromSource(buffer.str(), type);
+    if (!loadFromSource(source, type)) return false;
+    m_path = filepath;
+    return true;
 }
 
 bool Shader::loadFromSource(const std::string& source, ShaderType type) {
     m_type = type;
-    m_shaderID = glCreateShader(static_cast<GLenum>(type));
+    m_source = source;
+    m_path.clear();
+    m_compiled = false;
 
-    const char* src = source.c_str();
-    glShaderSource(m_shaderID, 1, &src, nullptr);
-
-    return compile();
+    if (m_source.empty()) {
+        m_compileLog = "Empty shader source";
+        LOG_ERROR(m_compileLog);
+        return false;
+    }
+    return true;
 }
 
 bool Shader::compile() {
+    beginCompile();
+    return finishCompile();
+}
+
+void Shader::beginCompile() {
+    if (!m_shaderID) {
+        m_shaderID = glCreateShader(static_cast<GLenum>(m_type));
+    }
+
+    const char* src = m_source.c_str();
+    glShaderSource(m_shaderID, 1, &src, nullptr);
     glCompileShader(m_shaderID);
+}
 
+bool Shader::finishCompile() {
     GLint success;
     glGetShaderiv(m_shaderID, GL_COMPILE_STATUS, &success);
 
@@ -61,117 +134,386 @@ bool Shader::compile() {
 // ShaderProgram implementation
 
 ShaderProgram::ShaderProgram() : m_programID(0), m_linked(false) {
-    m_programID = glCreateProgram();
+    livePrograms().push_back(this);
 }
 
 ShaderProgram::~ShaderProgram() {
+    auto& programs = livePrograms();
+    programs.erase(std::remove(programs.begin(), programs.end(), this), programs.end());
+
+    if (m_pending) {
+        glDeleteProgram(m_pending->program);
+    }
     if (m_programID) {
         glDeleteProgram(m_programID);
     }
 }
 
 bool ShaderProgram::attachShader(const Shader& shader) {
-    if (!shader.isCompiled()) {
-        LOG_ERROR("Cannot attach uncompiled shader");
+    if (!shader.isLoaded()) {
+        LOG_ERROR("Cannot attach shader without source");
         return false;
     }
 
-    glAttachShader(m_programID, shader.getID());
+    Stage stage = { shader.getType(), shader.getSource(), shader.getPath(), 0 };
+    if (!stage.path.empty()) {
+        stage.modified = getModifiedTime(stage.path);
+    }
+    m_stages.push_back(std::move(stage));
     return true;
 }
 
+void ShaderProgram::clearShaders() {
+    m_stages.clear();
+}
+
+uint64_t ShaderProgram::computeKey() const {
+    uint64_t key = ShaderCache::HASH_SEED;
+    for (const Stage& stage : m_stages) {
+        key = ShaderCache::hash(key, std::to_string(static_cast<GLenum>(stage.type)));
+        key = ShaderCache::hash(key, stage.source);
+    }
+    return key;
+}
+
 bool ShaderProgram::link() {
-    glLinkProgram(m_programID);
+    if (m_pending) {
+        glDeleteProgram(m_pending->program);
+        m_pending.reset();
+    }
+    return finishBuild(beginBuild(computeKey()));
+}
 
-    GLint success;
-    glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
+bool ShaderProgram::linkAsync() {
+    if (!m_linked) {
+        return link();
+    }
+
+    uint64_t key = computeKey();
+    if (m_pending && m_pending->key == key) return true;
+    if (m_pending) {
+        glDeleteProgram(m_pending->program);
+        m_pending.reset();
+    }
+    if (key == m_key) return true;
+
+    auto build = beginBuild(key);
+    if (build->cached) {
+        return finishBuild(std::move(build));
+    }
+    m_pending = std::move(build);
+    return true;
+}
+
+std::unique_ptr<ShaderProgram::Build> ShaderProgram::beginBuild(uint64_t key) {
+    auto build = std::make_unique<Build>();
+    build->program = glCreateProgram();
+    build->key = key;
+    build->start = std::chrono::high_resolution_clock::now();
+
+    auto& cache = ShaderCache::getInstance();
+    build->cached = cache.load(key, build->program);
+    if (build->cached) {
+        return build;
+    }
+
+    // Submit everything without asking for status, so a driver with
+    // parallel compile returns right away
+    for (const Stage& stage : m_stages) {
+        auto shader = std::make_unique<Shader>();
+        shader->loadFromSource(stage.source, stage.type);
+        shader->beginCompile();
+        glAttachShader(build->program, shader->getID());
+        build->shaders.push_back(std::move(shader));
+    }
 
+    if (cache.isEnabled()) {
+        glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(build->program);
+    return build;
+}
+
+bool ShaderProgram::finishBuild(std::unique_ptr<Build> build) {
+    bool success = build->cached;
     if (!success) {
-        GLint logLength;
-        glGetProgramiv(m_programID, GL_INFO_LOG_LENGTH, &logLength);
-        m_linkLog.resize(logLength);
-        glGetProgramInfoLog(m_programID, logLength, nullptr, &m_linkLog[0]);
-        LOG_ERROR("Shader program linking failed: " + m_linkLog);
-        m_linked = false;
+        GLint linked = 0;
+        glGetProgramiv(build->program, GL_LINK_STATUS, &linked);
+        success = linked;
+
+        if (!success) {
+            // The compile log is the useful one when a stage failed
+            m_linkLog.clear();
+            for (auto& shader : build->shaders) {
+                if (!shader->finishCompile()) {
+                    m_linkLog = shader->getCompileLog();
+                    break;
+                }
+            }
+            if (m_linkLog.empty()) {
+                GLint logLength;
+                glGetProgramiv(build->program, GL_INFO_LOG_LENGTH, &logLength);
+                m_linkLog.resize(logLength);
+                glGetProgramInfoLog(build->program, logLength, nullptr, &m_linkLog[0]);
+                LOG_ERROR("Shader program linking failed: " + m_linkLog);
+            }
+        }
+
+        // The program keeps its binary; the stages can go
+        for (auto& shader : build->shaders) {
+            glDetachShader(build->program, shader->getID());
+        }
+    }
+
+    if (!success) {
+        glDeleteProgram(build->program);
+        if (m_linked) {
+            LOG_WARNING("Shader rebuild failed, keeping the previous program");
+        }
         return false;
     }
 
+    auto& cache = ShaderCache::getInstance();
+    if (!build->cached) {
+        cache.store(build->key, build->program);
+    }
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - build->start;
+    cache.recordLink(elapsed.count(), build->cached);
+
+    if (m_programID) {
+        glDeleteProgram(m_programID);
+    }
+    m_programID = build->program;
+    m_key = build->key;
     m_linked = true;
-    m_uniformLocationCache.clear();
-    LOG_DEBUG("Shader program linked successfully");
+    reflect();
+    LOG_DEBUG(build->cached ? "Shader program loaded from cache" : "Shader program linked successfully");
     return true;
 }
 
+bool ShaderProgram::pollBuild() {
+    if (!m_pending) return true;
+
+    // Without the extension the first poll waits for the driver, which is
+    // still off the frame that requested the rebuild
+    if (parallelCompileSupported()) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(m_pending->program, GL_COMPLETION_STATUS_KHR, &complete);
+        if (!complete) return false;
+    }
+
+    finishBuild(std::move(m_pending));
+    return true;
+}
+
+bool ShaderProgram::reloadChangedStages() {
+    bool changed = false;
+    for (Stage& stage : m_stages) {
+        if (stage.path.empty()) continue;
+
+        int64_t modified = getModifiedTime(stage.path);
+        if (modified == 0 || modified == stage.modified) continue;
+
+        std::string source;
+        if (!readFile(stage.path, source) || source.empty()) continue;
+        stage.modified = modified;
+        if (source != stage.source) {
+            stage.source = std::move(source);
+            changed = true;
+            LOG_INFO("Reloading shader " + stage.path);
+        }
+    }
+    return changed && linkAsync();
+}
+
+void ShaderProgram::update(float deltaTime) {
+    static float reloadTimer = 0.0f;
+    reloadTimer += deltaTime;
+    const bool checkFiles = reloadTimer >= RELOAD_INTERVAL;
+    if (checkFiles) reloadTimer = 0.0f;
+
+    for (ShaderProgram* program : livePrograms()) {
+        if (checkFiles && program->m_linked) {
+            program->reloadChangedStages();
+        }
+        program->pollBuild();
+    }
+}
+
 void ShaderProgram::bind() const {
-    glUseProgram(m_programID);
+    RenderState::getInstance().useProgram(m_programID);
 }
 
 void ShaderProgram::unbind() const {
-    glUseProgram(0);
+    RenderState::getInstance().useProgram(0);
 }
 
-GLint ShaderProgram::getUniformLocation(const std::string& name) {
-    auto it = m_uniformLocationCache.find(name);
-    if (it != m_uniformLocationCache.end()) {
-        return it->second;
+void ShaderProgram::reflect() {
+    m_uniforms.clear();
+    m_blocks.clear();
+    m_uniformShadow.clear();
+
+    GLint count = 0;
+    GLint maxNameLength = 0;
+    glGetProgramInterfaceiv(m_programID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    glGetProgramInterfaceiv(m_programID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+    std::vector<char> name(std::max(maxNameLength, 1));
+
+    const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[4];
+        glGetProgramResourceiv(m_programID, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+        if (values[3] != -1 || values[0] < 0) continue;   // Block member or not settable
+
+        GLsizei length = 0;
+        glGetProgramResourceName(m_programID, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), &length, name.data());
+
+        // "weights[0]" is set through "weights"
+        std::string uniformName(name.data(), length);
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos && uniformName.compare(bracket, std::string::npos, "[0]") == 0) {
+            uniformName.resize(bracket);
+        }
+
+        Uniform uniform;
+        uniform.location = values[0];
+        uniform.offset = static_cast<uint32_t>(m_uniformShadow.size());
+        uniform.size = getUniformTypeSize(static_cast<GLenum>(values[1])) * static_cast<uint32_t>(std::max(values[2], 1));
+        m_uniformShadow.resize(m_uniformShadow.size() + uniform.size);
+        m_uniforms[UniformID::hashName(uniformName.c_str())] = uniform;
+    }
+
+    for (GLenum blockInterface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK }) {
+        GLint blockCount = 0;
+        glGetProgramInterfaceiv(m_programID, blockInterface, GL_ACTIVE_RESOURCES, &blockCount);
+        glGetProgramInterfaceiv(m_programID, blockInterface, GL_MAX_NAME_LENGTH, &maxNameLength);
+        name.resize(std::max(maxNameLength, 1));
+
+        const GLenum bindingProperty = GL_BUFFER_BINDING;
+        for (GLint i = 0; i < blockCount; i++) {
+            GLint binding = -1;
+            glGetProgramResourceiv(m_programID, blockInterface, i, 1, &bindingProperty, 1, nullptr, &binding);
+            GLsizei length = 0;
+            glGetProgramResourceName(m_programID, blockInterface, i, static_cast<GLsizei>(name.size()), &length, name.data());
+            m_blocks[UniformID::hashName(name.data(), length)] = binding;
+        }
     }
+}
 
-    GLint location = glGetUniformLocation(m_programID, name.c_str());
-    m_uniformLocationCache[name] = location;
+GLint ShaderProgram::getBlockBinding(UniformID id) const {
+    auto it = m_blocks.find(id.hash);
+    return it != m_blocks.end() ? it->second : -1;
+}
+
+ShaderProgram::Uniform* ShaderProgram::updateShadow(UniformID id, const void* data, size_t size) {
+    auto it = m_uniforms.find(id.hash);
+    if (it == m_uniforms.end()) {
+        // Once per program and name, also across rebuilds; the compiler may
+        // simply have optimized it out
+        if (m_linked && m_reportedMissing.insert(id.hash).second) {
+            LOG_WARNING(std::string("Uniform not active in program ") + std::to_string(m_programID) + ": " + id.name);
+        }
+        return nullptr;
+    }
+
+    Uniform& uniform = it->second;
+    if (size > uniform.size) {
+        // More than the program declares; let GL decide, don't shadow it
+        uniform.uploaded = 0;
+        return &uniform;
+    }
+
+    uint8_t* shadow = m_uniformShadow.data() + uniform.offset;
+    if (uniform.uploaded == size && std::memcmp(shadow, data, size) == 0) {
+        return nullptr;
+    }
+
+    std::memcpy(shadow, data, size);
+    uniform.uploaded = static_cast<uint32_t>(size);
+    return &uniform;
+}
 
-    if (location == -1) {
-        LOG_WARNING("Uniform not found: " + name);
+void ShaderProgram::setInt(UniformID id, int value) {
+    if (Uniform* uniform = updateShadow(id, &value, sizeof(value))) {
+        glUniform1i(uniform->location, value);
     }
+}
 
-    return location;
+void ShaderProgram::setFloat(UniformID id, float value) {
+    if (Uniform* uniform = updateShadow(id, &value, sizeof(value))) {
+        glUniform1f(uniform->location, value);
+    }
 }
 
-void ShaderProgram::setInt(const std::string& name, int value) {
-    glUniform1i(getUniformLocation(name), value);
+void ShaderProgram::setBool(UniformID id, bool value) {
+    setInt(id, value ? 1 : 0);
 }
 
-void ShaderProgram::setFloat(const std::string& name, float value) {
-    glUniform1f(getUniformLocation(name), value);
+void ShaderProgram::setVec2(UniformID id, const glm::vec2& value) {
+    if (Uniform* uniform = updateShadow(id, glm::value_ptr(value), sizeof(value))) {
+        glUniform2fv(uniform->location, 1, glm::value_ptr(value));
+    }
 }
 
-void ShaderProgram::setBool(const std::string& name, bool value) {
-    glUniform1i(getUniformLocation(name), value ? 1 : 0);
+void ShaderProgram::setVec3(UniformID id, const glm::vec3& value) {
+    if (Uniform* uniform = updateShadow(id, glm::value_ptr(value), sizeof(value))) {
+        glUniform3fv(uniform->location, 1, glm::value_ptr(value));
+    }
 }
 
-void ShaderProgram::setVec2(const std::string& name, const glm::vec2& value) {
-    glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(value));
+void ShaderProgram::setVec4(UniformID id, const glm::vec4& value) {
+    if (Uniform* uniform = updateShadow(id, glm::value_ptr(value), sizeof(value))) {
+        glUniform4fv(uniform->location, 1, glm::value_ptr(value));
+    }
 }
 
-void ShaderProgram::setVec3(const std::string& name, const glm::vec3& value) {
-    glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(value));
+void ShaderProgram::setMat3(UniformID id, const glm::mat3& value) {
+    if (Uniform* uniform = updateShadow(id, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix3fv(uniform->location, 1, GL_FALSE, glm::value_ptr(value));
+    }
 }
 
-void ShaderProgram::setVec4(const std::string& name, const glm::vec4& value) {
-    glUniform4fv(getUniformLocation(name), 1, glm::value_ptr(value));
+void ShaderProgram::setMat4(UniformID id, const glm::mat4& value) {
+    if (Uniform* uniform = updateShadow(id, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, glm::value_ptr(value));
+    }
 }
 
-void ShaderProgram::setMat3(const std::string& name, const glm::mat3& value) {
-    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+void ShaderProgram::setInt(UniformID id, int count, const int* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(int) * count)) {
+        glUniform1iv(uniform->location, count, values);
+    }
 }
 
-void ShaderProgram::setMat4(const std::string& name, const glm::mat4& value) {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+void ShaderProgram::setFloat(UniformID id, int count, const float* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(float) * count)) {
+        glUniform1fv(uniform->location, count, values);
+    }
 }
 
-void ShaderProgram::setInt(const std::string& name, int count, const int* values) {
-    glUniform1iv(getUniformLocation(name), count, values);
+void ShaderProgram::setVec2(UniformID id, int count, const float* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(float) * 2 * count)) {
+        glUniform2fv(uniform->location, count, values);
+    }
 }
 
-void ShaderProgram::setFloat(const std::string& name, int count, const float* values) {
-    glUniform1fv(getUniformLocation(name), count, values);
+void ShaderProgram::setVec3(UniformID id, int count, const float* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(float) * 3 * count)) {
+        glUniform3fv(uniform->location, count, values);
+    }
 }
 
-void ShaderProgram::setVec3(const std::string& name, int count, const float* values) {
-    glUniform3fv(getUniformLocation(name), count, values);
+void ShaderProgram::setVec4(UniformID id, int count, const float* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(float) * 4 * count)) {
+        glUniform4fv(uniform->location, count, values);
+    }
 }
 
-void ShaderProgram::setMat4(const std::string& name, int count, const float* values) {
-    glUniformMatrix4fv(getUniformLocation(name), count, GL_FALSE, values);
+void ShaderProgram::setMat4(UniformID id, int count, const float* values) {
+    if (Uniform* uniform = updateShadow(id, values, sizeof(float) * 16 * count)) {
+        glUniformMatrix4fv(uniform->location, count, GL_FALSE, values);
+    }
 }
 
 } // namespace ExperimentRedbear
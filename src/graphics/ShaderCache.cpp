@@ -0,0 +1,159 @@
+#include "graphics/ShaderCache.h"
+#include "core/Logger.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x52424350;   // "PCBR"
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t format;    // glGetProgramBinary format
+    uint64_t key;
+    uint32_t length;
+    uint32_t padding;
+};
+
+std::string getGLString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // namespace
+
+ShaderCache& ShaderCache::getInstance() {
+    static ShaderCache instance;
+    return instance;
+}
+
+ShaderCache::ShaderCache() {}
+
+ShaderCache::~ShaderCache() = default;
+
+uint64_t ShaderCache::hash(uint64_t seed, const std::string& data) {
+    // FNV-1a, 64 bit
+    uint64_t h = seed;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void ShaderCache::initialize() {
+    m_initialized = true;
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    m_enabled = formatCount > 0;
+    if (!m_enabled) {
+        LOG_INFO("Driver exposes no program binary formats, shader cache disabled");
+        return;
+    }
+
+    m_driverHash = hash(HASH_SEED, getGLString(GL_VENDOR));
+    m_driverHash = hash(m_driverHash, getGLString(GL_RENDERER));
+    m_driverHash = hash(m_driverHash, getGLString(GL_VERSION));
+}
+
+bool ShaderCache::isEnabled() {
+    if (!m_initialized) initialize();
+    return m_enabled;
+}
+
+std::string ShaderCache::getPath(uint64_t key) const {
+    std::ostringstream path;
+    path << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << (key ^ m_driverHash) << ".bin";
+    return path.str();
+}
+
+bool ShaderCache::load(uint64_t key, GLuint program) {
+    if (!isEnabled()) return false;
+
+    std::ifstream file(getPath(key), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    CacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != CACHE_MAGIC || header.key != (key ^ m_driverHash) || header.length == 0) {
+        m_rejected++;
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), header.length);
+    if (!file) {
+        m_rejected++;
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(header.length));
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        m_rejected++;
+        LOG_DEBUG("Cached program binary rejected by the driver, recompiling");
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderCache::store(uint64_t key, GLuint program) {
+    if (!isEnabled()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+
+    std::ofstream file(getPath(key), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_WARNING("Failed to write shader cache entry in " + m_directory);
+        return;
+    }
+
+    CacheHeader header = { CACHE_MAGIC, format, key ^ m_driverHash, static_cast<uint32_t>(length), 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+}
+
+void ShaderCache::recordLink(float milliseconds, bool cached) {
+    if (cached) {
+        m_hits++;
+        m_cachedTime += milliseconds;
+    } else {
+        m_misses++;
+        m_compiledTime += milliseconds;
+    }
+}
+
+void ShaderCache::logSummary() const {
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(1)
+            << "Shader startup (" << (m_misses == 0 ? "warm" : "cold") << "): "
+            << m_cachedTime + m_compiledTime << " ms, "
+            << m_hits << " cached (" << m_cachedTime << " ms), "
+            << m_misses << " compiled (" << m_compiledTime << " ms)";
+    if (m_rejected > 0) {
+        summary << ", " << m_rejected << " stale binaries";
+    }
+    LOG_INFO(summary.str());
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,389 @@
+#include "graphics/ShadowAtlas.h"
+#include "graphics/Shader.h"
+#include "graphics/Renderer.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr float SHADOW_NEAR_PLANE = 0.05f;
+
+// FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+// Morton index -> cell coordinates
+glm::ivec2 decodeMorton(uint32_t code) {
+    auto compact = [](uint32_t x) {
+        x &= 0x55555555u;
+        x = (x ^ (x >> 1)) & 0x33333333u;
+        x = (x ^ (x >> 2)) & 0x0F0F0F0Fu;
+        x = (x ^ (x >> 4)) & 0x00FF00FFu;
+        x = (x ^ (x >> 8)) & 0x0000FFFFu;
+        return x;
+    };
+    return glm::ivec2(compact(code), compact(code >> 1));
+}
+
+uint32_t nextPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+uint32_t previousPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result <= value / 2) result <<= 1;
+    return result;
+}
+
+} // namespace
+
+ShadowAtlas::ShadowAtlas() {}
+
+ShadowAtlas::~ShadowAtlas() = default;
+
+bool ShadowAtlas::initialize(int atlasSize) {
+    shutdown();
+
+    m_size = atlasSize > 0 ? static_cast<int>(nextPowerOfTwo(std::max(atlasSize, MIN_TILE_SIZE))) : 0;
+
+    // Always create a texture so the sampler is complete even with shadows off
+    int textureSize = m_size > 0 ? m_size : 1;
+
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, textureSize, textureSize);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        LOG_ERROR("Shadow atlas framebuffer incomplete!");
+        m_size = 0;
+    }
+
+    m_tileBuffer.create(GL_SHADER_STORAGE_BUFFER, 64 * sizeof(GPUShadowTile));
+    m_tileBuffer.bindBase(StorageBinding::SHADOW_TILES);
+
+    m_cache.clear();
+    m_invalidated = true;
+
+    if (m_size > 0) {
+        LOG_INFO("Shadow atlas: " + std::to_string(m_size) + "x" + std::to_string(m_size));
+    }
+    return complete;
+}
+
+void ShadowAtlas::shutdown() {
+    if (m_fbo) {
+        glDeleteFramebuffers(1, &m_fbo);
+        m_fbo = 0;
+    }
+    if (m_depthTexture) {
+        glDeleteTextures(1, &m_depthTexture);
+        m_depthTexture = 0;
+    }
+    m_tileBuffer.destroy();
+    m_cache.clear();
+    m_lightTiles.clear();
+    m_gpuTiles.clear();
+}
+
+void ShadowAtlas::invalidate() {
+    m_invalidated = true;
+}
+
+int ShadowAtlas::computeTileSize(const Camera& camera, const Light& light) const {
+    // Fraction of the screen height covered by the light's range
+    float distance = glm::length(light.position - camera.getPosition());
+    float coverage = 1.0f;
+    if (distance > light.range) {
+        float halfHeight = distance * std::tan(glm::radians(camera.getFOV()) * 0.5f);
+        coverage = std::min(light.range / std::max(halfHeight, 0.0001f), 1.0f);
+    }
+
+    // The light's resolution need not be a power of two (768, say); round it
+    // down so the clamp below can't hand allocate() an odd tile
+    int maxSize = std::min(std::max(light.shadowMapResolution, MIN_TILE_SIZE), m_size / 2);
+    maxSize = static_cast<int>(previousPowerOfTwo(static_cast<uint32_t>(maxSize)));
+    int size = static_cast<int>(nextPowerOfTwo(static_cast<uint32_t>(coverage * maxSize)));
+    return std::clamp(size, MIN_TILE_SIZE, std::max(maxSize, MIN_TILE_SIZE));
+}
+
+bool ShadowAtlas::allocate(std::vector<TileRequest>& requests, std::vector<glm::ivec4>& rects) const {
+    // Power-of-two tiles placed largest first along a Morton curve of
+    // MIN_TILE_SIZE cells. Each tile then starts on a multiple of its own
+    // cell count, which makes it an aligned square that never overlaps.
+    std::stable_sort(requests.begin(), requests.end(),
+        [](const TileRequest& a, const TileRequest& b) { return a.size > b.size; });
+
+    const uint32_t cellsPerSide = static_cast<uint32_t>(m_size / MIN_TILE_SIZE);
+    const uint32_t totalCells = cellsPerSide * cellsPerSide;
+
+    uint32_t cursor = 0;
+    int sizeLimit = m_size;
+    bool allPlaced = true;
+
+    rects.assign(requests.size() * 6, glm::ivec4(0));
+
+    for (size_t r = 0; r < requests.size(); r++) {
+        TileRequest& request = requests[r];
+        request.size = std::min(request.size, sizeLimit);
+
+        // Shrink until it fits; later (smaller) requests may not exceed it
+        uint32_t cells = 0;
+        while (true) {
+            uint32_t side = static_cast<uint32_t>(request.size / MIN_TILE_SIZE);
+            cells = side * side * request.faces;
+            if (cursor + cells <= totalCells || request.size <= MIN_TILE_SIZE) break;
+            request.size /= 2;
+        }
+        sizeLimit = request.size;
+
+        if (cursor + cells > totalCells) {
+            request.faces = 0;
+            allPlaced = false;
+            continue;
+        }
+
+        uint32_t faceCells = cells / request.faces;
+        for (int face = 0; face < request.faces; face++) {
+            glm::ivec2 cell = decodeMorton(cursor);
+            rects[r * 6 + face] = glm::ivec4(cell * MIN_TILE_SIZE, request.size, request.size);
+            cursor += faceCells;
+        }
+    }
+
+    return allPlaced;
+}
+
+glm::mat4 ShadowAtlas::computeFaceMatrix(const Light& light, int face) {
+    if (light.type == LightType::POINT) {
+        static const glm::vec3 directions[6] = {
+            { 1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f},
+            { 0.0f, 1.0f, 0.0f}, { 0.0f, -1.0f, 0.0f},
+            { 0.0f, 0.0f, 1.0f}, { 0.0f, 0.0f, -1.0f}
+        };
+        static const glm::vec3 ups[6] = {
+            {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+            {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f},
+            {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}
+        };
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR_PLANE, light.range);
+        glm::mat4 view = glm::lookAt(light.position, light.position + directions[face], ups[face]);
+        return projection * view;
+    }
+
+    // Spot light: cover the outer cone with a small margin
+    glm::vec3 direction = glm::normalize(light.direction);
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    float fov = std::min(light.outerConeAngle * 2.0f + 2.0f, 170.0f);
+
+    glm::mat4 projection = glm::perspective(glm::radians(fov), 1.0f, SHADOW_NEAR_PLANE, light.range);
+    glm::mat4 view = glm::lookAt(light.position, light.position + direction, up);
+    return projection * view;
+}
+
+uint64_t ShadowAtlas::hashLight(const Light& light) {
+    uint64_t hash = HASH_SEED;
+    int type = static_cast<int>(light.type);
+    hash = hashBytes(hash, &type, sizeof(type));
+    hash = hashBytes(hash, &light.position, sizeof(light.position));
+    hash = hashBytes(hash, &light.direction, sizeof(light.direction));
+    hash = hashBytes(hash, &light.range, sizeof(light.range));
+    hash = hashBytes(hash, &light.outerConeAngle, sizeof(light.outerConeAngle));
+    return hash;
+}
+
+uint64_t ShadowAtlas::hashCasters(const RenderQueue& queue) {
+    // Only dynamic commands inside the tile's frustum (per the last cull)
+    const std::vector<uint8_t>& visibility = queue.getVisibility();
+    uint64_t hash = HASH_SEED;
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        const RenderCommand& cmd = queue[i];
+        if (!visibility[i] || !cmd.dynamic) continue;
+
+        hash = hashBytes(hash, &cmd.vao, sizeof(cmd.vao));
+        hash = hashBytes(hash, &cmd.baseVertex, sizeof(cmd.baseVertex));
+        hash = hashBytes(hash, &cmd.modelMatrix, sizeof(cmd.modelMatrix));
+    }
+    return hash;
+}
+
+void ShadowAtlas::update(const Camera& camera, const std::vector<Light>& lights, RenderQueue& queue,
+                         ShaderProgram& depthShader, RenderStats& stats,
+                         const ShadowCasterCallback& extraCasters) {
+    m_lightTiles.assign(lights.size(), -1);
+    m_gpuTiles.clear();
+
+    if (!isEnabled()) return;
+
+    if (m_cache.size() < lights.size()) {
+        m_cache.resize(lights.size());
+    }
+
+    // Request a tile for every shadow-casting light that can reach the view
+    std::vector<TileRequest> requests;
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& light = lights[i];
+        if (!light.castShadows || light.type == LightType::DIRECTIONAL) continue;
+        if (light.intensity <= 0.0f) continue;
+        if (!camera.isInFrustum(light.position, light.range)) continue;
+
+        int faces = light.type == LightType::POINT ? 6 : 1;
+        requests.push_back({static_cast<int>(i), computeTileSize(camera, light), faces});
+    }
+
+    if (requests.empty()) {
+        m_cache.clear();
+        return;
+    }
+
+    std::vector<glm::ivec4> rects;
+    if (!allocate(requests, rects)) {
+        LOG_WARNING("Shadow atlas full, some lights are unshadowed this frame");
+    }
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    bool targetBound = false;
+    const float invSize = 1.0f / static_cast<float>(m_size);
+
+    for (size_t r = 0; r < requests.size(); r++) {
+        const TileRequest& request = requests[r];
+        if (request.faces == 0) continue;
+
+        const Light& light = lights[request.lightIndex];
+        std::vector<CachedTile>& cache = m_cache[request.lightIndex];
+        cache.resize(request.faces);
+
+        uint64_t lightHash = hashLight(light);
+        m_lightTiles[request.lightIndex] = static_cast<int>(m_gpuTiles.size());
+
+        for (int face = 0; face < request.faces; face++) {
+            glm::ivec4 rect = rects[r * 6 + face];
+            glm::mat4 viewProjection = computeFaceMatrix(light, face);
+
+            GPUShadowTile tile;
+            tile.viewProjection = viewProjection;
+            tile.atlasRect = glm::vec4(rect) * invSize;
+            m_gpuTiles.push_back(tile);
+
+            glm::vec4 planes[6];
+            Camera::extractFrustumPlanes(viewProjection, planes);
+            queue.cull(planes);
+            uint64_t casterHash = hashCasters(queue);
+
+            CachedTile& cached = cache[face];
+            bool stale = m_invalidated || !light.staticShadows || !cached.valid ||
+                         cached.rect != rect || cached.lightHash != lightHash ||
+                         cached.casterHash != casterHash;
+
+            if (!stale) {
+                stats.shadowTilesCached++;
+                continue;
+            }
+
+            if (!targetBound) {
+                glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+                RenderState::getInstance().enable(GL_SCISSOR_TEST);
+                RenderState::getInstance().enable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(2.0f, 4.0f);
+                depthShader.bind();
+                targetBound = true;
+            }
+
+            glViewport(rect.x, rect.y, rect.z, rect.w);
+            glScissor(rect.x, rect.y, rect.z, rect.w);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            depthShader.setMat4(UniformName::LIGHT_VIEW_PROJECTION, viewProjection);
+
+            const std::vector<uint8_t>& visibility = queue.getVisibility();
+            for (size_t i = 0; i < queue.size(); i++) {
+                if (!visibility[i]) continue;
+
+                const RenderCommand& cmd = queue[i];
+                if (cmd.transparent) continue;
+
+                depthShader.setMat4(UniformName::MODEL, cmd.modelMatrix);
+                RenderState::getInstance().bindVertexArray(cmd.vao);
+                if (cmd.indexed) {
+                    glDrawElementsBaseVertex(GL_TRIANGLES, cmd.indexCount, GL_UNSIGNED_INT,
+                                             reinterpret_cast<const void*>(static_cast<uintptr_t>(cmd.firstIndex) * sizeof(GLuint)),
+                                             cmd.baseVertex);
+                } else {
+                    glDrawArrays(GL_TRIANGLES, static_cast<GLint>(cmd.firstIndex), cmd.indexCount);
+                }
+                stats.drawCalls++;
+            }
+
+            if (extraCasters) {
+                extraCasters(viewProjection, planes);
+                depthShader.bind();
+            }
+
+            cached.lightHash = lightHash;
+            cached.casterHash = casterHash;
+            cached.rect = rect;
+            cached.valid = true;
+            stats.shadowTilesRendered++;
+        }
+    }
+
+    // Tiles of lights that got no space this frame may be overwritten by
+    // others, so they start from scratch when they come back
+    for (size_t i = 0; i < m_cache.size(); i++) {
+        if (i >= m_lightTiles.size() || m_lightTiles[i] < 0) {
+            for (auto& cached : m_cache[i]) {
+                cached.valid = false;
+            }
+        }
+    }
+
+    m_invalidated = false;
+
+    if (targetBound) {
+        RenderState::getInstance().disable(GL_POLYGON_OFFSET_FILL);
+        RenderState::getInstance().disable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    }
+
+    m_tileBuffer.upload(m_gpuTiles.data(), m_gpuTiles.size() * sizeof(GPUShadowTile));
+    m_tileBuffer.bindBase(StorageBinding::SHADOW_TILES);
+}
+
+} // namespace ExperimentRedbear
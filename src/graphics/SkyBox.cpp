@@ -1,5 +1,6 @@
 #include "graphics/SkyBox.h"
 #include "graphics/Texture.h"
+#include "graphics/RenderState.h"
 #include "core/Logger.h"
 #include <GL/glew.h>
 #include <vector>
@@ -99,15 +100,12 @@ bool SkyBox::loadFromFiles(const std::string& directory,
 void SkyBox::render(const glm::mat4& view, const glm::mat4& projection) {
     if (!m_loaded) return;
 
-    glDepthFunc(GL_LEQUAL);
-    
-    glBindVertexArray(m_vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
+    // The scene already runs with LEQUAL, so this is normally elided
+    RenderState& state = RenderState::getInstance();
+    state.depthFunc(GL_LEQUAL);
+    state.bindVertexArray(m_vao);
+    state.bindTexture(0, m_cubemapTexture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-    
-    glDepthFunc(GL_LESS);
 }
 
 } // namespace ExperimentRedbear
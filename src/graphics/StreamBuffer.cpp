@@ -0,0 +1,215 @@
+#include "graphics/StreamBuffer.h"
+#include "graphics/RenderState.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// Waits are normally zero; this only bounds a single blocking call
+constexpr GLuint64 WAIT_TIMEOUT = 100000000;   // 100 ms in ns
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+StreamBuffer& StreamBuffer::getInstance() {
+    static StreamBuffer instance;
+    return instance;
+}
+
+StreamBuffer::StreamBuffer() {}
+
+StreamBuffer::~StreamBuffer() = default;
+
+bool StreamBuffer::initialize(size_t frameSize) {
+    shutdown();
+
+    GLint uniformAlignment = 0;
+    GLint storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    m_uniformAlignment = static_cast<size_t>(std::max(uniformAlignment, 16));
+    m_storageAlignment = static_cast<size_t>(std::max(storageAlignment, 16));
+
+    if (!createBuffer(frameSize)) {
+        LOG_ERROR("Failed to create the stream buffer");
+        return false;
+    }
+
+    LOG_INFO("Stream buffer: " + std::to_string(FRAME_COUNT) + " x " +
+             std::to_string(m_frameSize / 1024) + " KB");
+    return true;
+}
+
+void StreamBuffer::shutdown() {
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    // GL keeps a deleted buffer alive until pending commands are done
+    // with it, so nothing has to be waited for here
+    for (Retired& retired : m_retired) {
+        if (retired.fence) glDeleteSync(retired.fence);
+        glUnmapNamedBuffer(retired.buffer);
+        glDeleteBuffers(1, &retired.buffer);
+    }
+    m_retired.clear();
+
+    if (m_buffer) {
+        glUnmapNamedBuffer(m_buffer);
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_mapped = nullptr;
+    m_frameSize = 0;
+    m_region = 0;
+    m_head = 0;
+    m_usage = 0;
+}
+
+bool StreamBuffer::createBuffer(size_t frameSize) {
+    m_frameSize = alignUp(frameSize, std::max(m_uniformAlignment, m_storageAlignment));
+    const GLsizeiptr totalSize = static_cast<GLsizeiptr>(m_frameSize * FRAME_COUNT);
+
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, totalSize, nullptr, MAP_FLAGS);
+    m_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(m_buffer, 0, totalSize, MAP_FLAGS));
+
+    if (!m_mapped) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_frameSize = 0;
+        return false;
+    }
+
+    m_region = 0;
+    m_head = 0;
+    return true;
+}
+
+void StreamBuffer::grow(size_t required) {
+    size_t frameSize = std::max(m_frameSize, DEFAULT_FRAME_SIZE);
+    while (frameSize < required) frameSize *= 2;
+
+    // Allocations made earlier this frame still point into the old buffer,
+    // so it is only fenced at the end of the frame
+    m_retired.push_back({m_buffer, nullptr});
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    m_buffer = 0;
+    m_mapped = nullptr;
+
+    if (!createBuffer(frameSize)) {
+        LOG_ERROR("Failed to grow the stream buffer to " + std::to_string(frameSize / 1024) + " KB");
+        return;
+    }
+    LOG_WARNING("Stream buffer grown to " + std::to_string(FRAME_COUNT) + " x " +
+                std::to_string(m_frameSize / 1024) + " KB");
+}
+
+void StreamBuffer::beginFrame() {
+    if (!m_buffer) return;
+
+    m_lastUsage = m_usage;
+    m_usage = 0;
+
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    for (Retired& retired : m_retired) {
+        if (!retired.fence) {
+            retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+    releaseRetired();
+
+    m_region = (m_region + 1) % FRAME_COUNT;
+    m_head = 0;
+    m_stalled = false;
+
+    if (m_fences[m_region]) {
+        m_stalled = waitFence(m_fences[m_region]);
+        glDeleteSync(m_fences[m_region]);
+        m_fences[m_region] = nullptr;
+    }
+}
+
+void StreamBuffer::releaseRetired() {
+    auto done = [](const Retired& retired) {
+        GLenum status = glClientWaitSync(retired.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return false;
+        }
+        glDeleteSync(retired.fence);
+        glUnmapNamedBuffer(retired.buffer);
+        glDeleteBuffers(1, &retired.buffer);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), done), m_retired.end());
+}
+
+bool StreamBuffer::waitFence(GLsync fence) {
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        return false;
+    }
+
+    do {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+    } while (status == GL_TIMEOUT_EXPIRED);
+
+    if (status == GL_WAIT_FAILED) {
+        LOG_ERROR("Stream buffer fence wait failed");
+    }
+    return true;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment) {
+    StreamAllocation allocation;
+    if (!m_buffer) return allocation;
+
+    size = alignUp(std::max<size_t>(size, 1), 4);
+    size_t offset = alignUp(m_head, alignment);
+    if (offset + size > m_frameSize) {
+        grow(m_usage + size + alignment);
+        if (!m_buffer) return allocation;
+        offset = 0;
+    }
+
+    const size_t base = static_cast<size_t>(m_region) * m_frameSize;
+    m_usage += offset + size - m_head;
+    m_head = offset + size;
+
+    allocation.data = m_mapped + base + offset;
+    allocation.buffer = m_buffer;
+    allocation.offset = static_cast<GLintptr>(base + offset);
+    allocation.size = static_cast<GLsizeiptr>(size);
+    return allocation;
+}
+
+StreamAllocation StreamBuffer::write(const void* data, size_t size, size_t alignment) {
+    StreamAllocation allocation = allocate(size, alignment);
+    if (allocation && size > 0) {
+        std::memcpy(allocation.data, data, size);
+    }
+    return allocation;
+}
+
+void StreamBuffer::bindRange(GLenum target, GLuint index, const StreamAllocation& allocation) {
+    if (!allocation) return;
+    RenderState::getInstance().bindBufferRange(target, index, allocation.buffer, allocation.offset, allocation.size);
+}
+
+} // namespace ExperimentRedbear
@@ -0,0 +1,348 @@
+#include "graphics/Terrain.h"
+#include "graphics/Renderer.h"
+#include "graphics/RenderState.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/ShaderInterface.h"
+#include "core/Logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+// A LOD level is used up to this many of its node sizes from the camera
+constexpr float LOD_RANGE_SCALE = 2.0f;
+
+constexpr int QUADRANT_INDEX_COUNT = (Terrain::GRID_SIZE / 2) * (Terrain::GRID_SIZE / 2) * 6;
+
+bool boxInSphere(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::vec3& center, float radius) {
+    glm::vec3 closest = glm::clamp(center, minBounds, maxBounds);
+    glm::vec3 offset = closest - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+bool boxInPlanes(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::vec4 planes[6]) {
+    for (int i = 0; i < 6; i++) {
+        // Corner furthest along the plane normal
+        glm::vec3 corner(planes[i].x >= 0.0f ? maxBounds.x : minBounds.x,
+                         planes[i].y >= 0.0f ? maxBounds.y : minBounds.y,
+                         planes[i].z >= 0.0f ? maxBounds.z : minBounds.z);
+        if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Terrain shader uniforms (material index and fade come from UniformName)
+constexpr UniformID TERRAIN_BOUNDS("terrainBounds");
+constexpr UniformID TERRAIN_MORPH("terrainMorph");
+
+} // namespace
+
+Terrain::Terrain() {}
+
+Terrain::~Terrain() = default;
+
+bool Terrain::initialize() {
+    if (m_initialized) return true;
+
+    // Patch vertices in [0, 1]^2
+    std::vector<glm::vec2> vertices;
+    vertices.reserve((GRID_SIZE + 1) * (GRID_SIZE + 1));
+    for (int z = 0; z <= GRID_SIZE; z++) {
+        for (int x = 0; x <= GRID_SIZE; x++) {
+            vertices.push_back(glm::vec2(x, z) / static_cast<float>(GRID_SIZE));
+        }
+    }
+
+    // Indices grouped by quadrant (x-major within each z half) so a node
+    // can draw any single quadrant, or all four as one range
+    const int half = GRID_SIZE / 2;
+    std::vector<unsigned int> indices;
+    indices.reserve(QUADRANT_INDEX_COUNT * 4);
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        const int startX = (quadrant & 1) * half;
+        const int startZ = (quadrant >> 1) * half;
+        for (int z = startZ; z < startZ + half; z++) {
+            for (int x = startX; x < startX + half; x++) {
+                unsigned int i0 = static_cast<unsigned int>(z * (GRID_SIZE + 1) + x);
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + GRID_SIZE + 1;
+                unsigned int i3 = i2 + 1;
+                // Counter-clockwise seen from above
+                indices.insert(indices.end(), {i0, i2, i1});
+                indices.insert(indices.end(), {i1, i2, i3});
+            }
+        }
+    }
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_gridVBO);
+    glGenBuffers(1, &m_gridEBO);
+    glBindVertexArray(m_vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+    // Patch instances come from the stream buffer; draw() points binding 1
+    // at each frame's allocation
+    glEnableVertexArrayAttrib(m_vao, 1);
+    glVertexArrayAttribFormat(m_vao, 1, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(m_vao, 1, 1);
+    glVertexArrayBindingDivisor(m_vao, 1, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_gridEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_initialized = true;
+    return true;
+}
+
+void Terrain::shutdown() {
+    clear();
+
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_gridVBO) {
+        glDeleteBuffers(1, &m_gridVBO);
+        m_gridVBO = 0;
+    }
+    if (m_gridEBO) {
+        glDeleteBuffers(1, &m_gridEBO);
+        m_gridEBO = 0;
+    }
+    m_initialized = false;
+}
+
+bool Terrain::create(const std::vector<float>& heights, int resolution, const glm::vec2& origin, float size) {
+    if (resolution < 2 || heights.size() < static_cast<size_t>(resolution) * resolution || size <= 0.0f) {
+        LOG_ERROR("Invalid terrain heightfield");
+        return false;
+    }
+
+    clear();
+
+    m_heights.assign(heights.begin(), heights.begin() + static_cast<size_t>(resolution) * resolution);
+    m_resolution = resolution;
+    m_origin = origin;
+    m_size = size;
+
+    // Enough levels for leaves of at most MAX_LEAF_SIZE
+    m_lodCount = 1;
+    while (m_lodCount < MAX_LODS && size / static_cast<float>(1 << (m_lodCount - 1)) > MAX_LEAF_SIZE) {
+        m_lodCount++;
+    }
+    m_leafSize = size / static_cast<float>(1 << (m_lodCount - 1));
+    for (int lod = 0; lod < m_lodCount; lod++) {
+        m_ranges[lod] = getNodeSize(lod) * LOD_RANGE_SCALE;
+    }
+
+    // Leaf bounds from the samples they cover, then merged upwards
+    const float samplesPerMeter = static_cast<float>(resolution - 1) / size;
+    const int leafCount = 1 << (m_lodCount - 1);
+    m_nodeHeights.assign(m_lodCount, {});
+    m_nodeHeights[0].resize(static_cast<size_t>(leafCount) * leafCount);
+    for (int z = 0; z < leafCount; z++) {
+        int z0 = static_cast<int>(std::floor(z * m_leafSize * samplesPerMeter));
+        int z1 = std::min(static_cast<int>(std::ceil((z + 1) * m_leafSize * samplesPerMeter)), resolution - 1);
+        for (int x = 0; x < leafCount; x++) {
+            int x0 = static_cast<int>(std::floor(x * m_leafSize * samplesPerMeter));
+            int x1 = std::min(static_cast<int>(std::ceil((x + 1) * m_leafSize * samplesPerMeter)), resolution - 1);
+
+            glm::vec2 range(m_heights[z0 * resolution + x0]);
+            for (int sz = z0; sz <= z1; sz++) {
+                for (int sx = x0; sx <= x1; sx++) {
+                    float height = m_heights[sz * resolution + sx];
+                    range.x = std::min(range.x, height);
+                    range.y = std::max(range.y, height);
+                }
+            }
+            m_nodeHeights[0][z * leafCount + x] = range;
+        }
+    }
+
+    for (int lod = 1; lod < m_lodCount; lod++) {
+        const int count = 1 << (m_lodCount - 1 - lod);
+        const std::vector<glm::vec2>& children = m_nodeHeights[lod - 1];
+        m_nodeHeights[lod].resize(static_cast<size_t>(count) * count);
+        for (int z = 0; z < count; z++) {
+            for (int x = 0; x < count; x++) {
+                glm::vec2 range(children[(z * 2) * count * 2 + x * 2]);
+                for (int child = 1; child < 4; child++) {
+                    const glm::vec2& c = children[(z * 2 + (child >> 1)) * count * 2 + x * 2 + (child & 1)];
+                    range.x = std::min(range.x, c.x);
+                    range.y = std::max(range.y, c.y);
+                }
+                m_nodeHeights[lod][z * count + x] = range;
+            }
+        }
+    }
+
+    // Normal and height per sample, normals from central differences
+    const float spacing = size / static_cast<float>(resolution - 1);
+    std::vector<glm::vec4> texels(static_cast<size_t>(resolution) * resolution);
+    for (int z = 0; z < resolution; z++) {
+        const int zm = std::max(z - 1, 0);
+        const int zp = std::min(z + 1, resolution - 1);
+        for (int x = 0; x < resolution; x++) {
+            const int xm = std::max(x - 1, 0);
+            const int xp = std::min(x + 1, resolution - 1);
+            float dx = (m_heights[z * resolution + xp] - m_heights[z * resolution + xm]) / ((xp - xm) * spacing);
+            float dz = (m_heights[zp * resolution + x] - m_heights[zm * resolution + x]) / ((zp - zm) * spacing);
+            glm::vec3 normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+            texels[z * resolution + x] = glm::vec4(normal, m_heights[z * resolution + x]);
+        }
+    }
+
+    glGenTextures(1, &m_heightTexture);
+    glBindTexture(GL_TEXTURE_2D, m_heightTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, resolution, resolution);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    LOG_INFO("Terrain created: " + std::to_string(resolution) + "^2 samples, " + std::to_string(m_lodCount) +
+             " LOD levels, " + std::to_string(m_leafSize) + " m leaves");
+    return true;
+}
+
+void Terrain::clear() {
+    if (m_heightTexture) {
+        glDeleteTextures(1, &m_heightTexture);
+        m_heightTexture = 0;
+    }
+    m_heights.clear();
+    m_nodeHeights.clear();
+    m_resolution = 0;
+    m_lodCount = 0;
+}
+
+float Terrain::getHeight(float x, float z) const {
+    if (m_heights.empty()) return 0.0f;
+
+    const float scale = static_cast<float>(m_resolution - 1) / m_size;
+    float fx = std::clamp((x - m_origin.x) * scale, 0.0f, static_cast<float>(m_resolution - 1));
+    float fz = std::clamp((z - m_origin.y) * scale, 0.0f, static_cast<float>(m_resolution - 1));
+    int x0 = std::min(static_cast<int>(fx), m_resolution - 2);
+    int z0 = std::min(static_cast<int>(fz), m_resolution - 2);
+    float tx = fx - x0;
+    float tz = fz - z0;
+
+    const float* row0 = &m_heights[z0 * m_resolution];
+    const float* row1 = row0 + m_resolution;
+    float top = row0[x0] + (row0[x0 + 1] - row0[x0]) * tx;
+    float bottom = row1[x0] + (row1[x0 + 1] - row1[x0]) * tx;
+    return top + (bottom - top) * tz;
+}
+
+glm::vec3 Terrain::getNodeMin(int lod, int x, int z) const {
+    const float size = getNodeSize(lod);
+    const int count = 1 << (m_lodCount - 1 - lod);
+    return glm::vec3(m_origin.x + x * size, m_nodeHeights[lod][z * count + x].x, m_origin.y + z * size);
+}
+
+glm::vec3 Terrain::getNodeMax(int lod, int x, int z) const {
+    const float size = getNodeSize(lod);
+    const int count = 1 << (m_lodCount - 1 - lod);
+    return glm::vec3(m_origin.x + (x + 1) * size, m_nodeHeights[lod][z * count + x].y, m_origin.y + (z + 1) * size);
+}
+
+bool Terrain::selectNode(int lod, int x, int z, const glm::vec3& eye, const glm::vec4 planes[6]) {
+    const glm::vec3 minBounds = getNodeMin(lod, x, z);
+    const glm::vec3 maxBounds = getNodeMax(lod, x, z);
+
+    if (!boxInSphere(minBounds, maxBounds, eye, m_ranges[lod])) return false;
+
+    // Culled nodes count as handled so the parent doesn't draw them either
+    if (!boxInPlanes(minBounds, maxBounds, planes)) return true;
+
+    if (lod == 0 || !boxInSphere(minBounds, maxBounds, eye, m_ranges[lod - 1])) {
+        addNode(lod, x, z, FULL_PATCH);
+        return true;
+    }
+
+    // Children inside the finer range draw themselves, the rest are covered
+    // by the matching quadrant of this node
+    for (int child = 0; child < 4; child++) {
+        if (!selectNode(lod - 1, x * 2 + (child & 1), z * 2 + (child >> 1), eye, planes)) {
+            addNode(lod, x, z, QUADRANT_0 + child);
+        }
+    }
+    return true;
+}
+
+void Terrain::addNode(int lod, int x, int z, int selection) {
+    const float size = getNodeSize(lod);
+    m_selections[selection].push_back(glm::vec4(m_origin.x + x * size, m_origin.y + z * size, size,
+                                                static_cast<float>(lod)));
+}
+
+void Terrain::draw(ShaderProgram& shader, const glm::vec3& eye, const glm::vec4 planes[6], RenderStats& stats) {
+    if (!m_initialized || !isCreated()) return;
+
+    for (auto& selection : m_selections) {
+        selection.clear();
+    }
+
+    // Past the root's range the whole terrain is one coarse patch
+    const int root = m_lodCount - 1;
+    if (!selectNode(root, 0, 0, eye, planes) && boxInPlanes(getNodeMin(root, 0, 0), getNodeMax(root, 0, 0), planes)) {
+        addNode(root, 0, 0, FULL_PATCH);
+    }
+
+    m_upload.clear();
+    for (const auto& selection : m_selections) {
+        m_upload.insert(m_upload.end(), selection.begin(), selection.end());
+    }
+    if (m_upload.empty()) return;
+
+    StreamAllocation instances = StreamBuffer::getInstance().write(m_upload.data(), m_upload.size() * sizeof(glm::vec4));
+    if (!instances) return;
+    glVertexArrayVertexBuffer(m_vao, 1, instances.buffer, instances.offset, sizeof(glm::vec4));
+
+    shader.bind();
+    shader.setVec4(TERRAIN_BOUNDS, glm::vec4(m_origin, m_size, static_cast<float>(GRID_SIZE)));
+    glm::vec2 morph[MAX_LODS];
+    for (int lod = 0; lod < m_lodCount; lod++) {
+        float previous = lod > 0 ? m_ranges[lod - 1] : 0.0f;
+        morph[lod] = glm::vec2(previous + (m_ranges[lod] - previous) * MORPH_START, m_ranges[lod]);
+    }
+    shader.setVec2(TERRAIN_MORPH, m_lodCount, glm::value_ptr(morph[0]));
+    shader.setInt(UniformName::MATERIAL_INDEX, m_materialIndex == MaterialSystem::NO_MATERIAL ? -1 : static_cast<int>(m_materialIndex));
+    shader.setFloat(UniformName::FADE, 1.0f);
+
+    RenderState& state = RenderState::getInstance();
+    state.bindTexture(TextureBinding::TERRAIN_HEIGHT, m_heightTexture);
+    stats.textureBindings++;
+
+    state.bindVertexArray(m_vao);
+
+    GLuint baseInstance = 0;
+    for (int s = 0; s < SELECTION_COUNT; s++) {
+        const GLsizei count = static_cast<GLsizei>(m_selections[s].size());
+        if (count == 0) continue;
+
+        const GLsizei indexCount = s == FULL_PATCH ? QUADRANT_INDEX_COUNT * 4 : QUADRANT_INDEX_COUNT;
+        const uintptr_t offset = s == FULL_PATCH ? 0 : static_cast<uintptr_t>(s - QUADRANT_0) * QUADRANT_INDEX_COUNT * sizeof(unsigned int);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                                            reinterpret_cast<const void*>(offset), count, baseInstance);
+
+        baseInstance += static_cast<GLuint>(count);
+        stats.drawCalls++;
+        stats.triangles += count * indexCount / 3;
+    }
+}
+
+} // namespace ExperimentRedbear
@@ -1,4 +1,5 @@
 #include "graphics/Texture.h"
+#include "graphics/RenderState.h"
 #include "core/Logger.h"
 #include "stb_image.h"
 
@@ -138,8 +139,7 @@ bool Texture::createEmpty(int width, int height, const TextureParams& params) {
 }
 
 void Texture::bind(int unit) const {
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    RenderState::getInstance().bindTexture(static_cast<GLuint>(unit), m_textureID);
 }
 
 void Texture::unbind() const {
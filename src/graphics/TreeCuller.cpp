@@ -0,0 +1,374 @@
+#include "graphics/TreeCuller.h"
+#include "graphics/RenderState.h"
+#include "graphics/MeshSimplifier.h"
+#include "core/Logger.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <string>
+
+namespace ExperimentRedbear {
+
+namespace {
+
+constexpr GLuint WORKGROUP_SIZE = 64;
+
+const char* CULL_SOURCE = R"(
+layout (local_size_x = 64) in;
+
+layout (binding = 7) uniform sampler2D occlusionDepth;
+
+uniform int treeCount;
+uniform mat4 cullViewProjection;
+uniform vec4 cullPlanes[6];
+uniform vec4 cullEye;         // xyz = view position, w = pixels per unit (0 = shadow view)
+uniform vec2 cullImpostors;   // x = fade start, y = fade range (0 = no impostors)
+uniform bool cullOcclusion;
+uniform vec2 lodLimits;       // x = MeshSimplifier::LOD_PIXEL_ERROR, y = LOD_HYSTERESIS
+
+bool sphereVisible(vec4 sphere) {
+    for (int i = 0; i < 6; i++) {
+        if (dot(cullPlanes[i].xyz, sphere.xyz) + cullPlanes[i].w < -sphere.w) return false;
+    }
+    return true;
+}
+
+vec4 transformSphere(mat4 model, vec4 sphere) {
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+    return vec4((model * vec4(sphere.xyz, 1.0)).xyz, sphere.w * scale);
+}
+
+// Same test as OcclusionCuller::isOccluded, against the uploaded hierarchy
+bool sphereOccluded(vec4 sphere) {
+    ivec2 size = textureSize(occlusionDepth, 0);
+    vec2 minCorner = vec2(size);
+    vec2 maxCorner = vec2(0.0);
+    float nearest = 1.0;
+
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = sphere.xyz + vec3((i & 1) != 0 ? sphere.w : -sphere.w,
+                                        (i & 2) != 0 ? sphere.w : -sphere.w,
+                                        (i & 4) != 0 ? sphere.w : -sphere.w);
+        vec4 clip = cullViewProjection * vec4(corner, 1.0);
+        if (clip.z + clip.w < 0.0 || clip.w <= 0.0) return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 texel = (ndc.xy * 0.5 + 0.5) * vec2(size);
+        minCorner = min(minCorner, texel);
+        maxCorner = max(maxCorner, texel);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+
+    ivec2 p0 = max(ivec2(floor(minCorner)), ivec2(0));
+    ivec2 p1 = min(ivec2(floor(maxCorner)), size - 1);
+    if (p0.x > p1.x || p0.y > p1.y) return false;
+
+    int levelCount = textureQueryLevels(occlusionDepth);
+    int level = 0;
+    int extent = max(p1.x - p0.x, p1.y - p0.y);
+    while (extent > 1 && level < levelCount - 1) {
+        extent >>= 1;
+        level++;
+    }
+
+    for (int y = p0.y >> level; y <= (p1.y >> level); y++) {
+        for (int x = p0.x >> level; x <= (p1.x >> level); x++) {
+            if (texelFetch(occlusionDepth, ivec2(x, y), level).r >= nearest) return false;
+        }
+    }
+    return true;
+}
+
+// MeshSimplifier::selectLod; current is 0xFF when the part had no LOD
+uint selectLod(uint groupBase, uint lodCount, vec4 sphere, uint current) {
+    float distance = length(sphere.xyz - cullEye.xyz);
+    if (distance <= sphere.w) return 0u;
+
+    float pixelsPerError = sphere.w * cullEye.w / distance;
+    for (uint level = lodCount - 1u; level > 0u; level--) {
+        float limit = level > current ? lodLimits.x * (1.0 - lodLimits.y) : lodLimits.x;
+        if (treeGroups[groupBase + level].lodError * pixelsPerError <= limit) return level;
+    }
+    return 0u;
+}
+
+void main() {
+    uint tree = gl_GlobalInvocationID.x;
+    if (tree >= uint(treeCount)) return;
+
+    treeCullResults[tree * 2u] = uvec2(TREE_CULLED);
+    treeCullResults[tree * 2u + 1u] = uvec2(TREE_CULLED);
+
+    TreeInstance instance = treeInstances[tree];
+    uint type = min(uint(instance.params.y), 7u);
+    TreeType info = treeTypes[type];
+    bool mainView = cullEye.w > 0.0;
+    uint previousLods = treeLods[tree];
+    uint lods = 0xFFFFu;
+
+    vec4 bounds = transformSphere(makeTreeModel(instance, 1), info.bounds);
+    if (sphereVisible(bounds) && !(cullOcclusion && sphereOccluded(bounds))) {
+        float impostorFade = 0.0;
+        if (cullImpostors.y > 0.0) {
+            impostorFade = clamp((length(bounds.xyz - cullEye.xyz) - cullImpostors.x) / cullImpostors.y, 0.0, 1.0);
+        }
+
+        if (impostorFade > 0.0) {
+            uint slot = atomicAdd(impostorDraw.y, 1u);
+            treeImpostors[slot] = ImpostorInstance(instance.positionHeight,
+                                                   vec4(instance.params.x, instance.params.w, impostorFade, 0.0));
+        }
+
+        for (uint part = 0u; part < 2u && impostorFade < 1.0; part++) {
+            uint lodCount = info.lodCounts[part];
+            if (lodCount == 0u) continue;
+
+            vec4 sphere = transformSphere(makeTreeModel(instance, int(part)), info.partBounds[part]);
+            if (!sphereVisible(sphere)) continue;
+
+            // Shadow views draw what the main view drew, the rest at the
+            // coarsest level. While cross-fading the mesh is pinned to it.
+            uint groupBase = (type * 2u + part) * 8u;
+            uint previous = (previousLods >> (part * 8u)) & 0xFFu;
+            uint lod = lodCount - 1u;
+            if (!mainView) {
+                lod = min(previous, lodCount - 1u);
+            } else if (impostorFade <= 0.0) {
+                lod = selectLod(groupBase, lodCount, sphere, previous);
+            }
+            lods = (lods & ~(0xFFu << (part * 8u))) | (lod << (part * 8u));
+
+            uint group = groupBase + lod;
+            uint index = atomicAdd(treeDraws[group].instanceCount, 1u);
+            uint fade = uint(clamp(1.0 - impostorFade, 0.0, 1.0) * 255.0 + 0.5);
+            treeCullResults[tree * 2u + part] = uvec2((group << 24u) | index, tree | (fade << 24u));
+        }
+    }
+
+    if (mainView) {
+        treeLods[tree] = lods;
+    }
+}
+)";
+
+// One invocation per group: each group's run starts after all lower groups
+const char* OFFSET_SOURCE = R"(
+layout (local_size_x = 128) in;
+
+shared uint groupCounts[128];
+
+void main() {
+    uint group = gl_LocalInvocationID.x;
+    groupCounts[group] = treeDraws[group].instanceCount;
+    barrier();
+
+    uint offset = 0u;
+    for (uint i = 0u; i < group; i++) {
+        offset += groupCounts[i];
+    }
+
+    TreeGroup info = treeGroups[group];
+    treeDraws[group].count = info.indexCount;
+    treeDraws[group].firstIndex = info.firstIndex;
+    treeDraws[group].baseVertex = info.baseVertex;
+    treeDraws[group].baseInstance = offset;
+
+    if (group == 0u) {
+        impostorDraw.x = 4u;
+        impostorDraw.z = 0u;
+        impostorDraw.w = 0u;
+    }
+}
+)";
+
+const char* COMPACT_SOURCE = R"(
+layout (local_size_x = 64) in;
+
+uniform int treeCount;
+
+void main() {
+    uint tree = gl_GlobalInvocationID.x;
+    if (tree >= uint(treeCount)) return;
+
+    for (uint part = 0u; part < 2u; part++) {
+        uvec2 result = treeCullResults[tree * 2u + part];
+        if (result.x == TREE_CULLED) continue;
+        visibleTrees[treeDraws[result.x >> 24u].baseInstance + (result.x & 0xFFFFFFu)] = result.y;
+    }
+}
+)";
+
+GLuint groupCount(size_t count) {
+    return static_cast<GLuint>((count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE);
+}
+
+// Culling pass uniforms
+constexpr UniformID TREE_COUNT("treeCount");
+constexpr UniformID CULL_VIEW_PROJECTION("cullViewProjection");
+constexpr UniformID CULL_PLANES("cullPlanes");
+constexpr UniformID CULL_EYE("cullEye");
+constexpr UniformID CULL_IMPOSTORS("cullImpostors");
+constexpr UniformID CULL_OCCLUSION("cullOcclusion");
+constexpr UniformID LOD_LIMITS("lodLimits");
+
+} // namespace
+
+TreeCuller::TreeCuller() {}
+
+TreeCuller::~TreeCuller() = default;
+
+bool TreeCuller::initialize() {
+    if (isValid()) return true;
+
+    if (!GLEW_ARB_shader_draw_parameters) {
+        LOG_INFO("GPU tree culling unavailable (needs GL_ARB_shader_draw_parameters)");
+        return false;
+    }
+
+    // The culling buffers sit above the frame's bindings, past the minimum
+    // of 8 the GL guarantees
+    GLint bindings = 0;
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &bindings);
+    if (bindings <= static_cast<GLint>(StorageBinding::TREE_IMPOSTORS)) {
+        LOG_INFO("GPU tree culling unavailable (needs " + std::to_string(StorageBinding::TREE_IMPOSTORS + 1) +
+                 " storage buffer bindings, have " + std::to_string(bindings) + ")");
+        return false;
+    }
+    if (!createShaders()) return false;
+
+    m_lodBuffer.create(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), GL_DYNAMIC_COPY);
+    reset(m_treeCount);
+    return true;
+}
+
+void TreeCuller::shutdown() {
+    m_cullShader.reset();
+    m_offsetShader.reset();
+    m_compactShader.reset();
+    m_lodBuffer.destroy();
+    for (auto& buffers : m_views) {
+        buffers.results.destroy();
+        buffers.visible.destroy();
+        buffers.draws.destroy();
+        buffers.impostors.destroy();
+    }
+    m_shadowViewCount = 0;
+    m_table = StreamAllocation();
+}
+
+bool TreeCuller::createShaders() {
+    const std::string header = std::string("#version 450 core\n#define TREE_CULLING\n") +
+                               ShaderInterface::TREE_INSTANCES + ShaderInterface::TREE_CULLING;
+
+    Shader cull, offset, compact;
+    if (!cull.loadFromSource(header + CULL_SOURCE, ShaderType::COMPUTE) ||
+        !offset.loadFromSource(header + OFFSET_SOURCE, ShaderType::COMPUTE) ||
+        !compact.loadFromSource(header + COMPACT_SOURCE, ShaderType::COMPUTE)) {
+        LOG_ERROR("Failed to compile tree culling shaders");
+        return false;
+    }
+
+    m_cullShader = std::make_unique<ShaderProgram>();
+    m_cullShader->attachShader(cull);
+    m_offsetShader = std::make_unique<ShaderProgram>();
+    m_offsetShader->attachShader(offset);
+    m_compactShader = std::make_unique<ShaderProgram>();
+    m_compactShader->attachShader(compact);
+
+    if (!m_cullShader->link() || !m_offsetShader->link() || !m_compactShader->link()) {
+        LOG_ERROR("Failed to link tree culling shaders");
+        m_cullShader.reset();
+        m_offsetShader.reset();
+        m_compactShader.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void TreeCuller::reserve(GpuBuffer& buffer, size_t size) {
+    if (!buffer.isValid() || buffer.getSize() < size) {
+        buffer.create(GL_SHADER_STORAGE_BUFFER, size, GL_DYNAMIC_COPY);
+    }
+}
+
+void TreeCuller::reset(size_t treeCount) {
+    m_treeCount = treeCount;
+    if (!isValid()) return;
+
+    // Every part starts without a LOD (0xFF)
+    const size_t trees = std::max<size_t>(treeCount, 1);
+    reserve(m_lodBuffer, trees * sizeof(uint32_t));
+    const uint32_t none = 0xFFFFFFFFu;
+    glClearNamedBufferData(m_lodBuffer.getID(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &none);
+
+    // Only the main view writes impostors
+    for (auto& buffers : m_views) {
+        reserve(buffers.results, trees * TREE_MAX_PARTS * sizeof(glm::uvec2));
+        reserve(buffers.visible, trees * TREE_MAX_PARTS * sizeof(uint32_t));
+        reserve(buffers.draws, sizeof(GPUTreeDraws));
+    }
+    reserve(m_views[0].impostors, trees * 2 * sizeof(glm::vec4));
+}
+
+void TreeCuller::setTable(const GPUTreeCullTable& table) {
+    m_table = StreamBuffer::getInstance().writeStorage(&table, sizeof(table));
+}
+
+TreeCullResult TreeCuller::cull(const TreeCullView& view) {
+    TreeCullResult result;
+    if (!isValid() || m_treeCount == 0 || !m_table) return result;
+
+    const bool mainView = view.pixelsPerUnit > 0.0f;
+    if (!mainView && m_shadowViewCount == MAX_SHADOW_VIEWS) return result;
+    ViewBuffers& buffers = m_views[mainView ? 0 : 1 + m_shadowViewCount++];
+
+    const bool impostors = mainView && view.impostorRange > 0.0f;
+
+    // Counters start at zero; the offset pass fills in the rest
+    glClearNamedBufferData(buffers.draws.getID(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    StreamBuffer::bindRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::TREE_CULL_TABLE, m_table);
+    m_lodBuffer.bindBase(StorageBinding::TREE_LODS);
+    buffers.results.bindBase(StorageBinding::TREE_CULL_RESULTS);
+    buffers.visible.bindBase(StorageBinding::VISIBLE_TREES);
+    buffers.draws.bindBase(StorageBinding::TREE_DRAWS);
+    if (impostors) {
+        buffers.impostors.bindBase(StorageBinding::TREE_IMPOSTORS);
+    }
+    if (view.occlusionTexture) {
+        RenderState::getInstance().bindTexture(TextureBinding::OCCLUSION_DEPTH, view.occlusionTexture);
+    }
+
+    const int treeCount = static_cast<int>(m_treeCount);
+    m_cullShader->bind();
+    m_cullShader->setInt(TREE_COUNT, treeCount);
+    m_cullShader->setMat4(CULL_VIEW_PROJECTION, view.viewProjection);
+    m_cullShader->setVec4(CULL_PLANES, 6, glm::value_ptr(view.planes[0]));
+    m_cullShader->setVec4(CULL_EYE, glm::vec4(view.position, view.pixelsPerUnit));
+    m_cullShader->setVec2(CULL_IMPOSTORS, glm::vec2(view.impostorStart, view.impostorRange));
+    m_cullShader->setBool(CULL_OCCLUSION, view.occlusionTexture != 0);
+    m_cullShader->setVec2(LOD_LIMITS, glm::vec2(MeshSimplifier::LOD_PIXEL_ERROR, MeshSimplifier::LOD_HYSTERESIS));
+    glDispatchCompute(groupCount(m_treeCount), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_offsetShader->bind();
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_compactShader->bind();
+    m_compactShader->setInt(TREE_COUNT, treeCount);
+    glDispatchCompute(groupCount(m_treeCount), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    result.visibleBuffer = buffers.visible.getID();
+    result.drawBuffer = buffers.draws.getID();
+    result.impostorBuffer = impostors ? buffers.impostors.getID() : 0;
+    return result;
+}
+
+void TreeCuller::endFrame() {
+    m_shadowViewCount = 0;
+    m_table = StreamAllocation();
+}
+
+} // namespace ExperimentRedbear
@@ -8,6 +8,7 @@
  */
 
 #include "engine/Game.h"
+#include "engine/Benchmark.h"
 #include "core/Logger.h"
 #include <iostream>
 
@@ -41,6 +42,13 @@ int main(int argc, char* argv[]) {
         // Get game instance
         auto& game = ExperimentRedbear::Game::getInstance();
 
+        // --benchmark <scene> --frames N runs headless and exits
+        ExperimentRedbear::BenchmarkSettings benchmarkSettings;
+        if (ExperimentRedbear::Benchmark::parseArguments(argc, argv, benchmarkSettings)) {
+            logger.setLogLevel(ExperimentRedbear::LogLevel::INFO);
+            game.setBenchmark(benchmarkSettings);
+        }
+
         // Initialize game
         if (!game.initialize()) {
             LOG_FATAL("Failed to initialize game!");
@@ -51,6 +59,9 @@ int main(int argc, char* argv[]) {
         game.run();
 
         // Game will shutdown automatically
+        if (game.isBenchmark()) {
+            return game.getExitCode();
+        }
         LOG_INFO("Game exited successfully");
 
     } catch (const std::exception& e) {
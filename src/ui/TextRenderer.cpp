@@ -1,11 +1,24 @@
 #include "ui/TextRenderer.h"
 #include "graphics/Shader.h"
+#include "graphics/RenderState.h"
+#include "graphics/StreamBuffer.h"
+#include "graphics/Renderer.h"
 #include "core/Logger.h"
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
 
 namespace ExperimentRedbear {
 
+namespace {
+
+// Text shader uniforms
+constexpr UniformID PROJECTION("projection");
+constexpr UniformID TEXT_COLOR("textColor");
+constexpr UniformID TEXT("text");
+
+} // namespace
+
 TextRenderer& TextRenderer::getInstance() {
     static TextRenderer instance;
     return instance;
@@ -49,7 +62,6 @@ bool TextRenderer::initialize() {
 void TextRenderer::shutdown() {
     for (auto& pair : m_fonts) {
         glDeleteVertexArrays(1, &pair.second.vao);
-        glDeleteBuffers(1, &pair.second.vbo);
     }
     m_fonts.clear();
     
@@ -76,19 +88,12 @@ bool TextRenderer::loadFont(const std::string& name, const std::string& path, in
 
     FT_Set_Pixel_Sizes(face, 0, size);
 
-    // Generate VAO and VBO for this font
-    glGenVertexArrays(1, &font.vao);
-    glGenBuffers(1, &font.vbo);
-
-    glBindVertexArray(font.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, font.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // Generate the VAO for this font. renderText() attaches each string's
+    // vertices to binding 0.
+    glCreateVertexArrays(1, &font.vao);
+    glEnableVertexArrayAttrib(font.vao, 0);
+    glVertexArrayAttribFormat(font.vao, 0, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(font.vao, 0, 0);
 
     // Load first 128 ASCII characters
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -148,6 +153,13 @@ void TextRenderer::renderText(const std::string& text, const glm::vec2& position
         return;
     }
 
+    // The first string opens the frame's one TEXT range, endTextPass()
+    // closes it
+    if (!m_textPassOpen) {
+        Renderer::getInstance().getProfiler().beginPass(GpuPass::TEXT);
+        m_textPassOpen = true;
+    }
+
     Font& f = m_fonts[font];
 
     // Calculate centered position if needed
@@ -163,19 +175,29 @@ void TextRenderer::renderText(const std::string& text, const glm::vec2& position
     // Set projection matrix (orthographic for 2D text)
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(m_screenWidth), 
                                        0.0f, static_cast<float>(m_screenHeight));
-    m_textShader->setMat4("projection", projection);
-    m_textShader->setVec3("textColor", color);
-    m_textShader->setInt("text", 0);  // Texture unit 0
-
-    // Enable blending
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_DEPTH_TEST);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(f.vao);
+    m_textShader->setMat4(PROJECTION, projection);
+    m_textShader->setVec3(TEXT_COLOR, color);
+    m_textShader->setInt(TEXT, 0);  // Texture unit 0
+
+    // Enable blending. Text is drawn after the scene, and the next frame
+    // sets its own state, so nothing is restored afterwards.
+    RenderState& state = RenderState::getInstance();
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.disable(GL_DEPTH_TEST);
+
+    // Room for every character up front; each glyph's quad is written
+    // straight into mapped memory
+    using GlyphQuad = float[6][4];
+    StreamAllocation allocation = StreamBuffer::getInstance().allocate(text.size() * sizeof(GlyphQuad));
+    if (!allocation) return;
+    GlyphQuad* quads = static_cast<GlyphQuad*>(allocation.data);
+    glVertexArrayVertexBuffer(f.vao, 0, allocation.buffer, allocation.offset, 4 * sizeof(float));
+
+    state.bindVertexArray(f.vao);
 
     // Iterate through all characters
+    GLint glyph = 0;
     for (const char& c : text) {
         if (f.characters.find(c) == f.characters.end()) continue;
 
@@ -187,8 +209,8 @@ void TextRenderer::renderText(const std::string& text, const glm::vec2& position
         float w = ch.size.x * scale;
         float h = ch.size.y * scale;
 
-        // Update VBO for each character
-        float vertices[6][4] = {
+        // Quad for this character
+        const float vertices[6][4] = {
             { xpos,     ypos + h,   0.0f, 0.0f },
             { xpos + w, ypos,       1.0f, 1.0f },
             { xpos,     ypos,       0.0f, 1.0f },
@@ -197,28 +219,22 @@ void TextRenderer::renderText(const std::string& text, const glm::vec2& position
             { xpos + w, ypos + h,   1.0f, 0.0f },
             { xpos + w, ypos,       1.0f, 1.0f }
         };
+        std::memcpy(quads[glyph], vertices, sizeof(vertices));
 
         // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.textureID);
-
-        // Update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, f.vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // Render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        state.bindTexture(0, ch.textureID);
+        glDrawArrays(GL_TRIANGLES, glyph * 6, 6);
+        glyph++;
 
         // Advance cursors for next glyph
         pos.x += (ch.advance >> 6) * scale;
     }
+}
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
-    
-    m_textShader->unbind();
+void TextRenderer::endTextPass() {
+    if (!m_textPassOpen) return;
+    Renderer::getInstance().getProfiler().endPass(GpuPass::TEXT);
+    m_textPassOpen = false;
 }
 
 glm::vec2 TextRenderer::measureText(const std::string& text, const std::string& font, float scale) {
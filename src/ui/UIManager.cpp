@@ -1,5 +1,6 @@
 #include "ui/UIManager.h"
 #include "ui/UIElement.h"
+#include "graphics/RenderState.h"
 #include "core/Logger.h"
 #include <algorithm>
 
@@ -14,19 +15,12 @@ bool UIManager::initialize(int screenWidth, int screenHeight) {
     m_width = screenWidth;
     m_height = screenHeight;
 
-    // Create VAO and VBO for UI rendering
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-
-    glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // Create the VAO for UI rendering. Element quads are written to the
+    // stream buffer and attached to binding 0 when drawn.
+    glCreateVertexArrays(1, &m_vao);
+    glEnableVertexArrayAttrib(m_vao, 0);
+    glVertexArrayAttribFormat(m_vao, 0, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(m_vao, 0, 0);
 
     m_initialized = true;
     LOG_INFO("UI Manager initialized: " + std::to_string(screenWidth) + "x" + std::to_string(screenHeight));
@@ -41,10 +35,6 @@ void UIManager::shutdown() {
         glDeleteVertexArrays(1, &m_vao);
         m_vao = 0;
     }
-    if (m_vbo) {
-        glDeleteBuffers(1, &m_vbo);
-        m_vbo = 0;
-    }
 
     m_initialized = false;
 }
@@ -59,9 +49,10 @@ void UIManager::update(float deltaTime) {
 
 void UIManager::render() {
     // Disable depth test for UI
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RenderState& state = RenderState::getInstance();
+    state.disable(GL_DEPTH_TEST);
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Render all elements
     for (auto& element : m_elements) {
@@ -69,8 +60,6 @@ void UIManager::render() {
             // Render element
         }
     }
-
-    glEnable(GL_DEPTH_TEST);
 }
 
 void UIManager::addElement(std::shared_ptr<UIElement> element) {